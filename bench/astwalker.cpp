@@ -0,0 +1,267 @@
+#include "astwalker.hpp"
+
+#include <cstdlib>
+
+namespace deltac::bench {
+
+namespace {
+
+u64 normalize(u64 value, const QualType& ty) {
+    const usize bits = ty.size() * 8;
+
+    if (bits >= 64 || ty.is_bool_ty()) {
+        return value;
+    }
+
+    const u64 mask = (u64(1) << bits) - 1;
+
+    if (ty.is_signed_ty()) {
+        const u64 sign = u64(1) << (bits - 1);
+        return ((value & mask) ^ sign) - sign;
+    }
+
+    return value & mask;
+}
+
+u64 arithmetic(BinaryOp op, const QualType& ty, u64 lhs, u64 rhs) {
+    const bool is_signed = ty.is_signed_ty();
+
+    switch (op) {
+    case BinaryOp::Plus: return normalize(lhs + rhs, ty);
+    case BinaryOp::Minus: return normalize(lhs - rhs, ty);
+    case BinaryOp::Multiply: return normalize(lhs * rhs, ty);
+    case BinaryOp::Divide: return normalize(is_signed ? (u64)((i64)lhs / (i64)rhs) : lhs / rhs, ty);
+    case BinaryOp::Modulo: return is_signed ? (u64)((i64)lhs % (i64)rhs) : lhs % rhs;
+    case BinaryOp::LeftShift: return normalize(lhs << (rhs & 63), ty);
+    case BinaryOp::RightShift: return is_signed ? (u64)((i64)lhs >> (rhs & 63)) : lhs >> (rhs & 63);
+    case BinaryOp::BitwiseAnd: return lhs & rhs;
+    case BinaryOp::BitwiseOr: return lhs | rhs;
+    case BinaryOp::BitwiseXor: return lhs ^ rhs;
+    case BinaryOp::Equal: return lhs == rhs;
+    case BinaryOp::NotEqual: return lhs != rhs;
+    case BinaryOp::Less: return is_signed ? (i64)lhs < (i64)rhs : lhs < rhs;
+    case BinaryOp::Greater: return is_signed ? (i64)lhs > (i64)rhs : lhs > rhs;
+    case BinaryOp::LessEqual: return is_signed ? (i64)lhs <= (i64)rhs : lhs <= rhs;
+    case BinaryOp::GreaterEqual: return is_signed ? (i64)lhs >= (i64)rhs : lhs >= rhs;
+    case BinaryOp::And:
+    case BinaryOp::Or:
+        break;
+    }
+
+    DELTA_UNREACHABLE("logical operators short circuit");
+}
+
+BinaryOp to_binary_operator(AssignOp op) {
+    switch (op) {
+    case AssignOp::PlusEqual: return BinaryOp::Plus;
+    case AssignOp::MinusEqual: return BinaryOp::Minus;
+    case AssignOp::TimesEqual: return BinaryOp::Multiply;
+    case AssignOp::DevideEqual: return BinaryOp::Divide;
+    case AssignOp::ModEqual: return BinaryOp::Modulo;
+    case AssignOp::LeftShiftEqual: return BinaryOp::LeftShift;
+    case AssignOp::RightShiftEqual: return BinaryOp::RightShift;
+    case AssignOp::OrEqual: return BinaryOp::BitwiseOr;
+    case AssignOp::AndEqual: return BinaryOp::BitwiseAnd;
+    case AssignOp::XorEqual: return BinaryOp::BitwiseXor;
+    case AssignOp::Equal: break;
+    }
+
+    DELTA_UNREACHABLE("plain assignment has no binary operator");
+}
+
+[[noreturn]] void unsupported() {
+    std::abort();
+}
+
+} // namespace
+
+AstWalker::AstWalker(const ASTContext& context) {
+    for (VarDecl* var : context.toplevel_vardecls()) {
+        globals[var] = var->has_body() ? eval(var->get_expr()) : 0;
+    }
+}
+
+u64 AstWalker::call(FuncDecl* fn, llvm::ArrayRef<u64> args) {
+    llvm::DenseMap<const Decl*, u64> frame;
+
+    for (usize i = 0; i < args.size(); i++) {
+        frame[fn->param_decls()[i]] = args[i];
+    }
+
+    auto* caller = locals;
+    locals = &frame;
+
+    u64 ret = 0;
+    exec(fn->get_body(), ret);
+
+    locals = caller;
+    return ret;
+}
+
+AstWalker::Flow AstWalker::exec(Stmt* stmt, u64& ret) {
+    switch (stmt->stmt_kind()) {
+    case Stmt::CompoundStmtKind:
+        for (Stmt* s : util::cast<CompoundStmt>(stmt)->body()) {
+            if (exec(s, ret) == Flow::Return) {
+                return Flow::Return;
+            }
+        }
+
+        return Flow::Next;
+
+    case Stmt::ExprStmtKind: {
+        Expr* expr = util::cast<ExprStmt>(stmt)->get_expr();
+
+        if (expr->is_lval()) {
+            variable(expr);
+        }
+        else {
+            eval(expr);
+        }
+
+        return Flow::Next;
+    }
+
+    case Stmt::DeclStmtKind: {
+        auto* var = util::cast<VarDecl>(util::cast<DeclStmt>(stmt)->get_decl());
+
+        (*locals)[var] = var->has_body() ? eval(var->get_expr()) : 0;
+        return Flow::Next;
+    }
+
+    case Stmt::ReturnStmtKind: {
+        auto* ret_stmt = util::cast<ReturnStmt>(stmt);
+
+        ret = ret_stmt->has_expr() ? eval(ret_stmt->get_expr()) : 0;
+        return Flow::Return;
+    }
+
+    case Stmt::IfStmtKind: {
+        auto* if_stmt = util::cast<IfStmt>(stmt);
+
+        if (eval(if_stmt->get_cond())) {
+            return exec(if_stmt->get_then(), ret);
+        }
+
+        return if_stmt->has_else() ? exec(if_stmt->get_else(), ret) : Flow::Next;
+    }
+
+    default:
+        unsupported();
+    }
+}
+
+u64 AstWalker::eval(Expr* expr) {
+    switch (expr->expr_kind()) {
+    case Expr::IntLiteralExprKind:
+        return normalize(util::cast<IntLiteralExpr>(expr)->get_value().zextOrTrunc(64).getZExtValue(), expr->type());
+
+    case Expr::ParenExprKind:
+        return eval(util::cast<ParenExpr>(expr)->sub_expr());
+
+    case Expr::BinaryExprKind: {
+        auto* binary = util::cast<BinaryExpr>(expr);
+
+        switch (binary->op_code()) {
+        case BinaryOp::And:
+            return eval(binary->lhs()) && eval(binary->rhs());
+        case BinaryOp::Or:
+            return eval(binary->lhs()) || eval(binary->rhs());
+        default:
+            break;
+        }
+
+        const u64 lhs = eval(binary->lhs());
+        const u64 rhs = eval(binary->rhs());
+
+        return arithmetic(binary->op_code(), binary->lhs()->type(), lhs, rhs);
+    }
+
+    case Expr::UnaryExprKind: {
+        auto* unary = util::cast<UnaryExpr>(expr);
+        const u64 value = eval(unary->expr());
+
+        switch (unary->op_code()) {
+        case UnaryOp::Plus: return value;
+        case UnaryOp::Minus: return normalize(0 - value, expr->type());
+        case UnaryOp::BitwiseNot: return normalize(~value, expr->type());
+        case UnaryOp::Not: return !value;
+        default: unsupported();
+        }
+    }
+
+    case Expr::ImplicitCastExprKind:
+    case Expr::ExplicitCastExprKind: {
+        auto* cast = util::cast<CastExpr>(expr);
+
+        switch (cast->cast_kind()) {
+        case CastExpr::LValueToRValue: return variable(cast->castee());
+        case CastExpr::NoOp: return eval(cast->castee());
+        case CastExpr::IntCast: return normalize(eval(cast->castee()), expr->type());
+        case CastExpr::IntToBool: return eval(cast->castee()) != 0;
+        default: unsupported();
+        }
+    }
+
+    case Expr::CallExprKind: {
+        auto* call_expr = util::cast<CallExpr>(expr);
+        auto* callee = util::cast<FuncDecl>(util::cast<IdExpr>(call_expr->expr())->get_decl());
+
+        llvm::SmallVector<u64, 8> args;
+
+        for (Expr* arg : call_expr->arguments()) {
+            args.push_back(eval(arg));
+        }
+
+        if (!callee->has_body()) {
+            unsupported();
+        }
+
+        return call(callee, args);
+    }
+
+    default:
+        unsupported();
+    }
+}
+
+u64& AstWalker::variable(Expr* expr) {
+    switch (expr->expr_kind()) {
+    case Expr::IdExprKind: {
+        const Decl* decl = util::cast<IdExpr>(expr)->get_decl();
+
+        if (locals) {
+            if (auto it = locals->find(decl); it != locals->end()) {
+                return it->second;
+            }
+        }
+
+        return globals[decl];
+    }
+
+    case Expr::ParenExprKind:
+        return variable(util::cast<ParenExpr>(expr)->sub_expr());
+
+    case Expr::AssignExprKind:
+        return assign(util::cast<AssignExpr>(expr));
+
+    default:
+        unsupported();
+    }
+}
+
+u64& AstWalker::assign(AssignExpr* expr) {
+    const u64 value = eval(expr->rhs());
+    u64& slot = variable(expr->lhs());
+
+    if (expr->op_code() == AssignOp::Equal) {
+        slot = value;
+    }
+    else {
+        slot = arithmetic(to_binary_operator(expr->op_code()), expr->lhs()->type(), slot, value);
+    }
+
+    return slot;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "astcontext.hpp"
+#include "declaration.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "utils.hpp"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+
+namespace deltac::bench {
+
+/*
+ * The naive interpreter the bytecode interpreter is measured against: it evaluates the
+ * typed AST recursively, with a hash map of variables per call and a switch on the kind
+ * of every node. Values are 64 bit and extended after arithmetic like in the bytecode.
+ * Only what fib style programs need is supported: no pointers and no native functions.
+ */
+class AstWalker {
+public:
+    // evaluates the global initializers
+    explicit AstWalker(const ASTContext& context);
+
+    u64 call(FuncDecl* fn, llvm::ArrayRef<u64> args);
+
+private:
+    // a statement either falls through or returns from the function
+    enum class Flow {
+        Next,
+        Return,
+    };
+
+    Flow exec(Stmt* stmt, u64& ret);
+    u64 eval(Expr* expr);
+    u64& variable(Expr* expr);
+    u64& assign(AssignExpr* expr);
+
+private:
+    llvm::DenseMap<const Decl*, u64> globals;
+    // the variables of the innermost call
+    llvm::DenseMap<const Decl*, u64>* locals = nullptr;
+};
+
+}
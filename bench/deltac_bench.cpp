@@ -0,0 +1,296 @@
+#include "programgen.hpp"
+
+#include "filebuffer.hpp"
+#include "keywordtrie.hpp"
+#include "lexer.hpp"
+#include "literal_support.hpp"
+#include "parser.hpp"
+#include "tokenbuffer.hpp"
+
+#include "llvm/ADT/APInt.h"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace deltac;
+using deltac::bench::ProgramShape;
+
+/*
+ * Throughput of the front end over generated programs.
+ * Every benchmark reports bytes_per_second (MB/s of the source it handles) and tokens/s,
+ * so the numbers of different stages and program shapes can be compared directly.
+ * The first argument is the size of the program in KiB.
+ */
+
+namespace {
+
+enum Shape {
+    // the default mix
+    Mixed,
+    // mostly references to earlier variables, stresses identifier lexing and lookup
+    IdentifierHeavy,
+    // mostly literals, half of them hex
+    LiteralHeavy,
+    // deeply nested expressions, stresses the recursive descent
+    DeepNesting,
+};
+
+ProgramShape make_shape(Shape shape, usize bytes) {
+    ProgramShape ret;
+    ret.target_bytes = bytes;
+
+    switch (shape) {
+    case Mixed:
+        break;
+    case IdentifierHeavy:
+        ret.identifier_density = 0.9;
+        break;
+    case LiteralHeavy:
+        ret.identifier_density = 0.05;
+        ret.hex_ratio = 0.5;
+        break;
+    case DeepNesting:
+        ret.max_depth = 12;
+        break;
+    }
+
+    return ret;
+}
+
+// generated once per shape and size, a zero padded SourceBuffer like a real file
+const SourceBuffer& program(Shape shape, usize kib) {
+    static std::map<std::pair<Shape, usize>, std::unique_ptr<SourceBuffer>> cache;
+
+    auto& entry = cache[{ shape, kib }];
+
+    if (!entry) {
+        std::istringstream text(bench::generate_program(make_shape(shape, kib * 1024)));
+        entry = std::make_unique<SourceBuffer>(text);
+    }
+
+    return *entry;
+}
+
+void report(benchmark::State& state, usize bytes, usize tokens) {
+    state.SetBytesProcessed((int64_t)(state.iterations() * bytes));
+    state.counters["tokens/s"] = benchmark::Counter(
+        (double)(state.iterations() * tokens), benchmark::Counter::kIsRate
+    );
+}
+
+bool is_keyword(tok::Kind kind) {
+    switch (kind) {
+#define KEYWORD(X, Y) case tok::X:
+#include "tokentype.inc"
+        return true;
+    default:
+        return false;
+    }
+}
+
+usize count_tokens(const SourceBuffer& source, std::optional<tok::Kind> kind = std::nullopt) {
+    TokenBuffer tokens;
+    Lexer(source).lex_all(tokens);
+
+    if (!kind) {
+        return tokens.size();
+    }
+
+    usize count = 0;
+
+    for (usize i = 0; i < tokens.size(); i++) {
+        count += tokens.kind(i) == *kind;
+    }
+
+    return count;
+}
+
+void BM_Lex(benchmark::State& state, Shape shape) {
+    const SourceBuffer& source = program(shape, (usize)state.range(0));
+    usize count = 0;
+
+    for (auto _ : state) {
+        Lexer lexer(source);
+        Token token;
+
+        count = 0;
+
+        while (lexer.lex(token) && !token.is(tok::EndOfFile)) {
+            count++;
+        }
+
+        benchmark::DoNotOptimize(count);
+    }
+
+    report(state, source.size(), count + 1);
+}
+
+void BM_LexAll(benchmark::State& state, Shape shape) {
+    const SourceBuffer& source = program(shape, (usize)state.range(0));
+    TokenBuffer tokens;
+
+    for (auto _ : state) {
+        IdentifierTable identifiers;
+        Lexer lexer(source);
+
+        lexer.set_identifier_table(&identifiers);
+        lexer.lex_all(tokens);
+
+        benchmark::DoNotOptimize(tokens.size());
+    }
+
+    report(state, source.size(), tokens.size());
+}
+
+// keyword lookup on every identifier and keyword of the program, as the lexer did with the trie
+void BM_KeywordTrieSearch(benchmark::State& state, Shape shape) {
+    static const KeywordTrie trie = {
+#define KEYWORD(X, Y) tok::X,
+#include "tokentype.inc"
+    };
+
+    const SourceBuffer& source = program(shape, (usize)state.range(0));
+
+    // tokens are not interned, so their text points into the zero padded source
+    TokenBuffer tokens;
+    Lexer(source).lex_all(tokens);
+
+    std::vector<const char*> words;
+    usize bytes = 0;
+
+    for (usize i = 0; i < tokens.size(); i++) {
+        if (tokens.kind(i) == tok::Identifier || is_keyword(tokens.kind(i))) {
+            words.push_back(tokens.token(i).get_view().data());
+            bytes += tokens.length(i);
+        }
+    }
+
+    for (auto _ : state) {
+        for (const char* word : words) {
+            const char* key = word;
+            benchmark::DoNotOptimize(trie.tok_search(key));
+        }
+    }
+
+    report(state, bytes, words.size());
+}
+
+void BM_IntLiteralParser(benchmark::State& state, Shape shape) {
+    const SourceBuffer& source = program(shape, (usize)state.range(0));
+
+    TokenBuffer tokens;
+    Lexer(source).lex_all(tokens);
+
+    std::vector<Token> literals;
+
+    for (usize i = 0; i < tokens.size(); i++) {
+        if (tokens.kind(i) == tok::DecIntLiteral || tokens.kind(i) == tok::HexIntLiteral) {
+            literals.push_back(tokens.token(i));
+        }
+    }
+
+    usize bytes = 0;
+
+    for (const Token& literal : literals) {
+        bytes += literal.get_length();
+    }
+
+    llvm::APInt val(64, 0);
+
+    for (auto _ : state) {
+        for (const Token& literal : literals) {
+            IntLiteralParser parser(literal, literal.is(tok::HexIntLiteral) ? 16 : 10);
+            benchmark::DoNotOptimize(parser.get_apint_val(val));
+        }
+    }
+
+    report(state, bytes, literals.size());
+}
+
+// parsing and semantic analysis of pre-lexed tokens
+void BM_ParseExpressions(benchmark::State& state, Shape shape) {
+    const SourceBuffer& source = program(shape, (usize)state.range(0));
+    usize token_count = count_tokens(source);
+    // every declaration starts with let
+    usize decl_count = count_tokens(source, tok::Let);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+
+        // declarations are registered globally, so every run needs a fresh context
+        auto context = std::make_unique<ASTContext>();
+        TokenBuffer tokens;
+        Lexer lexer(source);
+
+        lexer.set_identifier_table(&context->identifier_table());
+        lexer.lex_all(tokens);
+
+        state.ResumeTiming();
+
+        Sema sema(*context);
+        Parser parser(tokens, sema);
+        Decl* decl = nullptr;
+        usize decls = 0;
+
+        while (parser.parse_top_level_decl(decl)) {
+            decls++;
+        }
+
+        if (decls != decl_count) {
+            state.SkipWithError("generated program failed to parse");
+            break;
+        }
+
+        benchmark::DoNotOptimize(decls);
+
+        state.PauseTiming();
+        context.reset();
+        state.ResumeTiming();
+    }
+
+    report(state, source.size(), token_count);
+}
+
+// lexing and parsing in one pass, as the compiler does without lookahead
+void BM_LexAndParse(benchmark::State& state, Shape shape) {
+    const SourceBuffer& source = program(shape, (usize)state.range(0));
+    usize token_count = count_tokens(source);
+
+    for (auto _ : state) {
+        ASTContext context;
+        Sema sema(context);
+        Lexer lexer(source);
+        Parser parser(lexer, sema);
+        Decl* decl = nullptr;
+
+        while (parser.parse_top_level_decl(decl)) {
+            benchmark::DoNotOptimize(decl);
+        }
+    }
+
+    report(state, source.size(), token_count);
+}
+
+} // namespace
+
+#define DELTAC_BENCH_SHAPES(FN, ...)                                      \
+    BENCHMARK_CAPTURE(FN, mixed, Mixed)__VA_ARGS__;                       \
+    BENCHMARK_CAPTURE(FN, identifier_heavy, IdentifierHeavy)__VA_ARGS__;  \
+    BENCHMARK_CAPTURE(FN, literal_heavy, LiteralHeavy)__VA_ARGS__;        \
+    BENCHMARK_CAPTURE(FN, deep_nesting, DeepNesting)__VA_ARGS__
+
+// 64 KiB fits in L2, 4 MiB does not
+DELTAC_BENCH_SHAPES(BM_Lex, ->Arg(64)->Arg(4096));
+DELTAC_BENCH_SHAPES(BM_LexAll, ->Arg(64)->Arg(4096));
+DELTAC_BENCH_SHAPES(BM_KeywordTrieSearch, ->Arg(1024));
+DELTAC_BENCH_SHAPES(BM_IntLiteralParser, ->Arg(1024));
+DELTAC_BENCH_SHAPES(BM_ParseExpressions, ->Arg(1024)->Unit(benchmark::kMillisecond));
+DELTAC_BENCH_SHAPES(BM_LexAndParse, ->Arg(1024)->Unit(benchmark::kMillisecond));
+
+BENCHMARK_MAIN();
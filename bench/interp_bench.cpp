@@ -0,0 +1,188 @@
+#include "astwalker.hpp"
+
+#include "bytecode.hpp"
+#include "codegen.hpp"
+#include "filebuffer.hpp"
+#include "interpreter.hpp"
+#include "jit.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace deltac;
+
+/*
+ * The bytecode interpreter against the naive AST walker on recursive calls, and against
+ * the JIT on the time from source to the exit of a short script.
+ * The first argument is n of fib(n).
+ */
+
+namespace {
+
+const char* const FIB_PROGRAM =
+    "fn fib(n i32) i32 {\n"
+    "    if n < 2 {\n"
+    "        return n;\n"
+    "    }\n"
+    "\n"
+    "    return fib(n - 1) + fib(n - 2);\n"
+    "}\n";
+
+// a script that computes fib(n) and exits with it
+std::string fib_script(i64 n) {
+    return std::string(FIB_PROGRAM) + "\nfn main() i32 {\n    return fib(" + std::to_string(n) + ");\n}\n";
+}
+
+u64 fib(u64 n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+// calls made by fib(n)
+u64 fib_calls(u64 n) {
+    return n < 2 ? 1 : 1 + fib_calls(n - 1) + fib_calls(n - 2);
+}
+
+std::unique_ptr<ASTContext> parse(const std::string& text) {
+    std::istringstream stream(text);
+    SourceBuffer source(stream);
+
+    auto context = std::make_unique<ASTContext>();
+    Sema sema(*context);
+    Lexer lexer(source);
+
+    lexer.set_identifier_table(&context->identifier_table());
+
+    Parser parser(lexer, sema);
+    Decl* decl = nullptr;
+
+    while (parser.parse_top_level_decl(decl)) {}
+
+    return parser.is_eof() ? std::move(context) : nullptr;
+}
+
+FuncDecl* find_function(const ASTContext& context, std::string_view name) {
+    for (FuncDecl* fn : context.toplevel_funcdecls()) {
+        if (fn->get_identifier() == name) {
+            return fn;
+        }
+    }
+
+    return nullptr;
+}
+
+void report_calls(benchmark::State& state, u64 n) {
+    state.counters["calls/s"] = benchmark::Counter(
+        (double)(state.iterations() * fib_calls(n)), benchmark::Counter::kIsRate
+    );
+}
+
+void BM_FibAstWalker(benchmark::State& state) {
+    const u64 n = (u64)state.range(0);
+    auto context = parse(FIB_PROGRAM);
+
+    bench::AstWalker walker(*context);
+    FuncDecl* fn = find_function(*context, "fib");
+
+    for (auto _ : state) {
+        const u64 args[] = { n };
+
+        if (walker.call(fn, args) != fib(n)) {
+            state.SkipWithError("wrong result");
+            break;
+        }
+    }
+
+    report_calls(state, n);
+}
+
+void BM_FibInterpreter(benchmark::State& state) {
+    const u64 n = (u64)state.range(0);
+    auto context = parse(FIB_PROGRAM);
+
+    bc::Module module;
+    std::string error;
+
+    if (!BytecodeGen(*context).generate(module, error)) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    Interpreter interpreter(module);
+    const u32 fn = module.find_function("fib");
+
+    for (auto _ : state) {
+        const u64 args[] = { n };
+
+        if (interpreter.call(fn, args, error) != fib(n)) {
+            state.SkipWithError("wrong result");
+            break;
+        }
+    }
+
+    report_calls(state, n);
+}
+
+// from the source text to the exit code of main, for a short lived script
+void BM_ScriptInterpreter(benchmark::State& state) {
+    const std::string script = fib_script(state.range(0));
+    const int expected = (int)fib((u64)state.range(0));
+
+    for (auto _ : state) {
+        auto context = parse(script);
+        bc::Module module;
+        std::string error;
+
+        if (!context || !BytecodeGen(*context).generate(module, error)) {
+            state.SkipWithError("cannot lower the script");
+            break;
+        }
+
+        if (Interpreter(module).run_main({ "fib" }, error) != expected) {
+            state.SkipWithError("wrong result");
+            break;
+        }
+    }
+}
+
+void BM_ScriptJIT(benchmark::State& state) {
+    const std::string script = fib_script(state.range(0));
+    const int expected = (int)fib((u64)state.range(0));
+
+    if (!CodeGen::initialize_native_target()) {
+        state.SkipWithError("cannot initialize the native target");
+        return;
+    }
+
+    for (auto _ : state) {
+        auto context = parse(script);
+        std::string error;
+
+        if (!context) {
+            state.SkipWithError("cannot parse the script");
+            break;
+        }
+
+        CodeGen codegen(*context, "fib");
+
+        if (!codegen.generate(error) || jit::run_main(codegen, { "fib" }, error) != expected) {
+            state.SkipWithError("wrong result");
+            break;
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_FibAstWalker)->Arg(20)->Arg(25)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FibInterpreter)->Arg(20)->Arg(25)->Unit(benchmark::kMillisecond);
+
+// fib(10) runs in microseconds, fib(25) is where compiling pays off
+BENCHMARK(BM_ScriptInterpreter)->Arg(10)->Arg(25)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ScriptJIT)->Arg(10)->Arg(25)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
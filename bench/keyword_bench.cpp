@@ -0,0 +1,67 @@
+#include "keywordtable.hpp"
+#include "keywordtrie.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+using namespace deltac;
+
+// a mix of keywords, keyword prefixes and plain identifiers
+// roughly in the proportion they appear in generated code
+static const std::vector<std::string>& lowercase_identifiers() {
+    static const std::vector<std::string> ids = {
+        "let", "fn", "return", "const", "value", "i", "count", "to", "as", "index",
+        "buffer", "tmp", "let_x", "letter", "functor", "true", "false", "void", "result", "ptr",
+        "length", "x", "y", "retval", "constant", "t", "a", "acc", "offset", "data",
+    };
+
+    return ids;
+}
+
+// bytes_per_second and tokens/s, like the front end benchmarks
+static void report(benchmark::State& state, const std::vector<std::string>& ids) {
+    size_t bytes = 0;
+
+    for (const std::string& id : ids) {
+        bytes += id.size();
+    }
+
+    state.SetBytesProcessed((int64_t)(state.iterations() * bytes));
+    state.counters["tokens/s"] = benchmark::Counter(
+        (double)(state.iterations() * ids.size()), benchmark::Counter::kIsRate
+    );
+}
+
+static void BM_KeywordTrie(benchmark::State& state) {
+    static const KeywordTrie trie = {
+#define KEYWORD(X, Y) tok::X,
+#include "tokentype.inc"
+    };
+
+    const auto& ids = lowercase_identifiers();
+
+    for (auto _ : state) {
+        for (const std::string& id : ids) {
+            const char* key = id.c_str();
+            benchmark::DoNotOptimize(trie.tok_search(key));
+        }
+    }
+
+    report(state, ids);
+}
+BENCHMARK(BM_KeywordTrie);
+
+static void BM_KeywordTable(benchmark::State& state) {
+    const auto& ids = lowercase_identifiers();
+
+    for (auto _ : state) {
+        for (const std::string& id : ids) {
+            benchmark::DoNotOptimize(KeywordTable::lookup(id));
+        }
+    }
+
+    report(state, ids);
+}
+BENCHMARK(BM_KeywordTable);
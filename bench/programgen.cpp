@@ -0,0 +1,143 @@
+#include "programgen.hpp"
+
+#include <vector>
+
+namespace deltac::bench {
+
+namespace {
+
+// splitmix64, unlike the standard distributions its output is the same everywhere
+class Random {
+public:
+    explicit Random(u64 seed) : state(seed) {}
+
+    u64 next() {
+        u64 z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // in [0, n)
+    u64 below(u64 n) { return next() % n; }
+
+    bool chance(double p) { return (double)(next() >> 11) * 0x1.0p-53 < p; }
+
+private:
+    u64 state;
+};
+
+constexpr const char* BINARY_OPS[] = {
+    "+", "-", "*", "/", "%", "&&", "||", "==", "!=", "<", ">", "<=", ">=", "<<", ">>", "&", "|", "^",
+};
+
+constexpr const char* UNARY_OPS[] = { "-", "!", "~" };
+
+constexpr const char* TYPES[] = { "i32", "i64", "u8", "u32" };
+
+constexpr const char* NAME_STEMS[] = {
+    "value", "count", "i", "tmp", "offset", "buffer_len", "acc", "x", "result", "letter", "index",
+};
+
+class Generator {
+public:
+    Generator(const ProgramShape& shape, u64 seed) : shape(shape), rng(seed) {}
+
+    std::string run() {
+        out.reserve(shape.target_bytes + 256);
+
+        while (out.size() < shape.target_bytes) {
+            declaration();
+        }
+
+        return std::move(out);
+    }
+
+private:
+    void declaration() {
+        if (rng.chance(shape.comment_ratio)) {
+            out += "// declaration ";
+            out += std::to_string(names.size());
+            out += '\n';
+        }
+
+        std::string name = NAME_STEMS[rng.below(std::size(NAME_STEMS))];
+        name += '_';
+        name += std::to_string(names.size());
+
+        out += "let ";
+        out += name;
+
+        // the type is deduced from the initializer otherwise
+        if (rng.chance(0.5)) {
+            out += ' ';
+            out += TYPES[rng.below(std::size(TYPES))];
+        }
+
+        out += " = ";
+        expression(0);
+        out += ";\n";
+
+        // only visible to later declarations
+        names.push_back(std::move(name));
+    }
+
+    void expression(unsigned depth) {
+        if (depth >= shape.max_depth || rng.chance(0.3)) {
+            leaf();
+            return;
+        }
+
+        switch (rng.below(4)) {
+        case 0:
+            out += UNARY_OPS[rng.below(std::size(UNARY_OPS))];
+            expression(depth + 1);
+            break;
+        case 1:
+            out += '(';
+            expression(depth + 1);
+            out += ')';
+            break;
+        default:
+            expression(depth + 1);
+            out += ' ';
+            out += BINARY_OPS[rng.below(std::size(BINARY_OPS))];
+            out += ' ';
+            expression(depth + 1);
+            break;
+        }
+    }
+
+    void leaf() {
+        if (!names.empty() && rng.chance(shape.identifier_density)) {
+            out += names[rng.below(names.size())];
+        }
+        else if (rng.chance(shape.hex_ratio)) {
+            static constexpr char DIGITS[] = "0123456789abcdefABCDEF";
+
+            // at most 7 digits, so the value fits in 32 bits
+            out += "0x";
+            for (u64 n = 1 + rng.below(7); n > 0; n--) {
+                out += DIGITS[rng.below(sizeof(DIGITS) - 1)];
+            }
+        }
+        else {
+            // mostly short literals, as in real code
+            out += std::to_string(rng.chance(0.8) ? rng.below(100) : rng.below(1000000000));
+        }
+    }
+
+private:
+    const ProgramShape& shape;
+    Random rng;
+    std::string out;
+    std::vector<std::string> names;
+};
+
+} // namespace
+
+std::string generate_program(const ProgramShape& shape, u64 seed) {
+    return Generator(shape, seed).run();
+}
+
+}
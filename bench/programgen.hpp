@@ -0,0 +1,31 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <string>
+
+namespace deltac::bench {
+
+/*
+ * Shape of a synthetic Delta program.
+ * Programs are sequences of top level variable declarations whose initializers
+ * are random expressions over integer literals and previously declared variables,
+ * so every generated program lexes and parses without errors.
+ */
+struct ProgramShape {
+    // the generated text is at least this long
+    usize target_bytes = 1 << 20;
+    // chance that an expression leaf refers to an earlier variable instead of a literal
+    double identifier_density = 0.5;
+    // maximum nesting depth of binary, unary and parenthesized expressions
+    unsigned max_depth = 4;
+    // chance that an integer literal is written in hex
+    double hex_ratio = 0.25;
+    // chance that a declaration is preceded by a line comment
+    double comment_ratio = 0.1;
+};
+
+// the same shape and seed always produce the same program
+std::string generate_program(const ProgramShape& shape, u64 seed = 0x5eed);
+
+}
@@ -1,8 +1,22 @@
 #pragma once
 
 #include "declaration.hpp"
+#include "expression.hpp"
+#include "identifiertable.hpp"
+#include "statistic.hpp"
+#include "statement.hpp"
+#include "symboltable.hpp"
 #include "utils.hpp"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
+
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace deltac {
@@ -28,7 +42,7 @@ public:
     }
 
     bool is_function() const {
-        return found() && util::isinstance<FunctionDecl>(decl);
+        return found() && util::isinstance<FuncDecl>(decl);
     }
 
     bool is_type() const {
@@ -40,44 +54,126 @@ private:
 };
 
 class ASTContext {
+private:
+    static constexpr usize NUM_BUILTIN_TYPES = 0
+#define BUILTIN_TYPE(ID, NAME, SIZE) + 1
+#include "builtin_type.inc"
+        ;
+
+    struct Arena;
+
 public:
     ASTContext();
     ASTContext(const ASTContext&) = delete;
     ASTContext(ASTContext&&) = delete;
 
-    ~ASTContext() {
-        util::cleanup_ptrs(global_vardecls.begin(), global_vardecls.end());
+    ~ASTContext();
+
+    /*
+     * Bump pointer arenas holding all AST nodes.
+     * Memory is only reclaimed when the context is destroyed.
+     * Nodes go to the arena of the context, except on a thread inside an ArenaScope of
+     * the context, which gets an arena of its own, so threads building the bodies of
+     * different functions never share an allocator.
+     */
+    class ArenaScope {
+    public:
+        explicit ArenaScope(const ASTContext& context);
+        ArenaScope(const ArenaScope&) = delete;
+        ~ArenaScope();
+
+    private:
+        Arena* saved;
+    };
+
+    void* allocate(usize bytes, usize align = 8) const {
+        return current_arena().allocator.Allocate(bytes, llvm::Align(align));
     }
 
-    void register_toplevel_decl(Decl* decl) {
+    void deallocate(void*) const {}
+
+    // runs the destructor of node when the context is destroyed
+    // only needed for nodes with members that own memory outside of the arena
+    template <typename T>
+    T* add_cleanup(T* node) const {
+        current_arena().cleanups.emplace_back([](void* p) { static_cast<T*>(p)->~T(); }, node);
+        return node;
+    }
+
+    // a copy of elements in the arena, for lists whose length is only known once they
+    // are parsed; the elements are never destroyed
+    template <typename T>
+    llvm::ArrayRef<T> copy_to_arena(llvm::ArrayRef<T> elements) const {
+        static_assert(std::is_trivially_destructible_v<T>, "no cleanup is registered for the elements");
+
+        if (elements.empty()) {
+            return {};
+        }
+
+        T* mem = static_cast<T*>(allocate(sizeof(T) * elements.size(), alignof(T)));
+        std::uninitialized_copy(elements.begin(), elements.end(), mem);
+        return { mem, elements.size() };
+    }
+
+    // of all the arenas
+    usize arena_bytes_allocated() const;
+
+    // returns false if the name is already declared at the top level
+    bool register_toplevel_decl(Decl* decl) {
         assert(decl != nullptr);
+
+        if (auto* named = util::dyn_cast<NamedDecl>(decl)) {
+            DELTA_ASSERT(symbols.current_scope_kind() == SymbolTable::GlobalScope);
+
+            if (symbols.insert(named->get_identifier_info(), named)) {
+                return false;
+            }
+        }
         
-        if (auto* d = dynamic_cast<VarDecl*>(decl)) {
+        if (auto* d = util::dyn_cast<VarDecl>(decl)) {
             top_level_vardecls.push_back(d);
         }
-        else if (auto* d = dynamic_cast<FuncDecl*>(decl)) {
-            top_level_vardecls.push_back(d);
+        else if (auto* d = util::dyn_cast<FuncDecl>(decl)) {
+            top_level_funcdecls.push_back(d);
         }
+
+        return true;
+    }
+
+    // top level declarations in the order they were registered
+    llvm::ArrayRef<VarDecl*> toplevel_vardecls() const { return top_level_vardecls; }
+    llvm::ArrayRef<FuncDecl*> toplevel_funcdecls() const { return top_level_funcdecls; }
+
+    // innermost declaration of id visible from the current scope
+    LookupResult lookup_decl_with_id(const IdentifierInfo* id) const {
+        assert(id != nullptr);
+
+        return symbols.lookup(id);
     }
 
     LookupResult lookup_decl_with_id(std::string_view id) const {
         assert(!id.empty());
 
-        for (VarDecl* vardecl : top_level_vardecls) {
-            if (vardecl->get_identifier() == id) {
-                return vardecl;
-            }
+        if (const IdentifierInfo* info = identifiers.find(id)) {
+            return symbols.lookup(info);
         }
 
         return nullptr;
     }
 
+    // shared by all lexers feeding this context
+    IdentifierTable& identifier_table() { return identifiers; }
+    const IdentifierTable& identifier_table() const { return identifiers; }
+
+    SymbolTable& symbol_table() { return symbols; }
+    const SymbolTable& symbol_table() const { return symbols; }
+
 public:
     BuiltinType* get_i32_ty() const;
     BuiltinType* get_int_ty_size(u32 bitwidth, bool is_signed) const;
     BuiltinType* get_bool_ty() const;
     BuiltinType* get_void_ty() const;
-    BuiltinType* get_void_ptr_ty() const;
+    PtrType* get_void_ptr_ty() const;
 
     BuiltinType* get_uint_ty(u32 bitwidth) const {
         return get_int_ty_size(bitwidth, false);
@@ -88,22 +184,88 @@ public:
     }
 
     BuiltinType* get_builtin_type(BuiltinType::Kind kind) const {
-        // BuiltinType is always const
-        return const_cast<BuiltinType*>(&builtin_types[kind]);
+        return builtin_types[kind];
+    }
+
+    // the unique pointer type to pointee
+    // the qualification of the pointer itself is kept by the QualType referring to it
+    PtrType* get_ptr_type(QualType pointee) const;
+
+    // the unique function type with the given signature
+    FunctionType* get_function_type(llvm::ArrayRef<QualType> params, QualType return_ty) const;
+
+private:
+    struct Arena {
+        const ASTContext* owner;
+        llvm::BumpPtrAllocator allocator;
+        llvm::SmallVector<std::pair<void (*)(void*), void*>, 16> cleanups;
+    };
+
+    // the arena of the ArenaScope the thread is in, for any context
+    static thread_local Arena* thread_arena;
+
+    Arena& current_arena() const {
+        return thread_arena && thread_arena->owner == this ? *thread_arena : arena;
     }
 
+    // arena and table sizes, recorded once the context is done
+    void record_statistics() const;
+
 private:
-    std::vector<BuiltinType> builtin_types;
+    mutable Arena arena = { this, {}, {} };
+    // created by ArenaScope, they live as long as the nodes in them
+    mutable std::vector<std::unique_ptr<Arena>> thread_arenas;
+
+    BuiltinType* builtin_types[NUM_BUILTIN_TYPES];
+    // types are shared by all threads, the lock guards the uniquing sets and thread_arenas
+    mutable std::mutex mutex;
+    mutable llvm::FoldingSet<PtrType> ptr_types;
+    mutable llvm::FoldingSet<FunctionType> function_types;
+
+    IdentifierTable identifiers;
+    SymbolTable symbols;
+
     std::vector<VarDecl*> top_level_vardecls;
     std::vector<FuncDecl*> top_level_funcdecls;
 };
 
-BuiltinType* ASTContext::get_i32_ty() const {
+inline BuiltinType* ASTContext::get_i32_ty() const {
     return get_builtin_type(BuiltinType::I32);
 }
 
-BuiltinType* ASTContext::get_bool_ty() const {
+inline BuiltinType* ASTContext::get_bool_ty() const {
     return get_builtin_type(BuiltinType::Bool);
 }
 
+inline BuiltinType* ASTContext::get_void_ty() const {
+    return get_builtin_type(BuiltinType::Void);
+}
+
+inline PtrType* ASTContext::get_void_ptr_ty() const {
+    return get_ptr_type(get_void_ty());
+}
+
+inline void* Expr::operator new(usize bytes, const ASTContext& ctx, usize align) {
+    return ctx.allocate(bytes, align);
+}
+
+inline void* Stmt::operator new(usize bytes, const ASTContext& ctx, usize align) {
+    return ctx.allocate(bytes, align);
+}
+
+inline void* Decl::operator new(usize bytes, const ASTContext& ctx, usize align) {
+    return ctx.allocate(bytes, align);
+}
+
+inline CallExpr* CallExpr::create(const ASTContext& ctx, QualType type, ValCate valcate, Expr* expr,
+                                  llvm::ArrayRef<Expr*> arguments) {
+    void* mem = ctx.allocate(totalSizeToAlloc<Expr*>(arguments.size()), alignof(CallExpr));
+    return ::new (mem) CallExpr(std::move(type), valcate, expr, arguments);
+}
+
+inline CompoundStmt* CompoundStmt::create(const ASTContext& ctx, llvm::ArrayRef<Stmt*> stmtlist) {
+    void* mem = ctx.allocate(totalSizeToAlloc<Stmt*>(stmtlist.size()), alignof(CompoundStmt));
+    return ::new (mem) CompoundStmt(stmtlist);
+}
+
 } // namespace deltac
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "astcontext.hpp"
+#include "declaration.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "utils.hpp"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace deltac {
+
+/*
+ * A compact register bytecode for the interpreter, lowered from the typed AST.
+ *
+ * Every function has a window of 64 bit registers: its parameters come first, then its
+ * locals, then the temporaries of the statement being evaluated. A value is kept
+ * canonical for its type, sign extended for signed types and zero extended for
+ * unsigned ones and pointers, so comparisons and 64 bit arithmetic are correct for any
+ * width and only the results of arithmetic on narrower types are extended again.
+ * A call passes its arguments in consecutive registers of the caller, which become the
+ * first registers of the callee's window, so calls copy nothing.
+ *
+ * The superinstructions fuse the patterns the lowering sees most: i32 arithmetic with
+ * the extension of its result, arithmetic with a literal operand and the comparison of
+ * an if condition with its branch.
+ */
+namespace bc {
+
+enum Op : u16 {
+#define OPCODE(X) X,
+#include "opcodes.inc"
+    NumOps
+};
+
+std::string_view op_name(Op op);
+
+// jump targets and constants are in imm, which is also the function of a call
+struct Instr {
+    Op op;
+    u16 a = 0;
+    u16 b = 0;
+    u16 c = 0;
+    i32 imm = 0;
+};
+
+static_assert(sizeof(Instr) == 12, "instructions are packed in 12 bytes");
+
+// the access of Load and Store, in c
+enum MemKind : u16 {
+    MemI8,
+    MemI16,
+    MemI32,
+    MemI64,
+    MemU8,
+    MemU16,
+    MemU32,
+    MemU64,
+};
+
+struct Function {
+    std::string name;
+    u16 num_params = 0;
+    u16 num_registers = 0;
+    bool returns_value = false;
+    std::vector<Instr> code;
+};
+
+// a function without a body, resolved in the process like the JIT does
+struct NativeFunction {
+    std::string name;
+    void* address = nullptr;
+    u16 num_params = 0;
+};
+
+struct Module {
+    static constexpr u32 NO_FUNCTION = ~0u;
+
+    std::vector<Function> functions;
+    std::vector<NativeFunction> natives;
+    std::vector<u64> constants;
+    // the initial values of the globals, zero or their initializer if it is a literal
+    std::vector<u64> globals;
+    // runs the other global initializers in declaration order, NO_FUNCTION without any
+    u32 init_function = NO_FUNCTION;
+
+    u32 find_function(std::string_view name) const;
+
+    void dump(std::ostream& os) const;
+};
+
+} // namespace bc
+
+/*
+ * Lowers the declarations of a translation unit to a bytecode module.
+ *
+ * Like CodeGen it relies on Sema having made every conversion explicit, and it folds
+ * the casts that cost nothing on canonical registers: reading a local is the register
+ * itself and an IntCast to a 64 bit type is no instruction at all.
+ * Variables whose address is taken do not live in registers, they are not supported.
+ */
+class BytecodeGen {
+public:
+    explicit BytecodeGen(const ASTContext& context);
+
+    // returns false on constructs without a lowering or on undefined native functions
+    bool generate(bc::Module& module, std::string& error);
+
+private:
+    // where an lvalue lives
+    struct Place {
+        enum Kind : u8 {
+            Register,
+            Global,
+            Memory,
+        };
+
+        Kind kind;
+        // the register of a local, or the register holding the address
+        u16 reg = 0;
+        u32 global = 0;
+        QualType type;
+    };
+
+    void emit_function(FuncDecl* fn);
+
+    void emit_stmt(Stmt* stmt);
+    void emit_if_stmt(IfStmt* stmt);
+    void emit_return_stmt(ReturnStmt* stmt);
+    void emit_local_var(VarDecl* var);
+
+    // emits a jump taken when cond is false and returns its index to patch the target
+    usize emit_jump_if_false(Expr* cond);
+
+    // evaluates an rvalue into dst, or into any register if dst is empty
+    u16 emit_expr(Expr* expr, std::optional<u16> dst = std::nullopt);
+    Place emit_place(Expr* expr);
+
+    u16 emit_binary_expr(BinaryExpr* expr, std::optional<u16> dst);
+    u16 emit_binary_operation(BinaryExpr* expr, std::optional<u16> dst);
+    // r[dst] = r[lhs] op rhs for the operator and the right operand of expr
+    // lhs is the register of the left operand, it must be dst for && and ||
+    void apply_binary_operation(BinaryExpr* expr, u16 lhs, u16 dst);
+    u16 emit_logical_expr(BinaryExpr* expr);
+    u16 emit_unary_expr(UnaryExpr* expr, std::optional<u16> dst);
+    u16 emit_cast_expr(CastExpr* expr, std::optional<u16> dst);
+    u16 emit_call_expr(CallExpr* expr, std::optional<u16> dst);
+    Place emit_assign_expr(AssignExpr* expr);
+
+    // r[dst] = r[lhs] op r[rhs] on values of type ty, extended to ty
+    void emit_arithmetic(BinaryOp op, const QualType& ty, u16 dst, u16 lhs, u16 rhs);
+    // r[dst] = r[src] + imm or r[src] - imm on values of type ty
+    void emit_arithmetic_imm(BinaryOp op, const QualType& ty, u16 dst, u16 src, i32 imm);
+    // extends r[src] into r[dst] for the type, a move if the type is 64 bits wide
+    void emit_normalize(const QualType& ty, u16 dst, u16 src);
+
+    u16 read_place(const Place& place, std::optional<u16> dst);
+    void write_place(const Place& place, u16 src);
+
+    usize emit(bc::Op op, u16 a = 0, u16 b = 0, u16 c = 0, i32 imm = 0);
+    void emit_load_constant(u16 dst, u64 value);
+    void patch_jump(usize jump);
+
+    u16 new_register();
+    u16 target_register(std::optional<u16> dst) { return dst ? *dst : new_register(); }
+
+    void unsupported(std::string_view what);
+
+private:
+    const ASTContext& context;
+    bc::Module* module = nullptr;
+
+    // functions with a body map to their index, natives to theirs with NATIVE_BIT set
+    llvm::DenseMap<const Decl*, u32> function_indices;
+    llvm::DenseMap<const Decl*, u32> global_slots;
+    llvm::DenseMap<const Decl*, u16> local_registers;
+
+    bc::Function* curr_function = nullptr;
+    // temporaries are freed after every statement, locals are below them
+    u16 first_temporary = 0;
+    u16 next_register = 0;
+    // false after a return, the code that follows is dead and not emitted
+    bool reachable = true;
+
+    // the first unsupported construct, generation stops reporting after it
+    std::string unsupported_what;
+};
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+namespace deltac {
+
+/*
+ * Vectorized scanning over source text.
+ * All functions scan [ptr, end) and return end if nothing is found.
+ * The whole range must be readable; callers pass the end of the padding
+ * of a SourceBuffer to let the vector loops run up to the null terminator.
+ * SSE2 is the baseline on x86-64, AVX2 is selected at runtime if available.
+ */
+
+/// Returns the first character in [ptr, end) that is not whitespace
+/// (see is_whitespace in charinfo.hpp).
+const char* skip_whitespace(const char* ptr, const char* end);
+
+/// Returns the first occurrence of either a or b in [ptr, end).
+const char* find_first_of(const char* ptr, const char* end, char a, char b);
+
+/// Returns the first occurrence of any of a, b, c or d in [ptr, end).
+const char* find_first_of(const char* ptr, const char* end, char a, char b, char c, char d);
+
+/// Returns the name of the implementation selected for this CPU.
+const char* charscan_impl_name();
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "astcontext.hpp"
+#include "declaration.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "utils.hpp"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CodeGen.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace llvm {
+class TargetMachine;
+}
+
+namespace deltac {
+
+/*
+ * Lowers the declarations of a translation unit to an LLVM module.
+ *
+ * Sema has already made every conversion explicit, so the lowering is a direct walk:
+ * both operands of a binary expression have the same type, reads of variables are
+ * LValueToRValue casts and conversions are ImplicitCastExprs.
+ * Variables live in memory, globals as GlobalVariables and locals as allocas in the
+ * entry block, which mem2reg promotes to registers at -O1 and above.
+ * A global with an initializer that does not fold to a constant is initialized by
+ * a module constructor, in declaration order.
+ *
+ * Each CodeGen owns its LLVMContext, so translation units are lowered and optimized
+ * on different threads without sharing anything.
+ */
+class CodeGen {
+public:
+    enum class OptLevel : u8 {
+        O0,
+        O1,
+        O2,
+        O3,
+    };
+
+public:
+    CodeGen(const ASTContext& context, std::string_view module_name, OptLevel level = OptLevel::O0);
+    ~CodeGen();
+
+    CodeGen(const CodeGen&) = delete;
+    CodeGen(CodeGen&&) = delete;
+
+    // registers the native target with LLVM, safe to call from any thread
+    static bool initialize_native_target();
+
+    // the optimization level of instruction selection and register allocation
+    static llvm::CodeGenOpt::Level codegen_level(OptLevel level);
+
+    // lowers every top level declaration for the native target
+    // returns false on constructs without a lowering or without a native target
+    bool generate(std::string& error);
+
+    // runs the default new pass manager pipeline of the level
+    void optimize();
+
+    bool emit_object_file(const std::string& path, std::string& error);
+    bool emit_llvm_ir(const std::string& path, std::string& error);
+
+    llvm::Module& module() { return *llvm_module; }
+
+    OptLevel opt_level() const { return level; }
+
+    // hands the module over together with its context, e.g. to the JIT
+    // nothing but the destructor may be called afterwards
+    std::pair<std::unique_ptr<llvm::LLVMContext>, std::unique_ptr<llvm::Module>> release_module();
+
+private:
+    llvm::Type* convert_type(const QualType& ty);
+    llvm::FunctionType* convert_function_type(const FunctionType* ty);
+
+    void declare_function(FuncDecl* fn);
+    void emit_global_var(VarDecl* var);
+    void emit_function_body(FuncDecl* fn);
+
+    void emit_stmt(Stmt* stmt);
+    void emit_compound_stmt(CompoundStmt* stmt);
+    void emit_if_stmt(IfStmt* stmt);
+    void emit_return_stmt(ReturnStmt* stmt);
+    void emit_local_var(VarDecl* var);
+
+    // the value of an rvalue expression, null for a call to a void function
+    llvm::Value* emit_rvalue(Expr* expr);
+    // the address of an lvalue expression
+    llvm::Value* emit_lvalue(Expr* expr);
+
+    llvm::Value* emit_binary_expr(BinaryExpr* expr);
+    // the operation of expr on the value of its left operand
+    llvm::Value* emit_binary_operation(BinaryExpr* expr, llvm::Value* lhs);
+    llvm::Value* emit_logical_expr(BinaryExpr* expr, llvm::Value* lhs);
+    llvm::Value* emit_unary_expr(UnaryExpr* expr);
+    llvm::Value* emit_cast_expr(CastExpr* expr);
+    llvm::Value* emit_call_expr(CallExpr* expr);
+    llvm::Value* emit_assign_expr(AssignExpr* expr);
+
+    llvm::AllocaInst* create_entry_alloca(llvm::Type* ty, llvm::StringRef name);
+
+    // false after a return or after an if whose branches all return, the code that
+    // follows is dead and not emitted
+    bool is_reachable() const {
+        return builder.GetInsertBlock() != nullptr && builder.GetInsertBlock()->getTerminator() == nullptr;
+    }
+
+    void unsupported(std::string_view what);
+
+private:
+    const ASTContext& context;
+
+    // owned through a pointer so that it can be released with the module
+    std::unique_ptr<llvm::LLVMContext> llvm_context;
+    std::unique_ptr<llvm::Module> llvm_module;
+    llvm::IRBuilder<> builder;
+
+    OptLevel level;
+    // created by generate, which also sets the data layout of the module from it
+    std::unique_ptr<llvm::TargetMachine> machine;
+
+    // globals and allocas of variables, functions of FuncDecls
+    llvm::DenseMap<const Decl*, llvm::Value*> decl_values;
+
+    llvm::Function* curr_function = nullptr;
+    // the first unsupported construct, generation stops reporting after it
+    std::string unsupported_what;
+};
+
+}
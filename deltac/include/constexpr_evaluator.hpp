@@ -0,0 +1,91 @@
+#pragma once
+
+#include "expression.hpp"
+#include "operators.hpp"
+#include "typeinfo.hpp"
+#include "utils.hpp"
+
+#include "llvm/ADT/APSInt.h"
+
+#include <optional>
+
+namespace deltac {
+
+/*
+ * An integer constant of a given width and signedness.
+ *
+ * Every builtin type fits in 64 bits, so the value is a plain u64, sign extended for
+ * signed constants and zero extended for unsigned ones; bool is an unsigned constant of
+ * width 1. Only constants wider than 64 bits are held in an APSInt.
+ */
+class ConstInt {
+public:
+    ConstInt(u64 bits, u32 width, bool is_signed);
+    explicit ConstInt(const llvm::APSInt& value);
+
+    // the width and signedness of ty, which must be an integer or bool type
+    static ConstInt of_type(u64 bits, const QualType& ty);
+
+    u32 width() const { return bitwidth; }
+    bool is_signed() const { return sign; }
+    bool is_wide() const { return bitwidth > 64; }
+
+    // only for constants of at most 64 bits
+    u64 bits() const { DELTA_ASSERT(!is_wide()); return value; }
+    i64 sext() const { return (i64)bits(); }
+
+    bool is_zero() const { return is_wide() ? wide->isZero() : value == 0; }
+
+    // does not allocate for constants of at most 64 bits
+    llvm::APSInt to_apsint() const;
+
+    // the value converted to the width and signedness, wrapping around like an IntCast
+    ConstInt convert(u32 width, bool is_signed) const;
+
+private:
+    u64 value = 0;
+    u32 bitwidth = 0;
+    bool sign = false;
+    std::optional<llvm::APSInt> wide;
+};
+
+/*
+ * Folds integer constant expressions: literals and the unary, binary and cast
+ * expressions over them.
+ *
+ * Arithmetic wraps around at the width of the type like at run time; an operation whose
+ * exact result does not fit is still folded but recorded as an overflow. Operations on
+ * constants of at most 64 bits use the overflow builtins on u64 and i64, the APSInt
+ * operations are only the fallback for wider constants.
+ * Divisions by zero, the minimum value divided by -1 and shifts by the width or more
+ * are not constants, they are left for run time like in C, where the divisions trap.
+ *
+ * Sema folds bottom up while it builds expressions, so it only calls the single
+ * operation folds on operands that are already literals and never walks a tree twice.
+ */
+class ConstExprEvaluator {
+public:
+    // the value of the expression if it is an integer constant expression
+    // and not nested too deeply to walk
+    std::optional<ConstInt> evaluate(const Expr* expr);
+
+    // the result has the width and signedness of ty, the type of the expression
+    std::optional<ConstInt> fold_binary(BinaryOp op, const ConstInt& lhs, const ConstInt& rhs, const QualType& ty);
+    std::optional<ConstInt> fold_unary(UnaryOp op, const ConstInt& operand, const QualType& ty);
+    std::optional<ConstInt> fold_cast(CastExpr::CastKind kind, const ConstInt& operand, const QualType& ty);
+
+    // the value of a literal, or of a literal in parentheses
+    static std::optional<ConstInt> literal_value(const Expr* expr);
+
+    // true if some folded operation wrapped around since the last reset
+    bool has_overflowed() const { return overflowed; }
+    void reset_overflow() { overflowed = false; }
+
+private:
+    std::optional<ConstInt> fold_wide_binary(BinaryOp op, const ConstInt& lhs, const ConstInt& rhs, const QualType& ty);
+
+private:
+    bool overflowed = false;
+};
+
+}
@@ -1,54 +1,113 @@
 #pragma once
 
 #include "expression.hpp"
+#include "identifiertable.hpp"
 #include "ownership.hpp"
+#include "sourcemanager.hpp"
+#include "statistic.hpp"
 #include "typeinfo.hpp"
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 
+#include <atomic>
 #include <optional>
 #include <string>
 #include <utility>
 
 namespace deltac {
 
+class ASTContext;
+class Stmt;
+
 class Decl {
 public:
-    Decl() = default;
+    // concrete classes, abstract classes cover a contiguous range
+    enum DeclKind : u8 {
+        VarDeclKind,
+        FuncDeclKind,
+        TypeDeclKind,
+
+        FirstNamedDecl = VarDeclKind,
+        LastNamedDecl = TypeDeclKind,
+
+        NumDeclKinds = TypeDeclKind + 1,
+    };
+
+public:
+    Decl(DeclKind kind) : kind(kind) {
+        if (stats::is_enabled()) {
+            count_node(kind);
+        }
+    }
+    Decl(const Decl&) = delete;
+    Decl(Decl&&) = delete;
     virtual ~Decl() = 0;
 
+    // statistics of the nodes created per kind
+    static void count_node(DeclKind kind);
+
+    // declarations live in the arena of ASTContext, create them with new (ctx) Decl(...)
+    void* operator new(usize bytes, const ASTContext& ctx, usize align = 8);
+    void operator delete(void*, const ASTContext&, usize) noexcept {}
+    void* operator new(usize bytes) = delete;
+    // the memory is released together with the arena
+    void operator delete(void*) noexcept {}
+
     virtual std::string get_decl_repr() = 0;
+
+    DeclKind decl_kind() const { return kind; }
+
+    // the location of the declared name
+    SourceLocation location() const { return loc; }
+    void set_location(SourceLocation l) { loc = l; }
+
+private:
+    DeclKind kind;
+    SourceLocation loc;
 };
 
 class NamedDecl : public Decl {
 public:
-    NamedDecl(std::string identifier) :
-        identifier(std::move(identifier)) {}
+    NamedDecl(DeclKind kind, IdentifierInfo* identifier) :
+        Decl(kind), identifier(identifier) {
+        DELTA_ASSERT(identifier != nullptr);
+    }
     
     NamedDecl(const Decl&) = delete;
     NamedDecl(Decl&&) = delete;
     virtual ~NamedDecl() = 0;
 
+    static bool classof(const Decl* d) {
+        return d->decl_kind() >= FirstNamedDecl && d->decl_kind() <= LastNamedDecl;
+    }
+
     virtual std::string get_decl_repr() = 0;
 
-    std::string_view get_identifier() { return identifier; }
+    std::string_view get_identifier() const { return identifier->name(); }
+
+    IdentifierInfo* get_identifier_info() const { return identifier; }
 
 private:
-    std::string identifier;
+    IdentifierInfo* identifier;
 };
 
 inline Decl::~Decl() = default;
 
+inline NamedDecl::~NamedDecl() = default;
+
 class VarDecl : public NamedDecl {
 public:
-    VarDecl(std::string identifier, Expr* expr) : 
-        NamedDecl(std::move(identifier)), type(expr->type()), expr(expr) {}
+    VarDecl(IdentifierInfo* identifier, Expr* expr) : 
+        NamedDecl(VarDeclKind, identifier), type(expr->type()), expr(expr) {}
 
-    VarDecl(std::string identifier, QualType type, Expr* expr = nullptr) : 
-        NamedDecl(std::move(identifier)), type(std::move(type)), expr(expr) {}
+    VarDecl(IdentifierInfo* identifier, QualType type, Expr* expr = nullptr) : 
+        NamedDecl(VarDeclKind, identifier), type(std::move(type)), expr(expr) {}
 
     ~VarDecl() override = default;
 
+    static bool classof(const Decl* d) { return d->decl_kind() == VarDeclKind; }
+
     std::string get_decl_repr() override {
         return 
             "let " + 
@@ -64,7 +123,6 @@ public:
     Expr* get_expr() { return expr; }
     
     void reset_expr(Expr* e = nullptr) { 
-        delete expr;
         this->expr = e;
     }
 
@@ -76,12 +134,86 @@ private:
 };
 
 struct Parameter {
-    std::string name;
+    Parameter(IdentifierInfo* name, QualType type) : name(name), type(type) {}
+
+    IdentifierInfo* name;
     QualType type;
 };
 
-class FuncDecl;
+/*
+ * Function declaration, with a body if it is a definition.
+ * type is always a FunctionType.
+ */
+class FuncDecl : public NamedDecl {
+public:
+    // params must outlive the declaration, Sema copies them into the arena
+    FuncDecl(IdentifierInfo* identifier, QualType type, llvm::ArrayRef<Parameter> params, Stmt* body = nullptr) :
+        NamedDecl(FuncDeclKind, identifier), type(type), params(params), body(body) {}
 
-class TypeDecl;
+    ~FuncDecl() override = default;
+
+    static bool classof(const Decl* d) { return d->decl_kind() == FuncDeclKind; }
+
+    std::string get_decl_repr() override {
+        std::string ret = "fn " + (std::string)get_identifier() + "(";
+
+        for (usize i = 0; i < params.size(); i++) {
+            ret += (i == 0 ? "" : ", ") + (std::string)params[i].name->name() + ": " + params[i].type.repr();
+        }
+
+        return ret + ") -> " + return_type().repr() + (has_body() ? " {...}" : ";");
+    }
+
+    const QualType& decl_type() const { return type; }
+
+    QualType return_type() const { return util::cast<FunctionType>(type.raw_type())->return_type(); }
+
+    llvm::ArrayRef<Parameter> parameters() const { return params; }
+
+    // the parameters as variables of the body, in order, once the body is entered
+    llvm::ArrayRef<VarDecl*> param_decls() const { return param_vars; }
+    // vars must outlive the declaration
+    void set_param_decls(llvm::ArrayRef<VarDecl*> vars) { param_vars = vars; }
+
+    Stmt* get_body() const { return body; }
+    void set_body(Stmt* s) { body = s; }
+
+    bool has_body() const { return body != nullptr; }
+
+    // the parser skipped the body, it is parsed when it is needed
+    // such a function is neither defined nor external until then
+    // read by the threads parsing other bodies while the thread parsing this one clears it
+    bool is_body_pending() const { return body_pending.load(std::memory_order_relaxed); }
+    void set_body_pending(bool pending) { body_pending.store(pending, std::memory_order_relaxed); }
+
+private:
+    QualType type;
+    llvm::ArrayRef<Parameter> params;
+    llvm::ArrayRef<VarDecl*> param_vars;
+    Stmt* body;
+    std::atomic<bool> body_pending = false;
+};
+
+/*
+ * A name declared as a type.
+ */
+class TypeDecl : public NamedDecl {
+public:
+    TypeDecl(IdentifierInfo* identifier, QualType type) : 
+        NamedDecl(TypeDeclKind, identifier), type(type) {}
+
+    ~TypeDecl() override = default;
+
+    static bool classof(const Decl* d) { return d->decl_kind() == TypeDeclKind; }
+
+    std::string get_decl_repr() override {
+        return "type " + (std::string)get_identifier() + " = " + type.repr() + ";";
+    }
+
+    const QualType& decl_type() const { return type; }
+
+private:
+    QualType type;
+};
 
 } // namespace deltac
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "sourcemanager.hpp"
+#include "utils.hpp"
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace deltac {
+
+namespace diag {
+
+enum Kind : u16 {
+#define DIAG(ID, LEVEL, TEXT) ID,
+#include "diagnostic_kinds.inc"
+};
+
+enum Level : u8 {
+    Warning,
+    Error,
+};
+
+Level level(Kind kind);
+
+}
+
+/*
+ * Collects the diagnostics of one translation unit, or of the part of it one thread
+ * analyses.
+ *
+ * The kinds, their level and their text are listed in diagnostic_kinds.inc. A report
+ * formats the text right away, so arguments only have to live until it returns, and
+ * stores it with the location; nothing is printed until the driver resolves the
+ * locations, which keeps the output of parallel passes in a deterministic order.
+ * Not thread safe, every thread reports into an engine of its own.
+ */
+class DiagnosticsEngine {
+public:
+    struct Diagnostic {
+        SourceLocation location;
+        diag::Kind kind;
+        std::string message;
+
+        diag::Level level() const { return diag::level(kind); }
+    };
+
+public:
+    DiagnosticsEngine() = default;
+    DiagnosticsEngine(const DiagnosticsEngine&) = delete;
+    DiagnosticsEngine(DiagnosticsEngine&&) = default;
+
+    // %<n> in the text of kind is replaced by args[n]
+    void report(SourceLocation loc, diag::Kind kind, std::initializer_list<std::string_view> args = {});
+
+    bool has_errors() const { return num_errors != 0; }
+    usize error_count() const { return num_errors; }
+
+    // in the order they were reported
+    const std::vector<Diagnostic>& diagnostics() const { return diags; }
+
+    // moves the diagnostics reported into other since it had first of them to the end
+    void take(DiagnosticsEngine& other, usize first = 0);
+    // moves all the diagnostics of other before the one at position
+    void insert(usize position, DiagnosticsEngine& other);
+    // keeps the diagnostics up to the first error, the ones a pass stopping there reports
+    void drop_after_first_error();
+    // keeps the first count diagnostics
+    void truncate(usize count);
+
+    void clear();
+
+    // "file:line:column: error: message", the file alone for the invalid location
+    static std::string format(const Diagnostic& d, const SourceManager& sources, std::string_view file);
+
+private:
+    std::vector<Diagnostic> diags;
+    usize num_errors = 0;
+};
+
+}
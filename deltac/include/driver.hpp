@@ -0,0 +1,110 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace deltac {
+
+// what is written for each translation unit
+enum class OutputKind : u8 {
+    // -fsyntax-only, nothing
+    None,
+    // -c, the default
+    Object,
+    // -emit-llvm, textual LLVM IR
+    LLVMIR,
+    // --run, nothing, main is run in the compiler process
+    Run,
+    // -emit-bytecode, the disassembly of the bytecode
+    Bytecode,
+    // --interpret, nothing, main is run by the bytecode interpreter
+    Interpret,
+};
+
+// false for the output kinds that never lower to LLVM IR
+inline bool uses_llvm(OutputKind kind) {
+    return kind == OutputKind::Object || kind == OutputKind::LLVMIR || kind == OutputKind::Run;
+}
+
+// true if main is run in the compiler process
+inline bool runs_main(OutputKind kind) {
+    return kind == OutputKind::Run || kind == OutputKind::Interpret;
+}
+
+struct DriverOptions {
+    std::vector<std::string> inputs;
+
+    OutputKind output_kind = OutputKind::Object;
+    // n of -O<n>, 0 to 3
+    unsigned opt_level = 0;
+    // empty to name the output after the input, only allowed with a single input
+    std::string output_path;
+    // the arguments after the input file of --run and --interpret, passed to main after the file name
+    std::vector<std::string> program_args;
+
+    // translation units compiled at the same time, 0 for one per hardware thread
+    unsigned jobs = 0;
+
+    // empty if -ftime-trace is not given
+    std::string time_trace_path;
+    unsigned time_trace_granularity = 500;
+
+    bool print_stats = false;
+    // empty if -stats-json is not given
+    std::string stats_json_path;
+};
+
+// diagnostics and outcome of one translation unit
+struct CompileResult {
+    bool success = true;
+    std::string diagnostics;
+    // returned by main with --run and --interpret
+    int exit_code = 0;
+};
+
+/*
+ * Compiles every input file as its own translation unit.
+ *
+ * Translation units share nothing mutable: each one owns its SourceBuffer, SourceManager,
+ * ASTContext (and with it the identifier and symbol tables), so they are compiled by a
+ * pool of worker threads that take the next file as soon as they are done with one.
+ * Diagnostics are buffered per translation unit and printed in the order of the inputs,
+ * each as soon as all the files before it are finished, so the output does not depend
+ * on the scheduling.
+ * A single input is lexed with the parallel lexer and its function bodies are parsed
+ * by all the threads instead.
+ * Function bodies are skipped by the declaration pass and parsed after it; --run and
+ * --interpret only parse the bodies main can reach, so unused functions cost a brace scan.
+ * Every translation unit is lowered to its own LLVM module in its own LLVMContext,
+ * so code generation and optimization run on the workers as well.
+ */
+class Driver {
+public:
+    explicit Driver(DriverOptions options);
+
+    // returns the options, or writes the usage error to err
+    static std::optional<DriverOptions> parse_args(int argc, const char* const* argv, std::ostream& err);
+
+    static void print_help(std::ostream& os);
+
+    // returns the exit code of the compiler, diagnostics go to diag
+    int run(std::ostream& diag);
+
+    // threads is the number of threads lexing the file and parsing its function bodies
+    static CompileResult compile_file(const std::string& path, const DriverOptions& options, unsigned threads);
+
+    // the input file name in the working directory, with the extension of the output kind
+    static std::string default_output_path(const std::string& input, OutputKind kind);
+
+private:
+    unsigned job_count() const;
+
+private:
+    DriverOptions options;
+};
+
+}
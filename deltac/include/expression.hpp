@@ -1,10 +1,12 @@
 #pragma once
 
+#include "sourcemanager.hpp"
+#include "statistic.hpp"
 #include "token.hpp"
 #include "tokentype.hpp"
+#include "identifiertable.hpp"
 #include "typeinfo.hpp"
 #include "utils.hpp"
-#include "typeinfo.hpp"
 #include "operators.hpp"
 #include "ownership.hpp"
 
@@ -12,9 +14,11 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/TrailingObjects.h"
 
 #include <cstdint>
 #include <cstddef>
+#include <memory>
 #include <optional>
 #include <utility>
 #include <string>
@@ -23,22 +27,67 @@
 
 namespace deltac {
 
+class ASTContext;
+class NamedDecl;
+
 // there should not be something like a const Expr*
 // constness is enforced by getter/setters
 class Expr {
 public:
-    enum ValCate {
+    enum ValCate : u8 {
         RValue,
         LValue,
         Unclassified,
     };
 
+    // concrete classes, abstract classes cover a contiguous range
+    enum ExprKind : u8 {
+        BinaryExprKind,
+        UnaryExprKind,
+        CallExprKind,
+        IndexExprKind,
+        ImplicitCastExprKind,
+        ExplicitCastExprKind,
+        IdExprKind,
+        IntLiteralExprKind,
+        ParenExprKind,
+        AssignExprKind,
+
+        FirstPostfixExpr = CallExprKind,
+        LastPostfixExpr = IndexExprKind,
+        FirstCastExpr = ImplicitCastExprKind,
+        LastCastExpr = ExplicitCastExprKind,
+
+        NumExprKinds = AssignExprKind + 1,
+    };
+
 public:
-    Expr(QualType type, ValCate valcate) : exprtype(std::move(type)), valcate(valcate) {}
+    Expr(ExprKind kind, QualType type, ValCate valcate) : exprtype(std::move(type)), kind(kind), valcate(valcate) {
+        if (stats::is_enabled()) {
+            count_node(kind);
+        }
+    }
     Expr(const Expr&) = delete;
     Expr(Expr&&) = delete;
     virtual ~Expr() = 0;
 
+    // statistics of the nodes created per kind
+    static void count_node(ExprKind kind);
+
+    // expressions live in the arena of ASTContext, create them with new (ctx) Expr(...)
+    // sub-expressions are not owned by their parent
+    void* operator new(usize bytes, const ASTContext& ctx, usize align = 8);
+    void operator delete(void*, const ASTContext&, usize) noexcept {}
+    void* operator new(usize bytes) = delete;
+    // the memory is released together with the arena
+    void operator delete(void*) noexcept {}
+
+    ExprKind expr_kind() const { return kind; }
+
+    // the location of the token that best identifies the expression, e.g. its operator
+    SourceLocation location() const { return loc; }
+    void set_location(SourceLocation l) { loc = l; }
+
     bool is_rval() const {
         return valcate == RValue;
     }
@@ -79,9 +128,15 @@ public:
         return exprtype;
     }
 
+    const QualType& type() const {
+        return exprtype;
+    }
+
 private:
     QualType exprtype;
+    ExprKind kind;
     ValCate valcate = Unclassified;
+    SourceLocation loc;
 };
 
 inline Expr::~Expr() = default;
@@ -89,16 +144,18 @@ inline Expr::~Expr() = default;
 class BinaryExpr : public Expr {
 public:
     BinaryExpr(QualType type, Expr::ValCate valcate, Expr* lhs, BinaryOp op, Expr* rhs) : 
-        Expr(std::move(type), valcate), exprs { lhs, rhs }, op(op) {}
+        Expr(BinaryExprKind, std::move(type), valcate), exprs { lhs, rhs }, op(op) {}
+
+    ~BinaryExpr() override = default;
 
-    ~BinaryExpr() override { delete exprs[LHS]; delete exprs[RHS]; };
+    static bool classof(const Expr* e) { return e->expr_kind() == BinaryExprKind; }
 
     Expr* lhs() const { return exprs[LHS]; }
     void lhs(Expr* expr) { exprs[LHS] = expr; }
     Expr* rhs() const { return exprs[RHS]; }
     void rhs(Expr* expr) { exprs[RHS] = expr; }
 
-    BinaryOp op_code() { return op; }
+    BinaryOp op_code() const { return op; }
 
 private:
     enum { LHS, RHS, EXPR_END };
@@ -109,13 +166,17 @@ private:
 class UnaryExpr : public Expr {
 public:
     UnaryExpr(QualType type, ValCate valcate, UnaryOp op, Expr* expr) :
-        Expr(std::move(type), valcate), op(op), mainexpr(expr) {}
+        Expr(UnaryExprKind, std::move(type), valcate), op(op), mainexpr(expr) {}
 
-    ~UnaryExpr() override { delete mainexpr; };
+    ~UnaryExpr() override = default;
+
+    static bool classof(const Expr* e) { return e->expr_kind() == UnaryExprKind; }
 
     Expr* expr() const { return mainexpr; }
     void expr(Expr* expr) { mainexpr = expr; }
 
+    UnaryOp op_code() const { return op; }
+
 private:
     UnaryOp op;
     Expr* mainexpr;
@@ -123,10 +184,14 @@ private:
 
 class PostfixExpr : public Expr {
 public:
-    PostfixExpr(QualType type, ValCate valcate, Expr* expr) :
-        Expr(std::move(type), valcate), mainexpr(expr) {}
+    PostfixExpr(ExprKind kind, QualType type, ValCate valcate, Expr* expr) :
+        Expr(kind, std::move(type), valcate), mainexpr(expr) {}
     ~PostfixExpr() override = 0;
 
+    static bool classof(const Expr* e) {
+        return e->expr_kind() >= FirstPostfixExpr && e->expr_kind() <= LastPostfixExpr;
+    }
+
     Expr* expr() const { return mainexpr; }
     void expr(Expr* expr) { mainexpr = expr; }
 
@@ -136,25 +201,38 @@ private:
 
 inline PostfixExpr::~PostfixExpr() = default;
 
-class CallExpr : public PostfixExpr {
-public:
-    CallExpr(QualType type, ValCate valcate, Expr* expr, llvm::ArrayRef<Expr*> arguments) : 
-        PostfixExpr(std::move(type), valcate, expr), args(arguments) {}
+// the arguments are stored right after the node, in the same allocation
+class CallExpr final : public PostfixExpr, private llvm::TrailingObjects<CallExpr, Expr*> {
+private:
+    friend TrailingObjects;
 
-    ~CallExpr() override {
-        util::cleanup_ptrs(args.begin(), args.end());
+    CallExpr(QualType type, ValCate valcate, Expr* expr, llvm::ArrayRef<Expr*> arguments) : 
+        PostfixExpr(CallExprKind, std::move(type), valcate, expr), num_args((u32)arguments.size()) {
+        std::uninitialized_copy(arguments.begin(), arguments.end(), getTrailingObjects<Expr*>());
     }
 
+public:
+    static CallExpr* create(const ASTContext& ctx, QualType type, ValCate valcate, Expr* expr,
+                            llvm::ArrayRef<Expr*> arguments);
+
+    ~CallExpr() override = default;
+
+    static bool classof(const Expr* e) { return e->expr_kind() == CallExprKind; }
+
+    llvm::ArrayRef<Expr*> arguments() const { return { getTrailingObjects<Expr*>(), num_args }; }
+
 private:
-    llvm::SmallVector<Expr*> args;
+    u32 num_args;
 };
 
 class IndexExpr : public PostfixExpr {
 public:
     IndexExpr(QualType type, ValCate valcate, Expr* expr, Expr* index) : 
-        PostfixExpr(std::move(type), valcate, expr), index(index) {}
+        PostfixExpr(IndexExprKind, std::move(type), valcate, expr), index(index) {}
+
+    ~IndexExpr() override = default;
 
-    ~IndexExpr() override { delete index; }
+    static bool classof(const Expr* e) { return e->expr_kind() == IndexExprKind; }
 
 private:
     Expr* index;
@@ -178,11 +256,15 @@ public:
     };
 
 public:
-    CastExpr(Expr* e, QualType ty, CastKind op, bool is_part_of_explcast) : 
-        Expr(std::move(ty), RValue), expr(e), 
+    CastExpr(ExprKind ekind, Expr* e, QualType ty, CastKind op, bool is_part_of_explcast) : 
+        Expr(ekind, std::move(ty), RValue), expr(e), 
         kind(op), is_part_of_explcast(is_part_of_explcast) {}
 
-    ~CastExpr() override { delete expr; }
+    ~CastExpr() override = default;
+
+    static bool classof(const Expr* e) {
+        return e->expr_kind() >= FirstCastExpr && e->expr_kind() <= LastCastExpr;
+    }
 
     CastKind op_code() const { return kind; }
 
@@ -204,22 +286,36 @@ private:
 
 class ImplicitCastExpr : public CastExpr {
 public:
-    ImplicitCastExpr(Expr* expr, QualType t, CastKind op) : CastExpr(expr, std::move(t), op, true) {}
+    ImplicitCastExpr(Expr* expr, QualType t, CastKind op) : 
+        CastExpr(ImplicitCastExprKind, expr, std::move(t), op, true) {}
+
+    static bool classof(const Expr* e) { return e->expr_kind() == ImplicitCastExprKind; }
 };
 
 class ExplicitCastExpr : public CastExpr {
 public:
-    ExplicitCastExpr(Expr* expr, QualType t, CastKind op) : CastExpr(expr, std::move(t), op, false) {}
+    ExplicitCastExpr(Expr* expr, QualType t, CastKind op) : 
+        CastExpr(ExplicitCastExprKind, expr, std::move(t), op, false) {}
+
+    static bool classof(const Expr* e) { return e->expr_kind() == ExplicitCastExprKind; }
 };
 
 class IdExpr : public Expr {
 public:
-    IdExpr(QualType type, std::string_view id) : 
-        Expr(std::move(type), ValCate::LValue), identifier(id) {}
+    IdExpr(QualType type, IdentifierInfo* id, NamedDecl* decl) : 
+        Expr(IdExprKind, std::move(type), ValCate::LValue), identifier(id), decl(decl) {}
     ~IdExpr() override = default;
 
+    static bool classof(const Expr* e) { return e->expr_kind() == IdExprKind; }
+
+    IdentifierInfo* get_identifier_info() const { return identifier; }
+
+    // the declaration the name was resolved to
+    NamedDecl* get_decl() const { return decl; }
+
 private:
-    std::string identifier;
+    IdentifierInfo* identifier;
+    NamedDecl* decl;
 };
 
 class IntLiteralExpr : public Expr {
@@ -231,22 +327,30 @@ public:
         bool is_unsigned = true,
         u8 radix = 10
     ) : 
-        Expr(std::move(type), RValue), data(llvm::APInt(numbits, literalrepr, radix), is_unsigned) {}
+        Expr(IntLiteralExprKind, std::move(type), RValue), data(llvm::APInt(numbits, literalrepr, radix), is_unsigned) {}
 
     IntLiteralExpr(QualType type, llvm::APSInt data, bool is_unsigned = true) : 
-        Expr(std::move(type), RValue), data(std::move(data), is_unsigned) {}
+        Expr(IntLiteralExprKind, std::move(type), RValue), data(std::move(data), is_unsigned) {}
     
     ~IntLiteralExpr() override = default;
 
+    static bool classof(const Expr* e) { return e->expr_kind() == IntLiteralExprKind; }
+
+    const llvm::APSInt& get_value() const { return data; }
+
 private:
     llvm::APSInt data;
 };
 
 class ParenExpr : public Expr {
 public:
-    ParenExpr(Expr* expr) : Expr(expr->type(), expr->value()), expr(expr) {}
+    ParenExpr(Expr* expr) : Expr(ParenExprKind, expr->type(), expr->value()), expr(expr) {}
+
+    ~ParenExpr() override = default;
+
+    static bool classof(const Expr* e) { return e->expr_kind() == ParenExprKind; }
 
-    ~ParenExpr() override { delete expr; }
+    Expr* sub_expr() const { return expr; }
 
 private:
     Expr* expr;
@@ -255,9 +359,16 @@ private:
 class AssignExpr : public Expr {
 public:
     AssignExpr(Expr* lhs, AssignOp op, Expr* rhs) : 
-        Expr(rhs->type(), LValue), exprs { lhs, rhs }, op(op) {}
+        Expr(AssignExprKind, rhs->type(), LValue), exprs { lhs, rhs }, op(op) {}
+
+    ~AssignExpr() override = default;
+
+    static bool classof(const Expr* e) { return e->expr_kind() == AssignExprKind; }
+
+    Expr* lhs() const { return exprs[LHS]; }
+    Expr* rhs() const { return exprs[RHS]; }
 
-    ~AssignExpr() { delete exprs[LHS]; delete exprs[RHS]; }
+    AssignOp op_code() const { return op; }
 
 private:
     enum { LHS, RHS, EXPR_END };
@@ -4,28 +4,59 @@
 
 #include <iostream>
 #include <fstream>
+#include <string>
 #include <string_view>
 #include <filesystem>
 
 namespace deltac {
 
+/*
+ * Owns the source text of a single file.
+ * The text is always followed by at least PADDING zero bytes, so the lexer
+ * may read past the null terminator with wide loads without bounds checks.
+ * Files are memory mapped where possible, streams (e.g. stdin) are copied.
+ */
 class SourceBuffer {
 public:
-    using const_iterator = std::string::const_iterator;
+    using const_iterator = const char*;
+
+    // number of zero bytes guaranteed to follow the last character
+    static constexpr usize PADDING = 64;
 
 public:
     explicit SourceBuffer(std::string_view path_name) noexcept(false);
     explicit SourceBuffer(std::istream& input);
-    const_iterator cbegin() const { return buffer.cbegin(); }
-    const_iterator cend() const { return buffer.cend(); }
-    const char* ptr_cbegin() const { return &buffer.front(); }
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer(SourceBuffer&&) = delete;
+
+    ~SourceBuffer();
+
+    const_iterator cbegin() const { return start; }
+    const_iterator cend() const { return start + length; }
+    const char* ptr_cbegin() const { return start; }
     // points the the next position passing null terminate character
-    const char* ptr_cend() const { return &buffer.back() + 2; }
-    usize size() const { return buffer.size(); }
+    const char* ptr_cend() const { return start + length + 1; }
+    usize size() const { return length; }
     std::string name() const { return file_path.filename().string(); }
 
+    bool is_mapped() const { return mapping != nullptr; }
+
 private:
+    bool map_file();
+    void read_stream(std::istream& input);
+
+private:
+    const char* start = nullptr;
+    usize length = 0;
+
+    // backing storage when the file is mapped
+    void* mapping = nullptr;
+    usize mapping_size = 0;
+
+    // backing storage when the content is read from a stream
     std::string buffer;
+
     std::filesystem::path file_path;
 };
 
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace deltac {
+
+/*
+ * The unique entry of an identifier spelling.
+ * Two identifiers are equal iff their IdentifierInfo pointers are equal.
+ * The spelling is owned by the IdentifierTable, not by the source buffer.
+ */
+class IdentifierInfo {
+public:
+    IdentifierInfo(const IdentifierInfo&) = delete;
+    IdentifierInfo(IdentifierInfo&&) = delete;
+
+    std::string_view name() const { return { spelling, length }; }
+
+    u32 hash() const { return hash_value; }
+
+    // dense index in the order of interning, see IdentifierTable::info
+    u32 id() const { return ident_id; }
+
+private:
+    friend class IdentifierTable;
+
+    IdentifierInfo(const char* spelling, u32 length, u32 hash, u32 id) :
+        spelling(spelling), length(length), hash_value(hash), ident_id(id) {}
+
+private:
+    const char* spelling;
+    u32 length;
+    u32 hash_value;
+    u32 ident_id;
+};
+
+/*
+ * Interns identifier spellings.
+ * The hash is FNV-1a, exposed as hash_step so the lexer can compute it while it
+ * scans the identifier and intern without reading the bytes a second time.
+ * Entries are allocated in blocks and are never freed before the table.
+ * Not thread safe; parallel lexing interns each chunk into a table of its own and
+ * merges the tables in token order when the chunks are stitched.
+ */
+class IdentifierTable {
+public:
+    static constexpr u32 HASH_SEED = 2166136261u;
+
+    static constexpr u32 hash_step(u32 hash, char c) {
+        return (hash ^ (unsigned char)c) * 16777619u;
+    }
+
+    static constexpr u32 hash(std::string_view name) {
+        u32 h = HASH_SEED;
+
+        for (char c : name) {
+            h = hash_step(h, c);
+        }
+
+        return h;
+    }
+
+    static constexpr u32 NO_IDENT = ~u32(0);
+
+public:
+    IdentifierTable();
+    IdentifierTable(const IdentifierTable&) = delete;
+    IdentifierTable(IdentifierTable&&) = default;
+    IdentifierTable& operator =(IdentifierTable&&) = default;
+
+    // the entry of name, created if needed; hash must be hash(name)
+    IdentifierInfo* get(std::string_view name, u32 hash);
+
+    IdentifierInfo* get(std::string_view name) { return get(name, hash(name)); }
+
+    // the entry of name, or nullptr if it was never interned
+    IdentifierInfo* find(std::string_view name) const;
+
+    IdentifierInfo* info(u32 id) const { return infos[id]; }
+
+    usize size() const { return infos.size(); }
+
+    // bytes held by the entries and the hash table
+    usize memory_usage() const;
+
+private:
+    u32 find_slot(std::string_view name, u32 hash) const;
+
+    void grow();
+
+    void* allocate(usize bytes);
+
+private:
+    static constexpr usize BLOCK_SIZE = 64 * 1024;
+
+    std::vector<IdentifierInfo*> slots;
+    std::vector<IdentifierInfo*> infos;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* block_curr = nullptr;
+    char* block_end = nullptr;
+    usize block_bytes = 0;
+};
+
+}
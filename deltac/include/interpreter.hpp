@@ -0,0 +1,61 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "utils.hpp"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace deltac {
+
+/*
+ * Runs bytecode modules.
+ *
+ * The dispatch loop jumps from the end of each handler straight to the handler of the
+ * next instruction through a table of label addresses (computed goto), so every handler
+ * has its own indirect branch for the predictor to learn. Compilers without labels as
+ * values get a switch in a loop instead.
+ * All register windows live in one stack; a call pushes a frame with the return
+ * address and slides the window up to the arguments, a return slides it back.
+ *
+ * There is no compilation step before the first instruction runs, so a short script
+ * finishes before the JIT would have compiled its main.
+ */
+class Interpreter {
+public:
+    static constexpr usize DEFAULT_STACK_SIZE = 1 << 20;
+    static constexpr usize MAX_CALL_DEPTH = 1 << 18;
+
+public:
+    // stack_size is the number of registers of all the active calls together
+    explicit Interpreter(const bc::Module& module, usize stack_size = DEFAULT_STACK_SIZE);
+
+    // runs functions[function] with args and returns its result, 0 for a void function
+    // fails on division by zero, on the minimum value divided by -1 and on stack overflow,
+    // where native code would trap
+    std::optional<u64> call(u32 function, llvm::ArrayRef<u64> args, std::string& error);
+
+    // runs the global initializers and main like jit::run_main
+    std::optional<int> run_main(const std::vector<std::string>& args, std::string& error);
+
+private:
+    struct Frame {
+        const bc::Instr* code;
+        const bc::Instr* return_pc;
+        u64* registers;
+    };
+
+    const bc::Module& module;
+    std::vector<u64> globals;
+    // not zeroed, every register is written before it is read, so only the pages the
+    // program touches are ever mapped
+    std::unique_ptr<u64[]> stack;
+    usize stack_size;
+    std::vector<Frame> frames;
+};
+
+}
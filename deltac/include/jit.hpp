@@ -0,0 +1,30 @@
+#pragma once
+
+#include "codegen.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace deltac {
+
+/*
+ * Runs a translation unit inside the compiler process with ORC.
+ *
+ * The module goes to an LLLazyJIT, which compiles each function the first time it is
+ * called, so a program starts once main is compiled and functions that are never
+ * called are never compiled. Symbols without a definition in the module, such as the
+ * C library functions a program declares, are resolved in the compiler process.
+ * The global constructors of the module run before main.
+ */
+namespace jit {
+
+// releases the module of codegen, which must have generated it successfully
+// main is fn main() i32, fn main() or fn main(argc i32, argv **u8) i32
+// args are passed as argv, the first one is the program name
+// returns the exit code of main, 0 for a void main
+std::optional<int> run_main(CodeGen& codegen, const std::vector<std::string>& args, std::string& error);
+
+} // namespace jit
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "tokentype.hpp"
+#include "utils.hpp"
+
+#include <array>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+namespace deltac {
+
+namespace _impl {
+
+struct KeywordEntry {
+    std::string_view spelling;
+    tok::Kind kind;
+};
+
+inline constexpr KeywordEntry keywords[] = {
+#define KEYWORD(X, Y) { Y, tok::X },
+#include "tokentype.inc"
+};
+
+inline constexpr u32 KW_TABLE_BITS = 5;
+inline constexpr usize KW_TABLE_SIZE = usize(1) << KW_TABLE_BITS;
+
+static_assert(std::size(keywords) <= KW_TABLE_SIZE, "too many keywords for the table");
+
+// s must not be empty
+constexpr u32 kw_slot(std::string_view s, u32 seed) {
+    u32 key =
+        (u32)(unsigned char)s.front() |
+        (u32)(unsigned char)s.back() << 8 |
+        (u32)s.size() << 16;
+
+    return (key * seed) >> (32 - KW_TABLE_BITS);
+}
+
+constexpr bool kw_is_perfect(u32 seed) {
+    bool used[KW_TABLE_SIZE] = {};
+
+    for (const KeywordEntry& e : keywords) {
+        u32 slot = kw_slot(e.spelling, seed);
+
+        if (used[slot]) {
+            return false;
+        }
+
+        used[slot] = true;
+    }
+
+    return true;
+}
+
+constexpr u32 kw_find_seed() {
+    // odd multipliers starting from the golden ratio
+    for (u32 seed = 0x9E3779B1u; seed != 0x9E3779B1u + 2 * 100000; seed += 2) {
+        if (kw_is_perfect(seed)) {
+            return seed;
+        }
+    }
+
+    return 0;
+}
+
+inline constexpr u32 KW_SEED = kw_find_seed();
+
+static_assert(KW_SEED != 0, "no perfect hash seed found for the keywords");
+
+constexpr std::array<KeywordEntry, KW_TABLE_SIZE> kw_build_table() {
+    std::array<KeywordEntry, KW_TABLE_SIZE> table = {};
+
+    for (usize i = 0; i < KW_TABLE_SIZE; i++) {
+        table[i] = { std::string_view(), tok::ERROR };
+    }
+
+    for (const KeywordEntry& e : keywords) {
+        table[kw_slot(e.spelling, KW_SEED)] = e;
+    }
+
+    return table;
+}
+
+constexpr usize kw_max_length() {
+    usize len = 0;
+
+    for (const KeywordEntry& e : keywords) {
+        len = e.spelling.size() > len ? e.spelling.size() : len;
+    }
+
+    return len;
+}
+
+}
+
+/*
+ * Perfect hash table of the KEYWORD entries in tokentype.inc.
+ * The table and the hash seed are computed at compile time, so a lookup is
+ * one multiplicative hash over (first char, last char, length) and one compare.
+ * No heap data is involved, and the table is safe to share between threads.
+ */
+class KeywordTable {
+private:
+    static constexpr std::array<_impl::KeywordEntry, _impl::KW_TABLE_SIZE> table = _impl::kw_build_table();
+
+    static constexpr usize MAX_LENGTH = _impl::kw_max_length();
+
+public:
+    // id must be a complete identifier
+    static constexpr std::optional<tok::Kind> lookup(std::string_view id) {
+        if (id.empty() || id.size() > MAX_LENGTH) {
+            return std::nullopt;
+        }
+
+        const _impl::KeywordEntry& e = table[_impl::kw_slot(id, _impl::KW_SEED)];
+
+        if (e.spelling == id) {
+            return e.kind;
+        }
+
+        return std::nullopt;
+    }
+};
+
+}
@@ -3,10 +3,15 @@
 #include "token.hpp"
 #include "tokentype.hpp"
 #include "charinfo.hpp"
+#include "diagnostics.hpp"
 #include "filebuffer.hpp"
-#include "keywordtrie.hpp"
+#include "identifiertable.hpp"
+#include "keywordtable.hpp"
+#include "statistic.hpp"
+#include "tokenbuffer.hpp"
 
 #include <string>
+#include <vector>
 #include <utility>
 #include <cassert>
 
@@ -14,19 +19,60 @@ namespace deltac {
 
 class Lexer {
 public:
-    explicit Lexer(const char* begin, const char* end);
+    // start is the location of begin if the range is registered in a SourceManager,
+    // tokens have invalid locations otherwise
+    explicit Lexer(const char* begin, const char* end, SourceLocation start = SourceLocation());
+    // lexes directly over the buffer, using its zero padding for wide loads
+    explicit Lexer(const SourceBuffer& buffer, SourceLocation start = SourceLocation());
     
-    bool lex(Token& result);
+    bool lex(Token& result) {
+        bool was_eof = is_eof();
+        bool ret = lex_token(result);
+
+        if (stats::is_enabled() && !was_eof) {
+            count_token(result.get_type());
+        }
+
+        return ret;
+    }
+
+    // identifiers are interned into table while lexing, the table must outlive the tokens
+    void set_identifier_table(IdentifierTable* table) { identifiers = table; }
+    IdentifierTable* identifier_table() const { return identifiers; }
+
+    // every ERROR token is reported into engine, at the location of the token
+    void set_diagnostics(DiagnosticsEngine* engine) { diags = engine; }
+
+    // lexes all remaining tokens into out, ending with EndOfFile
+    // returns false if any ERROR token was produced
+    bool lex_all(TokenBuffer& out);
+
+    // same as above, but large buffers are split into chunks lexed by up to num_threads threads
+    bool lex_all(TokenBuffer& out, unsigned num_threads);
+
+    // smallest chunk worth handing to another thread
+    static constexpr usize MIN_PARALLEL_CHUNK = usize(1) << 20;
     
     bool is_eof() const {
         return buffer_curr == buffer_end;
     }
     
 private:
-    static const KeywordTrie kwtrie;
+    bool lex_token(Token& result);
+    // statistics of tokens lexed one by one, lex_all counts its buffer at once
+    static void count_token(tok::Kind kind);
 
-private:
     void form_token(Token& result, const char* token_end, tok::Kind type);
+    // forms an ERROR token and reports kind at its start, always returns false
+    bool form_error(Token& result, const char* token_end, diag::Kind kind);
+
+    const char* skip_trivia(const char* curr_ptr) const;
+    const char* skip_line_comment(const char* curr_ptr) const;
+    const char* skip_block_comment(const char* curr_ptr) const;
+
+    // lexes tokens starting before stop
+    bool lex_chunk(TokenBuffer& out, const char* stop);
+    std::vector<const char*> find_chunk_starts(usize count) const;
 
     bool lex_numeric_literal(Token& result, const char* curr_ptr);
     bool lex_hex(Token& result, const char* curr_ptr);
@@ -42,6 +88,19 @@ private:
     // points the next character that is about to be lexed
     const char* buffer_curr;
 
+    // end of the readable memory, at or after buffer_end
+    // vectorized scans may load anything before this
+    const char* scan_end;
+
+    // null if identifiers are not interned
+    IdentifierTable* identifiers = nullptr;
+
+    // null if errors are only signalled by ERROR tokens
+    DiagnosticsEngine* diags = nullptr;
+
+    // location of buffer_start
+    SourceLocation start_loc;
+
     // friend int main();
 };
 
@@ -33,6 +33,7 @@ public:
 
 private:
     const char* const begin;
+    // one past the last character
     const char* const end;
 
     const char* digit_begin; 
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <array>
 #include <optional>
 #include <utility>
 
 #include "token.hpp"
 #include "tokentype.hpp"
+#include "utils.hpp"
 
 namespace deltac {
 
@@ -52,9 +54,41 @@ enum Binary {
 };
 }
 
-// std::strong_ordering operator <=>(BinopPrecedence lhs, BinopPrecedence rhs);
+enum class Assoc : u8 {
+    Left,
+    Right,
+};
+
+struct BinaryOperatorInfo {
+    BinaryOp op;
+    // Unknown for tokens that are not binary operators
+    prec::Binary precedence;
+    Assoc assoc;
+};
+
+namespace _impl {
+
+constexpr std::array<BinaryOperatorInfo, tok::NUM_KINDS> make_binary_operator_table() {
+    std::array<BinaryOperatorInfo, tok::NUM_KINDS> table = {};
+
+    for (BinaryOperatorInfo& info : table) {
+        info = { BinaryOp::Plus, prec::Unknown, Assoc::Left };
+    }
+
+#define BINARY_OPERATOR(X, OP, PREC, ASSOC) table[tok::X] = { BinaryOp::OP, prec::PREC, Assoc::ASSOC };
+#include "tokentype.inc"
 
-prec::Binary get_precedence(BinaryOp op);
+    return table;
+}
+
+inline constexpr std::array<BinaryOperatorInfo, tok::NUM_KINDS> binary_operators = make_binary_operator_table();
+
+}
+
+// the binary operator of the BINARY_OPERATOR entries in tokentype.inc, one load per token
+inline const BinaryOperatorInfo& binary_operator_info(tok::Kind kind) {
+    return _impl::binary_operators[kind];
+}
 
 enum class UnaryOp {
     Plus,
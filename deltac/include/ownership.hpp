@@ -12,7 +12,7 @@ inline constexpr class action_error_t {} action_error;
 
 class ActionErrorAccess : public std::exception {
 public:
-    const char* what() const override {
+    const char* what() const noexcept override {
         return "action_error accessed";
     }
 };
@@ -262,11 +262,6 @@ public:
         std::swap(ptr, other.ptr);
     }
 
-    void deletep() {
-        delete ptr;
-        reset();
-    }
-
     explicit operator bool() const { return is_usable(); }
 
     friend bool operator ==(const ActionResult& lhs, const ActionResult& rhs) {
@@ -7,38 +7,118 @@
 #include "filebuffer.hpp"
 #include "token.hpp"
 #include "lexer.hpp"
+#include "tokenbuffer.hpp"
+#include "tokentype.hpp"
 #include "utils.hpp"
 #include "astcontext.hpp"
 #include "sema.hpp"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
 #include <memory>
-#include <iterator>
-#include <functional>
+#include <vector>
 
 namespace deltac {
 
 class Parser {
 public:
     Parser(Lexer& lexer, Sema& s);
+    // walks a pre-lexed buffer, which must end with EndOfFile
+    Parser(const TokenBuffer& tokens, Sema& s);
 
     Parser(const Parser&) = delete;
     Parser(Parser&&) = delete;
 
+    // returns false at the end of the input or on error, is_eof() tells them apart
     bool parse_top_level_decl(Decl*& res);
 
+    bool is_eof() const { return curr_token.is(tok::EndOfFile); }
+
+    // location of the current token, where parsing stopped after an error
+    SourceLocation location() const { return curr_token.get_location(); }
+
+    /*
+     * Lazy function bodies, only when parsing from a TokenBuffer.
+     *
+     * The declaration pass records where each body starts and skips to its closing brace
+     * by counting braces over the token kinds, without building anything. A body is
+     * parsed and checked later like it would have been in place: it only sees the globals
+     * declared before it, and its diagnostics are moved to where the declaration pass
+     * skipped it, with everything after the first error dropped, so Sema::diagnostics()
+     * are those of parsing eagerly. After an error in a body, location() is the error.
+     */
+    void set_lazy_bodies(bool lazy) { lazy_bodies = lazy && tokens != nullptr; }
+
+    // parses the pending body of fn
+    bool parse_pending_body(FuncDecl* fn);
+    // parses the pending bodies of roots and of the functions referenced from any parsed
+    // code, transitively, the others stay pending
+    bool parse_referenced_bodies(llvm::ArrayRef<FuncDecl*> roots);
+    // parses every pending body, in the order of the file with one thread
+    // more threads each parse and check whole bodies with a Sema, a SymbolTable for the
+    // local scopes and an arena of their own, taking the largest remaining body next;
+    // the declarations are only read meanwhile, an error is the first one in the file
+    bool parse_pending_bodies(unsigned threads = 1);
+
 private:
+    struct PendingBody {
+        FuncDecl* fn;
+        // indices of the '{' and of the token after the '}' in tokens
+        usize first_token;
+        usize end_token;
+        // SymbolTable::size() at the body
+        usize visible_globals;
+        // the number of diagnostics when the body was skipped
+        usize diag_position;
+        // reported parsing the body, until they are moved to diag_position
+        DiagnosticsEngine diags;
+
+        usize size() const { return end_token - first_token; }
+    };
+
     TypeResult type();
     RawTypeResult raw_type();
 
     DeclResult declaration();
     DeclResult variable_declaration();
+    DeclResult function_declaration();
+    DeclResult function_body(FuncDecl* fn);
+    bool parse_body(PendingBody& pending);
+    bool parse_pending(FuncDecl* fn);
+    void merge_body_diagnostics();
+    // moves past the '}' matching the current '{'
+    bool skip_body();
     
     ParameterResult parameter();
 
-    template <typename It, typename Fn>
+    // a list parsed on top of a scratch stack of the parser, its elements are popped when
+    // it goes out of scope; a list nested in an element is pushed and popped above it
+    template <typename T>
+    class ScratchList {
+    public:
+        explicit ScratchList(llvm::SmallVectorImpl<T>& scratch) : scratch(scratch), first(scratch.size()) {}
+        ScratchList(const ScratchList&) = delete;
+        ~ScratchList() { scratch.truncate(first); }
+
+        void push_back(T elem) { scratch.push_back(std::move(elem)); }
+
+        // invalidated by the next push on the same scratch stack
+        llvm::MutableArrayRef<T> elements() { return llvm::MutableArrayRef<T>(scratch).drop_front(first); }
+
+    private:
+        llvm::SmallVectorImpl<T>& scratch;
+        usize first;
+    };
+
+    // parse_element is called for each element and returns an ActionResult
+    // the scratch stacks are reused by every list, so once they have grown to the longest
+    // list nesting seen parsing a list does not allocate
+    template <typename T, typename Fn>
     bool parse_list_of(
-        It out, 
-        Fn&& fn, 
+        ScratchList<T>& out, 
+        Fn&& parse_element, 
         tok::Kind start, 
         tok::Kind end,
         tok::Kind delimiter = tok::Comma, 
@@ -51,37 +131,38 @@ private:
 
         // do not accept empty but got an empty list
         if (!accept_empty && curr_token.is(end)) {
-            // TODO: error empty list
+            report(diag::ExpectedExpression);
             return false;
         }
 
         while (!curr_token.is(end)) {
             // parse the element
-            auto res = std::invoke(fn);
+            auto res = parse_element();
 
             if (!res) {
                 return false;
             }
 
-            *out++ = *res;
-
-            if (curr_token.is(delimiter)) {
-                advance();
+            out.push_back(*res);
 
-                if (curr_token.is(end) && allow_trailing_delim) {
-                    advance();
-                    return true;
-                }
-                else if (curr_token.is(end) && !allow_trailing_delim) {
-                    // TODO: diag no trailing delimiter
+            if (curr_token.is(end)) {
+                break;
+            }
 
-                    return false;
-                }
+            if (!advance_expected(delimiter)) {
+                return false;
+            }
 
-                // else continue to parse the next element
+            if (curr_token.is(end) && !allow_trailing_delim) {
+                report(diag::TrailingDelimiter, { token_type_name(delimiter) });
+                return false;
             }
+
+            // else continue to parse the next element
         }
 
+        advance(); // end
+
         return true;
     }
 
@@ -89,6 +170,8 @@ private:
     StmtResult compound_statement();
     StmtResult expression_statement();
     StmtResult return_statement();
+    StmtResult if_statement();
+    StmtResult declaration_statement();
 
     ExprResult expression();
     ExprResult primary_expression();
@@ -96,23 +179,50 @@ private:
     ExprResult postfix_expression();
     ExprResult unary_expression();
     ExprResult binary_expression();
-    ExprResult recursive_parse_binary_expression(prec::Binary);
     ExprResult assignment_expression();
 
+    // reports the missing token
     bool advance_expected(tok::Kind type);
     bool try_advance(tok::Kind type);
     void advance();
 
-    template <typename Fn, typename... Args>
-    auto bind_this(Fn&& fn, Args... args) {
-        return std::bind(fn, this, args...);
-    }
+    // at the current token
+    void report(diag::Kind kind, std::initializer_list<std::string_view> args = {});
+
+    /*
+     * Parsing and the lowering walks recurse once per block, if, unary operator,
+     * parenthesized or assigned expression and argument, so each of them checks the stack
+     * first (see stack.hpp). Binary expressions do not count, the parser builds them
+     * without recursion and the walks follow the left operands of a chain in a loop.
+     */
+    // reports the nesting as too deep if the stack is nearly exhausted
+    bool nest();
+
+    // lookahead and backtracking, only available when parsing from a TokenBuffer
+    bool has_token_buffer() const { return tokens != nullptr; }
+    tok::Kind peek_kind(usize n = 1) const;
+    usize save_position() const;
+    void restore_position(usize position);
 
 private:
-    Lexer& lexer;
+    // exactly one of lexer and tokens is set
+    Lexer* lexer = nullptr;
+    const TokenBuffer* tokens = nullptr;
+    // index of curr_token in tokens
+    usize token_idx = 0;
+
     Sema& action;
 
     Token curr_token;
+
+    // elements of the lists being parsed
+    llvm::SmallVector<Parameter, 8> param_scratch;
+    llvm::SmallVector<Expr*, 32> arg_scratch;
+
+    bool lazy_bodies = false;
+    // in the order of the file
+    std::vector<PendingBody> pending_bodies;
+    llvm::DenseMap<const FuncDecl*, usize> pending_body_index;
 };
 
 } // namespace deltac
@@ -1,13 +1,24 @@
 #include "expression.hpp"
 #include "declaration.hpp"
 #include "astcontext.hpp"
+#include "constexpr_evaluator.hpp"
+#include "diagnostics.hpp"
+#include "statement.hpp"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <vector>
 
 namespace deltac {
 
 class Sema;
 
+/*
+ * Builds a QualType from the prefix notation of the parser.
+ * Pointer layers are recorded outermost first and applied inside out
+ * once the base type is known, since uniqued types cannot be patched later.
+ */
 class TypeBuilder {
 public:
     TypeBuilder(Sema& action);
@@ -30,35 +41,99 @@ public:
 private:
     void reset_internal();
 
+    void wrap_ptr_layers();
+
 private:
     bool errored = false;
     bool finalized = false;
     QualType res;
-    QualType* base;
+    // constness of each pointer layer, outermost first
+    llvm::SmallVector<bool, 4> ptr_layers;
     Sema& action;
 };
 
 class Sema {
 public:
-    Sema(ASTContext& context) : context(context) {}
+    Sema(ASTContext& context) : context(context), symbols(&context.symbol_table()) {}
+    // for a thread analysing function bodies next to others, with a table of its own
+    // for the local scopes, see SymbolTable(const SymbolTable*)
+    Sema(ASTContext& context, SymbolTable& symbols) : context(context), symbols(&symbols) {}
     
+    ASTContext& ast_context() { return context; }
     const ASTContext& ast_context() const { return context; }
 
+    IdentifierTable& identifier_table() { return context.identifier_table(); }
+
+    // the parser enters and leaves the scopes, Sema declares into the current one
+    SymbolTable& symbol_table() { return *symbols; }
+
+    // every action that returns action_error has reported why
+    DiagnosticsEngine& diagnostics() { return diags; }
+    const DiagnosticsEngine& diagnostics() const { return diags; }
+
     ExprResult act_on_int_literal(const Token& tok, u8 posix, QualType* ty);
     ExprResult act_on_unary_expr(UnaryOp, Expr* expr);
+    ExprResult act_on_binary_expr(Expr* lhs, BinaryOp op, Expr* rhs);
+    ExprResult act_on_assignment_expr(Expr* lhs, AssignOp op, Expr* rhs);
+    ExprResult act_on_paren_expr(Expr* expr);
+    ExprResult act_on_id_expr(const Token& tok);
+    // args are converted in place, then copied into the call
+    ExprResult act_on_call_expr(Expr* callee, llvm::MutableArrayRef<Expr*> args);
+
+    // ty is null if the type is deduced from init
+    DeclResult act_on_var_decl(const Token& id_tok, QualType* ty, Expr* init);
+
+    // declares the function before its body is parsed, so that the body can call it
+    // ret_ty is null for a function returning void
+    DeclResult act_on_func_decl(const Token& id_tok, llvm::ArrayRef<Parameter> params, QualType* ret_ty);
+    // declares the parameters in the function scope the parser has just entered
+    bool act_on_start_func_body(FuncDecl* fn);
+    // body is null if it failed to parse
+    DeclResult act_on_finish_func_body(FuncDecl* fn, Stmt* body);
+    // the parser skipped the body of fn to parse it later
+    DeclResult act_on_skipped_func_body(FuncDecl* fn);
+
+    // the functions with a pending body referenced since the last call, possibly repeated
+    std::vector<FuncDecl*> take_pending_references() { return std::move(pending_references); }
+
+    StmtResult act_on_compound_stmt(llvm::ArrayRef<Stmt*> stmts);
+    StmtResult act_on_expr_stmt(Expr* expr);
+    StmtResult act_on_decl_stmt(Decl* decl);
+    // expr is null for 'return;'
+    StmtResult act_on_return_stmt(const Token& return_tok, Expr* expr);
+    StmtResult act_on_if_stmt(const Token& if_tok, Expr* cond, Stmt* then_stmt, Stmt* else_stmt);
 
     RawTypeResult act_on_raw_type(const Token& tok);
 
 private:
     Expr* add_integer_promotion(Expr* expr);
 
+    // inserts the implicit conversion of the rvalue expr to ty, null if there is none
+    Expr* convert_implicitly(Expr* expr, QualType ty);
+    // lvalue to rvalue conversion followed by convert_implicitly
+    Expr* convert_operand(Expr* expr, QualType ty);
+
+    // the cast of a literal is folded into a new literal
+    Expr* new_implicit_cast(Expr* expr, QualType ty, CastExpr::CastKind kind);
+    // the literal of a folded constant expression
+    Expr* new_int_literal(const ConstInt& value, QualType ty, SourceLocation loc);
+
     Type* new_type_from_tok(const Token& token);
     Type* new_function_ty(llvm::ArrayRef<QualType> param_ty, QualType ret_ty);
+    // types are uniqued in ASTContext, so these never allocate twice for the same type
 
 private:
     friend class TypeBuilder;
 
     ASTContext& context;
+    SymbolTable* symbols;
+    ConstExprEvaluator evaluator;
+    DiagnosticsEngine diags;
+
+    // the function whose body is being analysed
+    FuncDecl* curr_func = nullptr;
+
+    std::vector<FuncDecl*> pending_references;
 };
 
 }
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace deltac {
+
+class SourceBuffer;
+
+/*
+ * A position in one of the buffers registered in a SourceManager.
+ * Every buffer owns a contiguous range of a single 32-bit offset space,
+ * so a location is one integer. The raw value 0 is the invalid location.
+ */
+class SourceLocation {
+public:
+    SourceLocation() = default;
+
+    static SourceLocation from_raw(u32 raw) {
+        SourceLocation loc;
+        loc.value = raw;
+        return loc;
+    }
+
+    u32 raw() const { return value; }
+
+    bool is_valid() const { return value != 0; }
+
+    SourceLocation offset_by(u32 n) const {
+        DELTA_ASSERT(is_valid());
+        return from_raw(value + n);
+    }
+
+    friend bool operator ==(SourceLocation lhs, SourceLocation rhs) { return lhs.value == rhs.value; }
+    friend bool operator !=(SourceLocation lhs, SourceLocation rhs) { return lhs.value != rhs.value; }
+    friend bool operator <(SourceLocation lhs, SourceLocation rhs) { return lhs.value < rhs.value; }
+
+private:
+    u32 value = 0;
+};
+
+// 1-based line and column of a SourceLocation, for diagnostics
+struct PresumedLoc {
+    std::string_view file;
+    u32 line;
+    u32 column;
+};
+
+/*
+ * Assigns locations to source buffers and maps them back to file, line and column.
+ * The line table of a buffer is only built the first time a location in it is
+ * resolved to a line, with a vectorized newline scan, so lexing and parsing never
+ * track lines. Resolving locations is safe from multiple threads; adding buffers is not.
+ */
+class SourceManager {
+public:
+    using FileID = u32;
+
+    static constexpr FileID INVALID_FILE = ~u32(0);
+
+public:
+    SourceManager() = default;
+    SourceManager(const SourceManager&) = delete;
+    SourceManager(SourceManager&&) = delete;
+
+    // the buffer must outlive the manager
+    // returns INVALID_FILE if the offset space is exhausted
+    FileID add_buffer(const SourceBuffer& buffer);
+
+    // [begin, begin + size) must stay readable while the manager is alive
+    FileID add_buffer(const char* begin, usize size, std::string name);
+
+    usize buffer_count() const { return entries.size(); }
+
+    // location of the first character, the location of the end of the buffer is
+    // start_location(fid).offset_by(size)
+    SourceLocation start_location(FileID fid) const { return SourceLocation::from_raw(entries[fid]->base); }
+
+    SourceLocation location(FileID fid, const char* ptr) const;
+
+    // INVALID_FILE for the invalid location
+    FileID file_id(SourceLocation loc) const;
+
+    const char* character_data(SourceLocation loc) const;
+
+    std::string_view buffer_name(FileID fid) const { return entries[fid]->name; }
+
+    PresumedLoc presumed_loc(SourceLocation loc) const;
+
+    // "file:line:column"
+    std::string format_location(SourceLocation loc) const;
+
+private:
+    struct Entry {
+        const char* start;
+        u32 size;
+        u32 base;
+        std::string name;
+
+        // offsets of the first character of every line, built on first use
+        mutable std::once_flag lines_built;
+        mutable std::vector<u32> line_starts;
+    };
+
+    const std::vector<u32>& line_table(const Entry& entry) const;
+
+private:
+    std::vector<std::unique_ptr<Entry>> entries;
+    // 0 is the invalid location
+    u32 next_base = 1;
+};
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "utils.hpp"
+
+namespace deltac {
+
+/*
+ * Guards the walks that recurse once per level of the AST, the parser and the lowering
+ * to IR and to bytecode, against running out of stack.
+ *
+ * How deep they can go is not a fixed number of levels: a level costs several times
+ * more stack in a debug or sanitizer build than in an optimized one, and worker threads
+ * may have smaller stacks than the main thread. A walk instead checks before every level
+ * how much of the stack of its thread is left, and gives up on the input once less than
+ * RESERVE is, which is room for the work a level does without recursing, including its
+ * calls into LLVM. Every depth that is accepted is safe in every build type.
+ */
+namespace stack {
+
+constexpr usize RESERVE = usize(256) << 10;
+
+// true once less than RESERVE bytes of the stack of the calling thread are left
+bool is_nearly_exhausted();
+
+}
+
+}
@@ -1,32 +1,153 @@
 #pragma once
 
+#include "declaration.hpp"
 #include "expression.hpp"
+#include "sourcemanager.hpp"
+#include "statistic.hpp"
 #include "typeinfo.hpp"
 
 #include <vector>
 #include <algorithm>
+#include <memory>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/TrailingObjects.h"
 
 namespace deltac {
 
+class ASTContext;
+
 class Stmt {
 public:
+    enum StmtKind : u8 {
+        CompoundStmtKind,
+        ExprStmtKind,
+        DeclStmtKind,
+        ReturnStmtKind,
+        IfStmtKind,
+
+        NumStmtKinds = IfStmtKind + 1,
+    };
+
+public:
+    Stmt(StmtKind kind) : kind(kind) {
+        if (stats::is_enabled()) {
+            count_node(kind);
+        }
+    }
+    Stmt(const Stmt&) = delete;
+    Stmt(Stmt&&) = delete;
     virtual ~Stmt() = 0;
+
+    // statistics of the nodes created per kind
+    static void count_node(StmtKind kind);
+
+    // statements live in the arena of ASTContext, create them with new (ctx) Stmt(...)
+    // child statements are not owned by their parent
+    void* operator new(usize bytes, const ASTContext& ctx, usize align = 8);
+    void operator delete(void*, const ASTContext&, usize) noexcept {}
+    void* operator new(usize bytes) = delete;
+    // the memory is released together with the arena
+    void operator delete(void*) noexcept {}
+
+    StmtKind stmt_kind() const { return kind; }
+
+    SourceLocation location() const { return loc; }
+    void set_location(SourceLocation l) { loc = l; }
+
+private:
+    StmtKind kind;
+    SourceLocation loc;
 };
 
 inline Stmt::~Stmt() = default;
 
-class CompoundStmt : public Stmt {
-public:
-    CompoundStmt(llvm::ArrayRef<Stmt*> stmtlist) : stmtlist(stmtlist) {}
-    ~CompoundStmt() { 
-        util::cleanup_ptrs(stmtlist.begin(), stmtlist.end());
+// the statements are stored right after the node, in the same allocation
+class CompoundStmt final : public Stmt, private llvm::TrailingObjects<CompoundStmt, Stmt*> {
+private:
+    friend TrailingObjects;
+
+    CompoundStmt(llvm::ArrayRef<Stmt*> stmtlist) : Stmt(CompoundStmtKind), num_stmts((u32)stmtlist.size()) {
+        std::uninitialized_copy(stmtlist.begin(), stmtlist.end(), getTrailingObjects<Stmt*>());
     }
 
+public:
+    static CompoundStmt* create(const ASTContext& ctx, llvm::ArrayRef<Stmt*> stmtlist);
+
+    ~CompoundStmt() override = default;
+
+    static bool classof(const Stmt* s) { return s->stmt_kind() == CompoundStmtKind; }
+
+    llvm::ArrayRef<Stmt*> body() const { return { getTrailingObjects<Stmt*>(), num_stmts }; }
+
+private:
+    u32 num_stmts;
+};
+
+// an expression evaluated for its side effects
+class ExprStmt : public Stmt {
+public:
+    ExprStmt(Expr* expr) : Stmt(ExprStmtKind), expr(expr) {}
+    ~ExprStmt() override = default;
+
+    static bool classof(const Stmt* s) { return s->stmt_kind() == ExprStmtKind; }
+
+    Expr* get_expr() const { return expr; }
+
+private:
+    Expr* expr;
+};
+
+// a local variable declaration
+class DeclStmt : public Stmt {
+public:
+    DeclStmt(Decl* decl) : Stmt(DeclStmtKind), decl(decl) {}
+    ~DeclStmt() override = default;
+
+    static bool classof(const Stmt* s) { return s->stmt_kind() == DeclStmtKind; }
+
+    Decl* get_decl() const { return decl; }
+
+private:
+    Decl* decl;
+};
+
+class ReturnStmt : public Stmt {
+public:
+    // expr is null for a function returning void
+    ReturnStmt(Expr* expr = nullptr) : Stmt(ReturnStmtKind), expr(expr) {}
+    ~ReturnStmt() override = default;
+
+    static bool classof(const Stmt* s) { return s->stmt_kind() == ReturnStmtKind; }
+
+    Expr* get_expr() const { return expr; }
+
+    bool has_expr() const { return expr != nullptr; }
+
+private:
+    Expr* expr;
+};
+
+// cond is always of type bool, else_stmt is null without an else branch
+class IfStmt : public Stmt {
+public:
+    IfStmt(Expr* cond, Stmt* then_stmt, Stmt* else_stmt = nullptr) :
+        Stmt(IfStmtKind), cond(cond), then_stmt(then_stmt), else_stmt(else_stmt) {}
+    ~IfStmt() override = default;
+
+    static bool classof(const Stmt* s) { return s->stmt_kind() == IfStmtKind; }
+
+    Expr* get_cond() const { return cond; }
+    Stmt* get_then() const { return then_stmt; }
+    Stmt* get_else() const { return else_stmt; }
+
+    bool has_else() const { return else_stmt != nullptr; }
+
 private:
-    llvm::SmallVector<Stmt*> stmtlist;
+    Expr* cond;
+    Stmt* then_stmt;
+    Stmt* else_stmt;
 };
 
 } // namespace deltac
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+namespace deltac {
+
+/*
+ * Compiler statistics in the spirit of LLVM's STATISTIC.
+ *
+ * A statistic is a named counter with static storage duration, usually defined with
+ * DELTAC_STATISTIC at the top of the file that updates it. Nothing is counted until
+ * stats::enable() is called, so the disabled cost of an update is a relaxed load and
+ * a branch. A statistic joins the registry the first time it is updated while enabled,
+ * which keeps static initialization order irrelevant and leaves untouched counters out
+ * of the report.
+ * Updates are relaxed atomics and may come from any thread.
+ */
+class StatisticBase {
+public:
+    StatisticBase(const char* group, const char* name, const char* desc) :
+        group(group), name(name), desc(desc) {}
+
+    StatisticBase(const StatisticBase&) = delete;
+    StatisticBase(StatisticBase&&) = delete;
+
+    std::string_view get_group() const { return group; }
+    std::string_view get_name() const { return name; }
+    std::string_view get_desc() const { return desc; }
+
+    // number of values, more than one for statistics counted per kind
+    virtual usize size() const = 0;
+    virtual u64 value(usize idx) const = 0;
+    // "" for single counters
+    virtual std::string_view label(usize idx) const = 0;
+    virtual void reset() = 0;
+
+protected:
+    ~StatisticBase() = default;
+
+    void ensure_registered() {
+        if (!registered.load(std::memory_order_acquire)) {
+            register_statistic();
+        }
+    }
+
+private:
+    void register_statistic();
+
+private:
+    const char* group;
+    const char* name;
+    const char* desc;
+    std::atomic<bool> registered = false;
+};
+
+namespace stats {
+
+namespace detail {
+
+extern std::atomic<bool> enabled;
+
+}
+
+inline bool is_enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+void enable(bool on = true);
+
+// clears every registered statistic
+void reset();
+
+// human readable, sorted by group and name, like llvm::PrintStatistics
+void print(std::ostream& os);
+
+// { "group.name": value, "group.name.label": value, ... }
+void print_json(std::ostream& os);
+
+} // namespace stats
+
+class Statistic final : public StatisticBase {
+public:
+    using StatisticBase::StatisticBase;
+
+    Statistic& operator ++() { return *this += 1; }
+
+    Statistic& operator +=(u64 n) {
+        if (stats::is_enabled()) {
+            ensure_registered();
+            count.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        return *this;
+    }
+
+    // keeps the largest value seen, for high water marks
+    void update_max(u64 n) {
+        if (stats::is_enabled()) {
+            ensure_registered();
+
+            u64 curr = count.load(std::memory_order_relaxed);
+            while (curr < n && !count.compare_exchange_weak(curr, n, std::memory_order_relaxed)) {}
+        }
+    }
+
+    u64 get() const { return count.load(std::memory_order_relaxed); }
+
+    usize size() const override { return 1; }
+    u64 value(usize) const override { return get(); }
+    std::string_view label(usize) const override { return ""; }
+    void reset() override { count.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<u64> count = 0;
+};
+
+/*
+ * A statistic counted separately for each value of an enumeration,
+ * e.g. tokens by kind. label_fn names the values in the report.
+ */
+class StatisticArray final : public StatisticBase {
+public:
+    using LabelFn = std::string_view (*)(usize);
+
+    StatisticArray(const char* group, const char* name, const char* desc, usize count, LabelFn label_fn) :
+        StatisticBase(group, name, desc), counts(new std::atomic<u64>[count]()), num(count), label_fn(label_fn) {}
+
+    void add(usize idx, u64 n = 1) {
+        DELTA_ASSERT(idx < num);
+
+        if (stats::is_enabled()) {
+            ensure_registered();
+            counts[idx].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    u64 get(usize idx) const { return counts[idx].load(std::memory_order_relaxed); }
+
+    usize size() const override { return num; }
+    u64 value(usize idx) const override { return get(idx); }
+    std::string_view label(usize idx) const override { return label_fn(idx); }
+
+    void reset() override {
+        for (usize i = 0; i < num; i++) {
+            counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::unique_ptr<std::atomic<u64>[]> counts;
+    usize num;
+    LabelFn label_fn;
+};
+
+}
+
+// defines a file local counter named VAR, reported as GROUP.VAR
+#define DELTAC_STATISTIC(VAR, GROUP, DESC) \
+    static ::deltac::Statistic VAR(GROUP, #VAR, DESC)
+
+#define DELTAC_STATISTIC_ARRAY(VAR, GROUP, DESC, COUNT, LABEL_FN) \
+    static ::deltac::StatisticArray VAR(GROUP, #VAR, DESC, COUNT, LABEL_FN)
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "identifiertable.hpp"
+#include "utils.hpp"
+
+#include <vector>
+
+namespace deltac {
+
+class NamedDecl;
+
+/*
+ * Scoped symbol table used for name lookup.
+ *
+ * Names are interned identifiers, compared by pointer and hashed with the hash computed
+ * by the IdentifierTable. They live in an open addressing hash table (linear probing,
+ * power of two capacity).
+ * Each slot refers to the innermost binding of its name; bindings of the same name in
+ * outer scopes form a chain through Binding::shadowed.
+ * The bindings are kept in a single vector in the order they were made, which doubles as
+ * the undo log: leaving a scope pops the bindings made since the scope was entered and
+ * restores the binding each one shadowed, O(1) per entry.
+ * Slots are never removed, a name whose bindings were all popped keeps an empty slot,
+ * so no tombstones are needed.
+ */
+class SymbolTable {
+public:
+    enum ScopeKind : u8 {
+        GlobalScope,
+        FunctionScope,
+        BlockScope,
+    };
+
+    // enters a scope on construction and leaves it on destruction
+    class ScopeGuard {
+    public:
+        ScopeGuard(SymbolTable& table, ScopeKind kind) : table(table) { table.push_scope(kind); }
+        ScopeGuard(const ScopeGuard&) = delete;
+        ~ScopeGuard() { table.pop_scope(); }
+
+    private:
+        SymbolTable& table;
+    };
+
+    // hides the global bindings made after the first count from lookup while it lives
+    class VisibleGlobalsGuard {
+    public:
+        VisibleGlobalsGuard(SymbolTable& table, usize count) : table(table), saved(table.visible_globals) {
+            table.visible_globals = count;
+        }
+        VisibleGlobalsGuard(const VisibleGlobalsGuard&) = delete;
+        ~VisibleGlobalsGuard() { table.visible_globals = saved; }
+
+    private:
+        SymbolTable& table;
+        usize saved;
+    };
+
+public:
+    // starts with the global scope entered
+    SymbolTable();
+    // a table for the local scopes of one thread, names not bound in it are looked up in
+    // the global scope of globals, which must not change while this table is used
+    explicit SymbolTable(const SymbolTable* globals);
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable(SymbolTable&&) = default;
+
+    void push_scope(ScopeKind kind);
+
+    // the global scope cannot be left
+    void pop_scope();
+
+    // binds name to decl in the current scope
+    // returns the declaration already bound to name in the current scope without
+    // rebinding, or nullptr on success
+    NamedDecl* insert(const IdentifierInfo* name, NamedDecl* decl);
+
+    // the innermost binding of name, or nullptr
+    NamedDecl* lookup(const IdentifierInfo* name) const;
+
+    // the binding of name in the current scope only, or nullptr
+    NamedDecl* lookup_in_current_scope(const IdentifierInfo* name) const;
+
+    ScopeKind current_scope_kind() const { return scopes.back().kind; }
+
+    // 1 for the global scope
+    usize scope_depth() const { return scopes.size(); }
+
+    // number of visible and shadowed bindings
+    // in the global scope this is the number of globals declared so far, a body parsed
+    // later sees the same globals when it is parsed under a VisibleGlobalsGuard of it
+    usize size() const { return bindings.size(); }
+
+    // number of distinct names ever inserted
+    usize name_count() const { return num_names; }
+
+    // slots visited by lookups and insertions, probe_count() / lookup_count()
+    // is the average probe length
+    u64 probe_count() const { return probes; }
+    u64 lookup_count() const { return lookups; }
+
+private:
+    static constexpr i32 NO_BINDING = -1;
+
+    struct Slot {
+        // null if the slot is empty
+        const IdentifierInfo* name = nullptr;
+        // innermost binding, NO_BINDING if the name is not bound
+        i32 binding = NO_BINDING;
+    };
+
+    struct Binding {
+        NamedDecl* decl;
+        // the binding of the same name in an outer scope
+        i32 shadowed;
+        u32 slot;
+        u32 scope;
+    };
+
+    struct Scope {
+        ScopeKind kind;
+        // size of the undo log when the scope was entered
+        u32 first_binding;
+    };
+
+    // slot holding name, or the empty slot it would be inserted in
+    u32 find_slot(const IdentifierInfo* name) const;
+    // find_slot without updating the counters, which belong to the thread owning the table
+    u32 probe(const IdentifierInfo* name, u32& length) const;
+
+    // the global binding of name if it is one of the first count globals, or nullptr
+    NamedDecl* lookup_global(const IdentifierInfo* name, usize count, u32& length) const;
+
+    void grow();
+
+private:
+    std::vector<Slot> slots;
+    std::vector<Binding> bindings;
+    std::vector<Scope> scopes;
+    usize num_names = 0;
+    // global bindings are made in declaration order, the ones at this index and after are hidden
+    usize visible_globals = SIZE_MAX;
+    // read only, see the constructor
+    const SymbolTable* globals = nullptr;
+
+    mutable u64 probes = 0;
+    mutable u64 lookups = 0;
+};
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace deltac {
+
+/*
+ * Time profiler writing Chrome trace_event JSON, readable by chrome://tracing and Perfetto.
+ *
+ * Phases open a TimeTraceScope, which records a complete event from its construction
+ * to its destruction. Scopes nest, and every thread records into its own event list,
+ * so scopes in worker threads show up as separate tracks.
+ * When tracing is off a scope is a single load and branch, so scopes may be placed
+ * on hot paths such as the Sema actions.
+ * Events shorter than the granularity are dropped when they end, but they still count
+ * towards the "Total <name>" summary events written at the end of the trace.
+ */
+namespace timetrace {
+
+// starts recording, events shorter than granularity_us microseconds are not written
+void initialize(unsigned granularity_us = 500, std::string_view process_name = "deltac");
+
+// stops recording and discards all events
+// threads that recorded events must not be inside a scope
+void cleanup();
+
+bool is_enabled();
+
+// writes all events recorded so far
+// must not race with threads that are still recording
+void write(std::ostream& os);
+
+// returns false if path cannot be opened
+bool write(const std::string& path);
+
+namespace detail {
+
+using Clock = std::chrono::steady_clock;
+
+extern std::atomic<bool> enabled;
+
+void begin_event(std::string_view name);
+void end_event(std::string_view name, std::string_view detail, Clock::time_point start);
+
+}
+
+} // namespace timetrace
+
+class TimeTraceScope {
+public:
+    // name is the phase and must be a string literal, detail is shown as the argument
+    // of the event (e.g. the file name) and only has to outlive the scope
+    explicit TimeTraceScope(std::string_view name, std::string_view detail = {}) {
+        if (timetrace::detail::enabled.load(std::memory_order_relaxed)) {
+            active = true;
+            this->name = name;
+            this->detail = detail;
+            timetrace::detail::begin_event(name);
+            start = timetrace::detail::Clock::now();
+        }
+    }
+
+    TimeTraceScope(const TimeTraceScope&) = delete;
+    TimeTraceScope(TimeTraceScope&&) = delete;
+
+    ~TimeTraceScope() {
+        if (active) {
+            timetrace::detail::end_event(name, detail, start);
+        }
+    }
+
+private:
+    bool active = false;
+    // only accessed while tracing
+    std::string_view name;
+    std::string_view detail;
+    timetrace::detail::Clock::time_point start;
+};
+
+}
@@ -2,6 +2,8 @@
 
 #include "tokentype.hpp"
 #include "charinfo.hpp"
+#include "identifiertable.hpp"
+#include "sourcemanager.hpp"
 
 #include <iostream>
 #include <optional>
@@ -9,44 +11,93 @@
 
 namespace deltac {
 
+/*
+ * A token is its location, length and kind, plus either a pointer to its text in the
+ * source buffer or, for interned identifiers, its IdentifierInfo.
+ *
+ * It is 24 bytes, not 16: dropping the text pointer would make get_view look the text
+ * up in the SourceManager, which the lexer, Sema and the tests do not always have, and
+ * tokens lexed without a start location would lose their text. Only one token at a time
+ * lives in a Token, whole files are kept in a TokenBuffer at BYTES_PER_TOKEN each.
+ */
 class Token {
 public:
     bool is(tok::Kind type1) const { return type == type1; }
     template <typename... Ts>
     bool is_one_of(tok::Kind type, Ts... types) const {
-        return (is(type) || ...);
+        return is(type) || (is(types) || ...);
     }
 
     void concat(const Token& other) {
-        code_view = util::make_sv(std::min(code_view.begin(), other.code_view.begin()),
-                                  std::max(code_view.end(), other.code_view.end()));
+        DELTA_ASSERT(!has_ident && !other.has_ident);
+
+        const char* begin = std::min(data, other.data);
+        const char* end = std::max(data + length, other.data + other.length);
+
+        loc = std::min(loc, other.loc);
+        set_view(begin, end);
     }
 
     void start_token() {
         type = tok::ERROR;
-        code_view = "";
+        loc = SourceLocation();
+        set_view("");
+    }
+
+    // the text of the token, interned identifiers return the spelling owned by the IdentifierTable
+    void set_view(std::string_view sv) { set_view(sv.data(), sv.size()); }
+    void set_view(const char* begin, const char* end) { set_view(begin, (std::size_t)(end - begin)); }
+    void set_view(const char* begin, std::size_t size) { 
+        data = begin;
+        length = (u32)size;
+        has_ident = false;
     }
+    std::string_view get_view() const;
+
+    u32 get_length() const { return length; }
 
-    void set_view(std::string_view sv) { code_view = sv; }
-    void set_view(const char* begin, const char* end) { code_view = util::make_sv(begin, end); }
-    void set_view(const char* begin, std::size_t size) { code_view = std::string_view(begin, size); }
-    std::string_view get_view() const { return code_view; }
+    // invalid if the buffer was not registered in a SourceManager
+    void set_location(SourceLocation l) { loc = l; }
+    SourceLocation get_location() const { return loc; }
 
     void set_type(tok::Kind t) { type = t; }
     tok::Kind get_type() const { return type; }
 
     std::string_view get_name() const { return token_type_name(get_type()); }
 
+    // the interned spelling of an Identifier token, replaces the pointer to the text
+    // null for other tokens and when lexing without an IdentifierTable
+    void set_identifier_info(IdentifierInfo* info) { 
+        if (info) {
+            ident = info;
+            has_ident = true;
+        }
+    }
+    IdentifierInfo* get_identifier_info() const { return has_ident ? ident : nullptr; }
+
 private:
+    SourceLocation loc;
+    u32 length = 0;
     tok::Kind type = tok::ERROR;
-    std::string_view code_view;
+    bool has_ident = false;
+
+    union {
+        const char* data = "";
+        IdentifierInfo* ident;
+    };
     // std::any data;
 
     friend std::ostream& operator <<(std::ostream&, const Token& tk);
 };
 
+static_assert(sizeof(Token) == 24, "a Token is copied around by value");
+
+inline std::string_view Token::get_view() const {
+    return has_ident ? ident->name() : std::string_view(data, length);
+}
+
 inline std::ostream& operator <<(std::ostream& os, const Token& tk) {
-    os << token_type_enum_name(tk.type) << ": " << tk.code_view;
+    os << token_type_enum_name(tk.type) << ": " << tk.get_view();
     return os;
 }
 
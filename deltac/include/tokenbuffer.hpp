@@ -0,0 +1,103 @@
+#pragma once
+
+#include "identifiertable.hpp"
+#include "token.hpp"
+#include "tokentype.hpp"
+#include "utils.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace deltac {
+
+/*
+ * Tokens of a whole file stored as parallel arrays.
+ * Each token takes a 16-bit kind, a 32-bit offset into the source, a 32-bit length
+ * and the 32-bit id of its IdentifierInfo. The location is implied by the offset.
+ * Tokens are addressed by index, which gives the parser arbitrary lookahead and
+ * backtracking. The last token is always EndOfFile once lexing has finished.
+ */
+class TokenBuffer {
+public:
+    static constexpr usize BYTES_PER_TOKEN = sizeof(tok::Kind) + sizeof(u32) + sizeof(u32) + sizeof(u32);
+
+public:
+    TokenBuffer() = default;
+    explicit TokenBuffer(const char* source, IdentifierTable* identifiers = nullptr) : 
+        source(source), identifiers(identifiers) {}
+
+    TokenBuffer(const TokenBuffer&) = delete;
+    TokenBuffer(TokenBuffer&&) = default;
+    TokenBuffer& operator =(TokenBuffer&&) = default;
+
+    // removes all tokens, following tokens are relative to source
+    // identifier ids refer to identifiers if given
+    // start is the location of source, if it is registered in a SourceManager
+    void reset(const char* source, IdentifierTable* identifiers = nullptr, SourceLocation start = SourceLocation());
+
+    void reserve(usize count);
+
+    void push_back(tok::Kind kind, std::string_view view, u32 ident_id = IdentifierTable::NO_IDENT) {
+        DELTA_ASSERT(view.data() >= source);
+
+        kinds.push_back(kind);
+        offsets.push_back((u32)(view.data() - source));
+        lengths.push_back((u32)view.size());
+        ident_ids.push_back(ident_id);
+    }
+
+    // appends all tokens of other, which must refer to the same source
+    void append(const TokenBuffer& other);
+
+    usize size() const { return kinds.size(); }
+    bool empty() const { return kinds.empty(); }
+
+    tok::Kind kind(usize idx) const { return kinds[idx]; }
+    u32 offset(usize idx) const { return offsets[idx]; }
+    u32 length(usize idx) const { return lengths[idx]; }
+
+    SourceLocation location(usize idx) const {
+        return start.is_valid() ? start.offset_by(offsets[idx]) : SourceLocation();
+    }
+
+    // IdentifierTable::NO_IDENT unless the token is an interned identifier
+    u32 ident_id(usize idx) const { return ident_ids[idx]; }
+    void set_ident_id(usize idx, u32 id) { ident_ids[idx] = id; }
+
+    IdentifierInfo* identifier_info(usize idx) const {
+        return ident_ids[idx] == IdentifierTable::NO_IDENT ? nullptr : identifiers->info(ident_ids[idx]);
+    }
+
+    IdentifierTable* identifier_table() const { return identifiers; }
+
+    std::string_view view(usize idx) const {
+        return std::string_view(source + offsets[idx], lengths[idx]);
+    }
+
+    // materializes the token at idx
+    Token token(usize idx) const {
+        Token tok;
+        tok.set_type(kinds[idx]);
+        tok.set_view(view(idx));
+        tok.set_location(location(idx));
+        tok.set_identifier_info(identifier_info(idx));
+        return tok;
+    }
+
+    const char* source_start() const { return source; }
+
+    // bytes used by the token arrays, excluding unused capacity
+    usize memory_usage() const { return size() * BYTES_PER_TOKEN; }
+
+private:
+    const char* source = nullptr;
+    IdentifierTable* identifiers = nullptr;
+    SourceLocation start;
+
+    std::vector<tok::Kind> kinds;
+    std::vector<u32> offsets;
+    std::vector<u32> lengths;
+    std::vector<u32> ident_ids;
+};
+
+}
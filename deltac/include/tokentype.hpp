@@ -14,6 +14,11 @@ enum Kind : std::uint16_t {
 #include "tokentype.inc"
 };
 
+inline constexpr usize NUM_KINDS = 0
+#define TOK(X) + 1
+#include "tokentype.inc"
+    ;
+
 }
 
 std::string_view token_type_name(tok::Kind tkt);
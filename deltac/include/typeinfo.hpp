@@ -5,14 +5,19 @@
 
 #include <iterator>
 #include <algorithm>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <utility>
-#include <algorithm>
+#include <vector>
 #include <cassert>
+#include <cstdint>
 
 #include "llvm/ADT/ArrayRef.h"
-#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/Support/TrailingObjects.h"
 
 namespace deltac {
 
@@ -25,92 +30,59 @@ class PtrType;
 class FunctionType;
 class BuiltinType;
 
-/*
- * TypeDeleter does not delete canonical types.
- */
-class TypeDeleter {
-public:
-    TypeDeleter() = default;
-
-    void operator ()(const Type* ty) const;
-};
-
 namespace qual {
 
-enum Qual {
+/*
+ * Qualifiers are stored in the low bits of a QualType.
+ * N_A marks types that cannot be qualified (void and functions) and is never
+ * combined with another qualifier.
+ */
+enum Qual : unsigned {
     NoQual = 0,
     Const = 1,
-    N_A = -1,
+    N_A = 2,
 };
 
+// bits available below the alignment of Type
+inline constexpr unsigned QUAL_BITS = 3;
+
 }
 
 /* 
  * Qual(lified) Type
- * act as a smart pointer to Type and stores qualification info outside type
+ * A non-owning reference to a Type with the qualifiers packed into the low bits of the pointer.
+ * Types are uniqued by ASTContext, so two QualTypes are equal iff their bits are equal.
  */
 class QualType {
+private:
+    static constexpr uintptr_t QUAL_MASK = (uintptr_t(1) << qual::QUAL_BITS) - 1;
+
 public:
     QualType(Type* ty);
 
-    QualType(Type* ty, qual::Qual q) : 
-        type(ty), qualification(q) {
+    QualType(Type* ty, qual::Qual q) : value(reinterpret_cast<uintptr_t>(ty) | q) {
         // assumed to have the correct qualification
-    }
-
-    QualType(const QualType& other);
-
-    QualType(QualType&& other) : type(other.type), qualification(other.qualification) {
-        other.type = nullptr;
-    }
-
-    static QualType make_ptr_ty(QualType ty, bool constness = false) {
-        ty.add_ptr(constness);
-        return ty;
+        DELTA_ASSERT((reinterpret_cast<uintptr_t>(ty) & QUAL_MASK) == 0);
     }
 
     static QualType make_no_qual_ty(QualType ty) {
-        ty.qualification = qual::NoQual;
+        ty.value &= ~QUAL_MASK;
         return ty;
     }
 
-    static QualType make_remove_ptr_ty(QualType ty) {
-        assert(ty.is_ptr_ty());
-        
-        ty.remove_ptr();
-        return ty;
-    }
-
-    QualType& operator =(const QualType& rhs) {
-        if (&rhs == this) {
-            return *this;
-        }
-
-        QualType newty = rhs;
-        swap(newty);
-        return *this;
-    }
-
-    QualType& operator =(QualType&& rhs) {
-        if (&rhs == this) {
-            return *this;
-        }
-
-        swap(rhs);
-        return *this;
-    }
+    static QualType make_remove_ptr_ty(QualType ty);
 
     void swap(QualType& other) {
-        std::swap(type, other.type);
-        std::swap(qualification, other.qualification);
+        std::swap(value, other.value);
     }
 
-    ~QualType() { TypeDeleter()(type); }
-
 public:
-    Type* raw_type() const;
+    Type* raw_type() const { return reinterpret_cast<Type*>(value & ~QUAL_MASK); }
+
+    qual::Qual qual() const { return (qual::Qual)(value & QUAL_MASK); }
 
-    void raw_type(Type* type);
+    // the pointer and qualifier bits, unique for each distinct QualType
+    uintptr_t opaque_value() const { return value; }
 
     std::string repr() const;
 
@@ -118,9 +90,9 @@ public:
 
     usize size() const;
 
-    bool is_const() const;
+    bool is_const() const { return (value & qual::Const) != 0; }
 
-    bool is_mutable() const;
+    bool is_mutable() const { return qual() == qual::NoQual; }
 
     bool is_ptr_ty() const;
 
@@ -130,13 +102,15 @@ public:
 
     bool is_void_ty() const;
 
-    void remove_ptr();
-
-    void remove_const();
-
-    void add_const();
+    void remove_const() {
+        DELTA_ASSERT(is_const());
+        value &= ~uintptr_t(qual::Const);
+    }
 
-    void add_ptr(bool constness = false);
+    void add_const() {
+        DELTA_ASSERT(is_mutable());
+        value |= qual::Const;
+    }
 
     bool is_signed_ty() const;
 
@@ -148,23 +122,45 @@ public:
 
     bool is_bool_ty() const;
 
-    bool noqual_eq(const QualType& rhs) const;
+    // compares the types ignoring the top level qualification
+    bool noqual_eq(const QualType& rhs) const { return raw_type() == rhs.raw_type(); }
 
     bool eq(const QualType& rhs) const { return *this == rhs; }
 
-    friend bool operator ==(const QualType& lhs, const QualType& rhs);
+    friend bool operator ==(const QualType& lhs, const QualType& rhs) {
+        return lhs.value == rhs.value;
+    }
 
-    friend class TypeBuilder;
+    friend bool operator !=(const QualType& lhs, const QualType& rhs) {
+        return !(lhs == rhs);
+    }
+
+    void profile(llvm::FoldingSetNodeID& id) const {
+        id.AddInteger(value);
+    }
 
 private:
-    Type* type;
-    qual::Qual qualification;
+    uintptr_t value;
 };
 
+static_assert(std::is_trivially_copyable_v<QualType>, "QualType must stay a plain value");
+static_assert(sizeof(QualType) == sizeof(void*), "QualType must stay pointer sized");
 
+/*
+ * Types are immutable and owned by ASTContext.
+ * Every compound type is created through ASTContext, which returns the
+ * existing instance for a structurally equal type.
+ */
 class Type {
 public:
-    Type() = default;
+    enum TypeClass : u8 {
+        Builtin,
+        Ptr,
+        Function,
+    };
+
+public:
+    Type(TypeClass tc) : tc(tc) {}
     Type(const Type&) = delete;
     Type(Type&&) = delete;
     
@@ -174,36 +170,42 @@ public:
 
     virtual std::size_t size() const = 0;
 
-    virtual Type* copy() const = 0;
+    TypeClass type_class() const { return tc; }
+
+private:
+    TypeClass tc;
 };
 
 inline Type::~Type() = default;
 
+static_assert(alignof(Type) >= (1u << qual::QUAL_BITS), "not enough alignment bits for the qualifiers");
+
 /* 
  * Represents the type of a pointer.
  * Can point to any type
+ * Uniqued on the pointee, see ASTContext::get_ptr_type
  */
-class PtrType : public Type {
+class PtrType : public Type, public llvm::FoldingSetNode {
+protected:
+    friend class ASTContext;
+
+    PtrType(QualType type) : Type(Ptr), type_under(type) {}
+
 public:
-    PtrType(QualType type) : type_under(std::move(type)) {}
     ~PtrType() override = default;
 
+    static bool classof(const Type* ty) { return ty->type_class() == Ptr; }
+
     std::string repr() const override { return "*" + type_under.repr(); }
 
     std::size_t size() const override { return 8; }
 
-    Type* copy() const override { return new PtrType(type_under); }
+    QualType pointee() const { return type_under; }
 
-    QualType& pointee() { return type_under; }
+    void Profile(llvm::FoldingSetNodeID& id) const { Profile(id, type_under); }
 
-    const QualType& pointee() const { return type_under; }
-
-    bool eq(const PtrType* other) const { return *this == *other; }
-
-    bool noqual_eq(const PtrType* other) const { return type_under.noqual_eq(other->type_under); }
-
-    friend bool operator ==(const PtrType& lhs, const PtrType& rhs) {
-        return lhs.type_under == rhs.type_under;
+    static void Profile(llvm::FoldingSetNodeID& id, QualType pointee) {
+        pointee.profile(id);
     }
 
 private:
@@ -213,27 +215,35 @@ private:
 /*
  * Represents the type of a function.
  * FunctionType is always const. It cannot be the type of a VarDecl.
+ * Uniqued on the signature, see ASTContext::get_function_type
+ * The parameter types are stored right after the object.
  */
-class FunctionType : public Type {
-public:
-    template <typename It>
-    FunctionType(It a_begin, It a_end, QualType return_ty, util::use_copy_t) : 
-        args_ty(a_begin, a_end), return_ty(std::move(return_ty)) {}
-
-    template <typename It>
-    FunctionType(It a_begin, It a_end, QualType return_ty, util::use_move_t = util::use_move) :
-        return_ty(std::move(return_ty)) {
-        for (; a_begin != a_end; std::advance(a_begin, 1)) {
-            args_ty.emplace_back(std::move(*a_begin));
-        }
+class FunctionType final : 
+    public Type, 
+    public llvm::FoldingSetNode, 
+    private llvm::TrailingObjects<FunctionType, QualType> {
+private:
+    friend class ASTContext;
+    friend TrailingObjects;
+
+    FunctionType(llvm::ArrayRef<QualType> params, QualType return_ty) : 
+        Type(Function), num_params((u32)params.size()), return_ty(return_ty) {
+        std::uninitialized_copy(params.begin(), params.end(), getTrailingObjects<QualType>());
     }
 
+    static usize alloc_size(usize num_params) {
+        return totalSizeToAlloc<QualType>(num_params);
+    }
+
+public:
     ~FunctionType() override = default;
 
+    static bool classof(const Type* ty) { return ty->type_class() == Function; }
+
     std::string repr() const override {
-        std::vector<std::string> names(args_ty.size(), "");
+        std::vector<std::string> names(num_params, "");
 
-        std::transform(args_ty.begin(), args_ty.end(), names.begin(), [](const QualType& t) {
+        std::transform(param_types().begin(), param_types().end(), names.begin(), [](const QualType& t) {
             return t.repr();
         });
 
@@ -245,16 +255,25 @@ public:
 
     std::size_t size() const override { return 0; }
 
-    Type* copy() const override {
-        return new FunctionType(args_ty.begin(), args_ty.end(), return_ty, util::use_copy);
+    llvm::ArrayRef<QualType> param_types() const {
+        return { getTrailingObjects<QualType>(), num_params };
     }
 
-    bool eq(const FunctionType* other) const { return *this == *other; }
+    QualType return_type() const { return return_ty; }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { Profile(id, param_types(), return_ty); }
 
-    friend bool operator ==(const FunctionType& lhs, const FunctionType& rhs); 
+    static void Profile(llvm::FoldingSetNodeID& id, llvm::ArrayRef<QualType> params, QualType return_ty) {
+        return_ty.profile(id);
+        id.AddInteger((u32)params.size());
+
+        for (const QualType& param : params) {
+            param.profile(id);
+        }
+    }
 
 private:
-    llvm::SmallVector<QualType> args_ty;
+    u32 num_params;
     QualType return_ty;
 };
 
@@ -272,27 +291,19 @@ public:
 protected:
     friend class ASTContext;
 
-    BuiltinType(Kind kind) : kind(kind) {}
+    BuiltinType(Kind kind) : Type(Builtin), kind(kind) {}
 
 public:
     ~BuiltinType() override = default;
 
+    static bool classof(const Type* ty) { return ty->type_class() == Builtin; }
+
     std::string repr() const override;
 
     std::size_t size() const override;
 
     Kind get_kind() const { return kind; }
 
-    // BuiltinType is guarenteed to be const since all public methods are const
-    // We const_cast away the constness to keep the consistency with other Type objects
-    Type* copy() const override { return const_cast<BuiltinType*>(this); }
-
-    bool eq(const BuiltinType* other) const { return this == other; }
-
-    friend bool operator ==(const BuiltinType& lhs, const BuiltinType& rhs) {
-        return &lhs == &rhs;
-    }
-
 private:
     Kind kind;
 };
@@ -307,4 +318,7 @@ bool is_unsigned(BuiltinType::Kind kind);
 
 bool is_integer(BuiltinType::Kind kind);
 
+// the builtin type spelled as name, if any
+std::optional<BuiltinType::Kind> builtin_kind_from_name(std::string_view name);
+
 }
@@ -33,23 +33,46 @@ template <class T>
 using remove_cvref_t = typename remove_cvref<T>::type;
 
 template <typename To, typename From>
-inline bool isinstance(From* ptr) {
-    return dynamic_cast<const To*>(ptr) != nullptr;
+using copy_const_t = std::conditional_t<std::is_const_v<From>, const To, To>;
+
+/*
+ * LLVM style RTTI, does not depend on the C++ RTTI.
+ * Every class in a hierarchy provides a static To::classof(const Base*),
+ * which usually is a single compare of the kind stored in the base class.
+ * ptr must not be null.
+ */
+template <typename To, typename From>
+inline bool isa(const From* ptr) {
+    DELTA_ASSERT(ptr != nullptr);
+
+    if constexpr (std::is_base_of_v<To, From>) {
+        return true;
+    }
+    else {
+        return To::classof(ptr);
+    }
 }
 
 template <typename To, typename From>
-inline bool isinstance(From&& obj) {
-    return dynamic_cast<const To*>(&obj) != nullptr;
+inline copy_const_t<To, From>* cast(From* ptr) {
+    DELTA_ASSERT(isa<To>(ptr));
+    return static_cast<copy_const_t<To, From>*>(ptr);
 }
 
-template <
-    typename It, typename Deleter = 
-        std::default_delete<std::remove_pointer_t<typename std::iterator_traits<It>::value_type>>
->
-void cleanup_ptrs(It begin, It end, Deleter&& deleter = Deleter()) {
-    for (; begin != end; ++begin) {
-        deleter(*begin);
-    }
+// returns nullptr if ptr is not a To
+template <typename To, typename From>
+inline copy_const_t<To, From>* dyn_cast(From* ptr) {
+    return isa<To>(ptr) ? static_cast<copy_const_t<To, From>*>(ptr) : nullptr;
+}
+
+template <typename To, typename From>
+inline bool isinstance(From* ptr) {
+    return ptr != nullptr && isa<To>(ptr);
+}
+
+template <typename To, typename From>
+inline bool isinstance(From&& obj) {
+    return isa<To>(&obj);
 }
 
 inline constexpr class use_move_t {} use_move;
@@ -87,6 +110,7 @@ constexpr typename std::iterator_traits<It>::value_type join(Delim delim, It beg
     std::advance(begin, 1);
 
     for (; begin != end; std::advance(begin, 1)) {
+        first += delim;
         first += *begin;
     }
 
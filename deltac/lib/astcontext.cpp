@@ -3,10 +3,130 @@
 
 namespace deltac {
 
-ASTContext::ASTContext() : builtin_types {
-#define BUILTIN_TYPE(ID, NAME, SIZE) BuiltinType::ID,
-#include "builtin_type.inc"
-} {}
+static std::string_view expr_kind_label(usize kind) {
+    switch ((Expr::ExprKind)kind) {
+    case Expr::BinaryExprKind: return "BinaryExpr";
+    case Expr::UnaryExprKind: return "UnaryExpr";
+    case Expr::CallExprKind: return "CallExpr";
+    case Expr::IndexExprKind: return "IndexExpr";
+    case Expr::ImplicitCastExprKind: return "ImplicitCastExpr";
+    case Expr::ExplicitCastExprKind: return "ExplicitCastExpr";
+    case Expr::IdExprKind: return "IdExpr";
+    case Expr::IntLiteralExprKind: return "IntLiteralExpr";
+    case Expr::ParenExprKind: return "ParenExpr";
+    case Expr::AssignExprKind: return "AssignExpr";
+    default: return "<unknown>";
+    }
+}
+
+static std::string_view stmt_kind_label(usize kind) {
+    switch ((Stmt::StmtKind)kind) {
+    case Stmt::CompoundStmtKind: return "CompoundStmt";
+    case Stmt::ExprStmtKind: return "ExprStmt";
+    case Stmt::DeclStmtKind: return "DeclStmt";
+    case Stmt::ReturnStmtKind: return "ReturnStmt";
+    case Stmt::IfStmtKind: return "IfStmt";
+    default: return "<unknown>";
+    }
+}
+
+static std::string_view decl_kind_label(usize kind) {
+    switch ((Decl::DeclKind)kind) {
+    case Decl::VarDeclKind: return "VarDecl";
+    case Decl::FuncDeclKind: return "FuncDecl";
+    case Decl::TypeDeclKind: return "TypeDecl";
+    default: return "<unknown>";
+    }
+}
+
+static std::string_view type_class_label(usize tc) {
+    switch ((Type::TypeClass)tc) {
+    case Type::Builtin: return "BuiltinType";
+    case Type::Ptr: return "PtrType";
+    case Type::Function: return "FunctionType";
+    default: return "<unknown>";
+    }
+}
+
+DELTAC_STATISTIC_ARRAY(NumExprs, "ast", "Number of expressions created", Expr::NumExprKinds, expr_kind_label);
+DELTAC_STATISTIC_ARRAY(NumStmts, "ast", "Number of statements created", Stmt::NumStmtKinds, stmt_kind_label);
+DELTAC_STATISTIC_ARRAY(NumDecls, "ast", "Number of declarations created", Decl::NumDeclKinds, decl_kind_label);
+
+DELTAC_STATISTIC_ARRAY(NumTypes, "types", "Number of types allocated", Type::Function + 1, type_class_label);
+DELTAC_STATISTIC(NumUniquedTypeHits, "types", "Number of type requests answered by an existing type");
+
+DELTAC_STATISTIC(NumContexts, "ast", "Number of AST contexts destroyed");
+DELTAC_STATISTIC(ArenaBytes, "ast", "Bytes allocated in AST arenas");
+DELTAC_STATISTIC(PeakArenaBytes, "ast", "Largest AST arena in bytes");
+DELTAC_STATISTIC(IdentifierTableBytes, "ast", "Bytes used by identifier tables");
+
+void Expr::count_node(ExprKind kind) {
+    NumExprs.add(kind);
+}
+
+void Stmt::count_node(StmtKind kind) {
+    NumStmts.add(kind);
+}
+
+void Decl::count_node(DeclKind kind) {
+    NumDecls.add(kind);
+}
+
+thread_local ASTContext::Arena* ASTContext::thread_arena = nullptr;
+
+ASTContext::ArenaScope::ArenaScope(const ASTContext& context) : saved(thread_arena) {
+    std::lock_guard<std::mutex> lock(context.mutex);
+
+    thread_arena = context.thread_arenas.emplace_back(std::make_unique<Arena>()).get();
+    thread_arena->owner = &context;
+}
+
+ASTContext::ArenaScope::~ArenaScope() {
+    thread_arena = saved;
+}
+
+ASTContext::~ASTContext() {
+    if (stats::is_enabled()) {
+        record_statistics();
+    }
+
+    // nodes are never destroyed one by one, only those owning memory outside
+    // of the arena have registered a cleanup
+    auto run_cleanups = [](Arena& arena) {
+        for (auto it = arena.cleanups.rbegin(); it != arena.cleanups.rend(); ++it) {
+            it->first(it->second);
+        }
+    };
+
+    for (auto& thread : thread_arenas) {
+        run_cleanups(*thread);
+    }
+
+    run_cleanups(arena);
+
+    // the arenas themselves are released by their allocators
+}
+
+usize ASTContext::arena_bytes_allocated() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    usize bytes = arena.allocator.getBytesAllocated();
+
+    for (const auto& thread : thread_arenas) {
+        bytes += thread->allocator.getBytesAllocated();
+    }
+
+    return bytes;
+}
+
+ASTContext::ASTContext() {
+    // types are never destroyed, they only hold references into the arena
+    for (usize kind = 0; kind < NUM_BUILTIN_TYPES; kind++) {
+        void* mem = allocate(sizeof(BuiltinType), alignof(BuiltinType));
+        builtin_types[kind] = new (mem) BuiltinType((BuiltinType::Kind)kind);
+    }
+
+    NumTypes.add(Type::Builtin, NUM_BUILTIN_TYPES);
+}
 
 BuiltinType* ASTContext::get_int_ty_size(u32 bitwidth, bool is_signed) const {
     assert(bitwidth == 8 || bitwidth == 16 || bitwidth == 32 || bitwidth == 64);
@@ -26,4 +146,55 @@ BuiltinType* ASTContext::get_int_ty_size(u32 bitwidth, bool is_signed) const {
     }
 }
 
+PtrType* ASTContext::get_ptr_type(QualType pointee) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    llvm::FoldingSetNodeID id;
+    PtrType::Profile(id, pointee);
+
+    void* insert_pos = nullptr;
+
+    if (PtrType* existing = ptr_types.FindNodeOrInsertPos(id, insert_pos)) {
+        ++NumUniquedTypeHits;
+        return existing;
+    }
+
+    NumTypes.add(Type::Ptr);
+
+    void* mem = allocate(sizeof(PtrType), alignof(PtrType));
+    auto* ty = new (mem) PtrType(pointee);
+
+    ptr_types.InsertNode(ty, insert_pos);
+    return ty;
+}
+
+FunctionType* ASTContext::get_function_type(llvm::ArrayRef<QualType> params, QualType return_ty) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    llvm::FoldingSetNodeID id;
+    FunctionType::Profile(id, params, return_ty);
+
+    void* insert_pos = nullptr;
+
+    if (FunctionType* existing = function_types.FindNodeOrInsertPos(id, insert_pos)) {
+        ++NumUniquedTypeHits;
+        return existing;
+    }
+
+    NumTypes.add(Type::Function);
+
+    void* mem = allocate(FunctionType::alloc_size(params.size()), alignof(FunctionType));
+    auto* ty = new (mem) FunctionType(params, return_ty);
+
+    function_types.InsertNode(ty, insert_pos);
+    return ty;
+}
+
+void ASTContext::record_statistics() const {
+    ++NumContexts;
+    ArenaBytes += arena_bytes_allocated();
+    PeakArenaBytes.update_max(arena_bytes_allocated());
+    IdentifierTableBytes += identifiers.memory_usage();
+}
+
 } // namespace deltac
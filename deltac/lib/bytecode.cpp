@@ -0,0 +1,1023 @@
+#include "bytecode.hpp"
+#include "stack.hpp"
+#include "statistic.hpp"
+#include "timetrace.hpp"
+
+#include "llvm/Support/DynamicLibrary.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+namespace deltac {
+
+DELTAC_STATISTIC(NumBytecodeFunctions, "bytecode", "Number of function bodies lowered to bytecode");
+DELTAC_STATISTIC(NumBytecodeInstrs, "bytecode", "Number of bytecode instructions emitted");
+DELTAC_STATISTIC(NumSuperInstrs, "bytecode", "Number of superinstructions emitted");
+
+namespace bc {
+
+std::string_view op_name(Op op) {
+    static constexpr std::string_view NAMES[] = {
+#define OPCODE(X) #X,
+#include "opcodes.inc"
+    };
+
+    return op < NumOps ? NAMES[op] : "<invalid>";
+}
+
+u32 Module::find_function(std::string_view name) const {
+    for (usize i = 0; i < functions.size(); i++) {
+        if (functions[i].name == name) {
+            return (u32)i;
+        }
+    }
+
+    return NO_FUNCTION;
+}
+
+void Module::dump(std::ostream& os) const {
+    for (const NativeFunction& native : natives) {
+        os << "native " << native.name << " (" << native.num_params << " params)\n";
+    }
+
+    for (const Function& fn : functions) {
+        os << "\nfunction " << fn.name << " (" << fn.num_params << " params, "
+           << fn.num_registers << " registers)\n";
+
+        for (usize i = 0; i < fn.code.size(); i++) {
+            const Instr& instr = fn.code[i];
+
+            os << "  " << i << ": " << op_name(instr.op) << ' ' << instr.a << ", " << instr.b << ", "
+               << instr.c << ", " << instr.imm << '\n';
+        }
+    }
+}
+
+} // namespace bc
+
+static Expr* ignore_parens(Expr* expr) {
+    while (auto* paren = util::dyn_cast<ParenExpr>(expr)) {
+        expr = paren->sub_expr();
+    }
+
+    return expr;
+}
+
+// the bits of value as held by a register of type ty
+static u64 canonicalize(u64 value, const QualType& ty) {
+    const usize bits = ty.size() * 8;
+
+    if (bits >= 64 || bits == 0) {
+        return value;
+    }
+
+    const u64 mask = (u64(1) << bits) - 1;
+
+    if (ty.is_signed_ty()) {
+        const u64 sign = u64(1) << (bits - 1);
+        return ((value & mask) ^ sign) - sign;
+    }
+
+    return value & mask;
+}
+
+// the value of an integer literal, possibly converted, as held by a register
+static std::optional<i64> constant_value(Expr* expr) {
+    expr = ignore_parens(expr);
+
+    if (auto* literal = util::dyn_cast<IntLiteralExpr>(expr)) {
+        return (i64)canonicalize(literal->get_value().zextOrTrunc(64).getZExtValue(), expr->type());
+    }
+
+    auto* cast = util::dyn_cast<CastExpr>(expr);
+
+    if (cast && (cast->cast_kind() == CastExpr::IntCast || cast->cast_kind() == CastExpr::NoOp)) {
+        if (auto value = constant_value(cast->castee())) {
+            return (i64)canonicalize((u64)*value, expr->type());
+        }
+    }
+
+    return std::nullopt;
+}
+
+// natives are told apart from functions with a body in function_indices by this bit
+static constexpr u32 NATIVE_BIT = 1u << 31;
+
+BytecodeGen::BytecodeGen(const ASTContext& context) : context(context) {}
+
+/*
+ * Like in CodeGen, functions are entered first so that initializers and bodies can call
+ * any of them, then the global initializers are lowered, then the bodies.
+ */
+bool BytecodeGen::generate(bc::Module& out, std::string& error) {
+    TimeTraceScope scope("Bytecode gen");
+
+    // makes the symbols of the process itself searchable
+    static std::once_flag once;
+    std::call_once(once, []() { llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr); });
+
+    module = &out;
+
+    for (FuncDecl* fn : context.toplevel_funcdecls()) {
+        const auto* ty = util::cast<FunctionType>(fn->decl_type().raw_type());
+        const std::string name(fn->get_identifier());
+        const usize num_params = ty->param_types().size();
+
+        // nothing that was parsed can call it
+        if (fn->is_body_pending()) {
+            continue;
+        }
+
+        if (fn->has_body()) {
+            function_indices[fn] = (u32)module->functions.size();
+
+            bc::Function& func = module->functions.emplace_back();
+            func.name = name;
+            func.num_params = (u16)num_params;
+            func.returns_value = !ty->return_type().is_void_ty();
+            continue;
+        }
+
+        void* address = llvm::sys::DynamicLibrary::SearchForAddressOfSymbol(name);
+
+        if (!address) {
+            error = "undefined function '" + name + "'";
+            return false;
+        }
+
+        // see call_native in the interpreter
+        if (num_params > 6) {
+            unsupported("calls to native functions with more than 6 parameters");
+        }
+
+        function_indices[fn] = (u32)module->natives.size() | NATIVE_BIT;
+        module->natives.push_back({ name, address, (u16)num_params });
+    }
+
+    for (VarDecl* var : context.toplevel_vardecls()) {
+        global_slots[var] = (u32)module->globals.size();
+        module->globals.push_back(0);
+    }
+
+    for (VarDecl* var : context.toplevel_vardecls()) {
+        if (!var->has_body()) {
+            continue;
+        }
+
+        if (auto value = constant_value(var->get_expr())) {
+            module->globals[global_slots[var]] = (u64)*value;
+            continue;
+        }
+
+        if (!curr_function) {
+            module->init_function = (u32)module->functions.size();
+            curr_function = &module->functions.emplace_back();
+            curr_function->name = "__deltac_global_init";
+        }
+
+        write_place({ Place::Global, 0, global_slots[var], var->decl_type() }, emit_expr(var->get_expr()));
+        next_register = first_temporary;
+    }
+
+    if (curr_function) {
+        emit(bc::ReturnVoid);
+        curr_function = nullptr;
+    }
+
+    for (FuncDecl* fn : context.toplevel_funcdecls()) {
+        if (fn->has_body()) {
+            emit_function(fn);
+        }
+    }
+
+    module = nullptr;
+
+    if (!unsupported_what.empty()) {
+        error = "cannot interpret " + unsupported_what;
+        return false;
+    }
+
+    return true;
+}
+
+void BytecodeGen::emit_function(FuncDecl* fn) {
+    TimeTraceScope scope("Bytecode gen function", fn->get_identifier());
+
+    ++NumBytecodeFunctions;
+
+    curr_function = &module->functions[function_indices[fn]];
+    local_registers.clear();
+    next_register = 0;
+
+    // the arguments are left in the first registers by the caller
+    for (VarDecl* param : fn->param_decls()) {
+        local_registers[param] = new_register();
+    }
+
+    first_temporary = next_register;
+    reachable = true;
+
+    emit_stmt(fn->get_body());
+
+    // falling off the end of the body, Sema has rejected it unless the function returns void
+    if (reachable) {
+        DELTA_ASSERT(!curr_function->returns_value);
+        emit(bc::ReturnVoid);
+    }
+
+    curr_function = nullptr;
+}
+
+void BytecodeGen::emit_stmt(Stmt* stmt) {
+    if (stack::is_nearly_exhausted()) {
+        unsupported("statements nested this deeply");
+        return;
+    }
+
+    switch (stmt->stmt_kind()) {
+    case Stmt::CompoundStmtKind:
+        for (Stmt* s : util::cast<CompoundStmt>(stmt)->body()) {
+            if (!reachable) {
+                break;
+            }
+
+            emit_stmt(s);
+        }
+        break;
+
+    case Stmt::ExprStmtKind: {
+        Expr* expr = util::cast<ExprStmt>(stmt)->get_expr();
+
+        if (expr->is_lval()) {
+            emit_place(expr);
+        }
+        else {
+            emit_expr(expr);
+        }
+        break;
+    }
+
+    case Stmt::DeclStmtKind:
+        if (auto* var = util::dyn_cast<VarDecl>(util::cast<DeclStmt>(stmt)->get_decl())) {
+            emit_local_var(var);
+        }
+        else {
+            unsupported("local declarations other than variables");
+        }
+        break;
+
+    case Stmt::ReturnStmtKind:
+        emit_return_stmt(util::cast<ReturnStmt>(stmt));
+        break;
+
+    case Stmt::IfStmtKind:
+        emit_if_stmt(util::cast<IfStmt>(stmt));
+        break;
+
+    default:
+        unsupported("this statement");
+        break;
+    }
+
+    // the temporaries of a statement are dead after it
+    next_register = first_temporary;
+}
+
+void BytecodeGen::emit_if_stmt(IfStmt* stmt) {
+    const usize jump_else = emit_jump_if_false(stmt->get_cond());
+    next_register = first_temporary;
+
+    emit_stmt(stmt->get_then());
+
+    if (!stmt->has_else()) {
+        patch_jump(jump_else);
+        reachable = true;
+        return;
+    }
+
+    const bool then_reachable = reachable;
+    const usize jump_end = then_reachable ? emit(bc::Jump) : 0;
+
+    patch_jump(jump_else);
+    reachable = true;
+
+    emit_stmt(stmt->get_else());
+
+    if (then_reachable) {
+        patch_jump(jump_end);
+        reachable = true;
+    }
+}
+
+void BytecodeGen::emit_return_stmt(ReturnStmt* stmt) {
+    if (stmt->has_expr()) {
+        emit(bc::Return, emit_expr(stmt->get_expr()));
+    }
+    else {
+        emit(bc::ReturnVoid);
+    }
+
+    reachable = false;
+}
+
+void BytecodeGen::emit_local_var(VarDecl* var) {
+    // below the temporaries of this and every later statement
+    const u16 reg = new_register();
+    first_temporary = next_register;
+
+    local_registers[var] = reg;
+
+    if (var->has_body()) {
+        emit_expr(var->get_expr(), reg);
+    }
+    else {
+        emit(bc::LoadImm, reg);
+    }
+}
+
+template <class T>
+static std::optional<T> constant_operand(Expr* expr) {
+    auto value = constant_value(expr);
+
+    if (!value || *value < std::numeric_limits<T>::min() || *value > std::numeric_limits<T>::max()) {
+        return std::nullopt;
+    }
+
+    return (T)*value;
+}
+
+static bool is_i32(const QualType& ty) {
+    return ty.is_integer_ty() && ty.is_signed_ty() && ty.size() == 4;
+}
+
+// the jump of an if taken when the comparison is false, relative to JumpEq
+static std::optional<u16> inverted_jump(BinaryOp op) {
+    switch (op) {
+    case BinaryOp::Equal: return bc::JumpNe - bc::JumpEq;
+    case BinaryOp::NotEqual: return bc::JumpEq - bc::JumpEq;
+    case BinaryOp::Less: return bc::JumpGe - bc::JumpEq;
+    case BinaryOp::LessEqual: return bc::JumpGt - bc::JumpEq;
+    case BinaryOp::Greater: return bc::JumpLe - bc::JumpEq;
+    case BinaryOp::GreaterEqual: return bc::JumpLt - bc::JumpEq;
+    default: return std::nullopt;
+    }
+}
+
+usize BytecodeGen::emit_jump_if_false(Expr* cond) {
+    cond = ignore_parens(cond);
+
+    if (auto* binary = util::dyn_cast<BinaryExpr>(cond)) {
+        const BinaryOp op = binary->op_code();
+        auto jump = inverted_jump(op);
+
+        // the fused jumps compare signed, which is also right for == and != on any type
+        const bool is_equality = op == BinaryOp::Equal || op == BinaryOp::NotEqual;
+
+        if (jump && (is_equality || binary->lhs()->type().is_signed_ty())) {
+            const u16 lhs = emit_expr(binary->lhs());
+
+            if (auto imm = constant_operand<i16>(binary->rhs())) {
+                return emit(bc::Op(bc::JumpEqImm + *jump), lhs, 0, (u16)*imm);
+            }
+
+            return emit(bc::Op(bc::JumpEq + *jump), lhs, emit_expr(binary->rhs()));
+        }
+    }
+
+    if (auto* unary = util::dyn_cast<UnaryExpr>(cond); unary && unary->op_code() == UnaryOp::Not) {
+        return emit(bc::JumpIfTrue, emit_expr(unary->expr()));
+    }
+
+    return emit(bc::JumpIfFalse, emit_expr(cond));
+}
+
+u16 BytecodeGen::emit_expr(Expr* expr, std::optional<u16> dst) {
+    DELTA_ASSERT(expr->is_rval());
+
+    if (stack::is_nearly_exhausted()) {
+        unsupported("expressions nested this deeply");
+        return target_register(dst);
+    }
+
+    u16 reg = 0;
+
+    switch (expr->expr_kind()) {
+    case Expr::IntLiteralExprKind:
+        reg = target_register(dst);
+        emit_load_constant(reg, (u64)*constant_value(expr));
+        break;
+
+    case Expr::BinaryExprKind:
+        reg = emit_binary_expr(util::cast<BinaryExpr>(expr), dst);
+        break;
+
+    case Expr::UnaryExprKind:
+        reg = emit_unary_expr(util::cast<UnaryExpr>(expr), dst);
+        break;
+
+    case Expr::ImplicitCastExprKind:
+    case Expr::ExplicitCastExprKind:
+        reg = emit_cast_expr(util::cast<CastExpr>(expr), dst);
+        break;
+
+    case Expr::CallExprKind:
+        reg = emit_call_expr(util::cast<CallExpr>(expr), dst);
+        break;
+
+    case Expr::ParenExprKind:
+        return emit_expr(util::cast<ParenExpr>(expr)->sub_expr(), dst);
+
+    default:
+        unsupported("this expression");
+        return target_register(dst);
+    }
+
+    // reads of locals and free casts are the register of their operand
+    if (dst && reg != *dst) {
+        emit(bc::Move, *dst, reg);
+        return *dst;
+    }
+
+    return reg;
+}
+
+BytecodeGen::Place BytecodeGen::emit_place(Expr* expr) {
+    DELTA_ASSERT(expr->is_lval());
+
+    if (stack::is_nearly_exhausted()) {
+        unsupported("expressions nested this deeply");
+        return { Place::Register, 0, 0, expr->type() };
+    }
+
+    switch (expr->expr_kind()) {
+    case Expr::IdExprKind: {
+        const Decl* decl = util::cast<IdExpr>(expr)->get_decl();
+
+        if (auto it = local_registers.find(decl); it != local_registers.end()) {
+            return { Place::Register, it->second, 0, expr->type() };
+        }
+
+        if (auto it = global_slots.find(decl); it != global_slots.end()) {
+            return { Place::Global, 0, it->second, expr->type() };
+        }
+
+        break;
+    }
+
+    case Expr::ParenExprKind:
+        return emit_place(util::cast<ParenExpr>(expr)->sub_expr());
+
+    case Expr::UnaryExprKind: {
+        auto* unary = util::cast<UnaryExpr>(expr);
+
+        DELTA_ASSERT(unary->op_code() == UnaryOp::Deref);
+        return { Place::Memory, emit_expr(unary->expr()), 0, expr->type() };
+    }
+
+    case Expr::AssignExprKind:
+        return emit_assign_expr(util::cast<AssignExpr>(expr));
+
+    default:
+        break;
+    }
+
+    unsupported("this lvalue");
+    return { Place::Register, 0, 0, expr->type() };
+}
+
+// r[dst] = r[src] + imm or r[src] - imm on values of type ty
+static bc::Op immediate_op(BinaryOp op, const QualType& ty) {
+    if (is_i32(ty)) {
+        return op == BinaryOp::Plus ? bc::AddImm32 : bc::SubImm32;
+    }
+
+    return op == BinaryOp::Plus ? bc::AddImm : bc::SubImm;
+}
+
+u16 BytecodeGen::emit_binary_expr(BinaryExpr* expr, std::optional<u16> dst) {
+    // a chain like a + b + c is a tree as deep as it has operators, all leaning on the
+    // left operand; the innermost operation is emitted first and the others are applied
+    // to its result in a loop, so only the right operands recurse
+    llvm::SmallVector<BinaryExpr*, 8> chain = { expr };
+
+    while (auto* lhs = util::dyn_cast<BinaryExpr>(chain.back()->lhs())) {
+        chain.push_back(lhs);
+    }
+
+    if (chain.size() == 1) {
+        return emit_binary_operation(expr, dst);
+    }
+
+    // a new temporary, which holds the result of the chain so far
+    const u16 acc = emit_binary_operation(chain.back(), std::nullopt);
+    DELTA_ASSERT(acc >= first_temporary);
+
+    for (usize i = chain.size() - 1; i-- > 1;) {
+        // only acc is live, the temporaries of the right operands before are free again
+        next_register = acc + 1;
+        apply_binary_operation(chain[i], acc, acc);
+    }
+
+    next_register = acc + 1;
+
+    // like a single operation, dst is only written once both operands are read
+    const BinaryOp op = expr->op_code();
+    const u16 reg = dst && op != BinaryOp::And && op != BinaryOp::Or ? *dst : acc;
+
+    apply_binary_operation(expr, acc, reg);
+    return reg;
+}
+
+u16 BytecodeGen::emit_binary_operation(BinaryExpr* expr, std::optional<u16> dst) {
+    const BinaryOp op = expr->op_code();
+
+    if (op == BinaryOp::And || op == BinaryOp::Or) {
+        return emit_logical_expr(expr);
+    }
+
+    // Sema converted both operands to the same type
+    const QualType& ty = expr->lhs()->type();
+
+    if ((op == BinaryOp::Plus || op == BinaryOp::Minus) && ty.is_integer_ty()) {
+        Expr* operand = expr->lhs();
+        auto imm = constant_operand<i32>(expr->rhs());
+
+        if (!imm && op == BinaryOp::Plus) {
+            operand = expr->rhs();
+            imm = constant_operand<i32>(expr->lhs());
+        }
+
+        if (imm) {
+            const u16 src = emit_expr(operand);
+            const u16 reg = target_register(dst);
+
+            emit_arithmetic_imm(op, ty, reg, src, *imm);
+            return reg;
+        }
+    }
+
+    const u16 lhs = emit_expr(expr->lhs());
+    const u16 rhs = emit_expr(expr->rhs());
+    const u16 reg = target_register(dst);
+
+    emit_arithmetic(op, ty, reg, lhs, rhs);
+    return reg;
+}
+
+void BytecodeGen::apply_binary_operation(BinaryExpr* expr, u16 lhs, u16 dst) {
+    const BinaryOp op = expr->op_code();
+
+    if (op == BinaryOp::And || op == BinaryOp::Or) {
+        DELTA_ASSERT(lhs == dst);
+
+        // the result is known from lhs when it is true for || and false for &&
+        const usize jump = emit(op == BinaryOp::Or ? bc::JumpIfTrue : bc::JumpIfFalse, lhs);
+
+        emit_expr(expr->rhs(), dst);
+        patch_jump(jump);
+        return;
+    }
+
+    // Sema converted both operands to the same type
+    const QualType& ty = expr->lhs()->type();
+
+    if ((op == BinaryOp::Plus || op == BinaryOp::Minus) && ty.is_integer_ty()) {
+        if (auto imm = constant_operand<i32>(expr->rhs())) {
+            emit_arithmetic_imm(op, ty, dst, lhs, *imm);
+            return;
+        }
+    }
+
+    emit_arithmetic(op, ty, dst, lhs, emit_expr(expr->rhs()));
+}
+
+u16 BytecodeGen::emit_logical_expr(BinaryExpr* expr) {
+    // never the destination, the right operand may still read the variable assigned to
+    const u16 reg = new_register();
+
+    emit_expr(expr->lhs(), reg);
+    apply_binary_operation(expr, reg, reg);
+
+    return reg;
+}
+
+u16 BytecodeGen::emit_unary_expr(UnaryExpr* expr, std::optional<u16> dst) {
+    if (expr->op_code() == UnaryOp::Plus) {
+        return emit_expr(expr->expr(), dst);
+    }
+
+    if (expr->op_code() == UnaryOp::AddressOf) {
+        unsupported("taking the address of a variable");
+        return target_register(dst);
+    }
+
+    const u16 src = emit_expr(expr->expr());
+    const u16 reg = target_register(dst);
+
+    switch (expr->op_code()) {
+    case UnaryOp::Minus:
+        emit(bc::Neg, reg, src);
+        emit_normalize(expr->type(), reg, reg);
+        break;
+    case UnaryOp::BitwiseNot:
+        emit(bc::Not, reg, src);
+        emit_normalize(expr->type(), reg, reg);
+        break;
+    // the operand of ! is a bool
+    case UnaryOp::Not:
+        emit(bc::LogicalNot, reg, src);
+        break;
+    case UnaryOp::Plus:
+    case UnaryOp::Deref:
+    case UnaryOp::AddressOf:
+        DELTA_UNREACHABLE("handled above or an lvalue");
+    }
+
+    return reg;
+}
+
+// true if the register of a value of type from already holds it as a value of type to
+static bool is_free_int_cast(const QualType& from, const QualType& to) {
+    const usize from_size = from.size();
+    const usize to_size = to.size();
+
+    if (to_size >= 8 || from.is_bool_ty()) {
+        return true;
+    }
+
+    if (from.is_signed_ty() == to.is_signed_ty()) {
+        return to_size >= from_size;
+    }
+
+    // a zero extended value fits a wider signed type
+    return to_size > from_size && to.is_signed_ty();
+}
+
+u16 BytecodeGen::emit_cast_expr(CastExpr* expr, std::optional<u16> dst) {
+    if (expr->cast_kind() == CastExpr::LValueToRValue) {
+        return read_place(emit_place(expr->castee()), dst);
+    }
+
+    const u16 src = emit_expr(expr->castee());
+
+    switch (expr->cast_kind()) {
+    case CastExpr::NoOp:
+        return src;
+
+    case CastExpr::IntCast: {
+        if (is_free_int_cast(expr->castee()->type(), expr->type())) {
+            return src;
+        }
+
+        const u16 reg = target_register(dst);
+
+        emit_normalize(expr->type(), reg, src);
+        return reg;
+    }
+
+    case CastExpr::IntToBool:
+    case CastExpr::PtrToBool: {
+        const u16 reg = target_register(dst);
+
+        emit(bc::ToBool, reg, src);
+        return reg;
+    }
+
+    default:
+        unsupported("this conversion");
+        return src;
+    }
+}
+
+u16 BytecodeGen::emit_call_expr(CallExpr* expr, std::optional<u16> dst) {
+    auto* callee = util::dyn_cast<IdExpr>(ignore_parens(expr->expr()));
+    auto it = callee ? function_indices.find(callee->get_decl()) : function_indices.end();
+
+    if (it == function_indices.end()) {
+        unsupported("calls through pointers");
+        return target_register(dst);
+    }
+
+    // the arguments go to consecutive registers, which start the window of the callee
+    const u16 base = next_register;
+    const usize num_args = expr->arguments().size();
+
+    for (usize i = 0; i < std::max<usize>(num_args, 1); i++) {
+        new_register();
+    }
+
+    for (usize i = 0; i < num_args; i++) {
+        emit_expr(expr->arguments()[i], (u16)(base + i));
+    }
+
+    if (!(it->second & NATIVE_BIT)) {
+        emit(bc::Call, base, 0, 0, (i32)it->second);
+        return base;
+    }
+
+    emit(bc::CallNative, base, (u16)num_args, 0, (i32)(it->second & ~NATIVE_BIT));
+
+    // only the low bits of a narrower return value are defined
+    const QualType& ret_ty = expr->type();
+
+    if (ret_ty.is_bool_ty()) {
+        emit(bc::Zext8, base, base);
+    }
+    else if (!ret_ty.is_void_ty()) {
+        emit_normalize(ret_ty, base, base);
+    }
+
+    return base;
+}
+
+static BinaryOp to_binary_operator(AssignOp op) {
+    switch (op) {
+    case AssignOp::PlusEqual: return BinaryOp::Plus;
+    case AssignOp::MinusEqual: return BinaryOp::Minus;
+    case AssignOp::TimesEqual: return BinaryOp::Multiply;
+    case AssignOp::DevideEqual: return BinaryOp::Divide;
+    case AssignOp::ModEqual: return BinaryOp::Modulo;
+    case AssignOp::LeftShiftEqual: return BinaryOp::LeftShift;
+    case AssignOp::RightShiftEqual: return BinaryOp::RightShift;
+    case AssignOp::OrEqual: return BinaryOp::BitwiseOr;
+    case AssignOp::AndEqual: return BinaryOp::BitwiseAnd;
+    case AssignOp::XorEqual: return BinaryOp::BitwiseXor;
+    case AssignOp::Equal: break;
+    }
+
+    DELTA_UNREACHABLE("plain assignment has no binary operator");
+}
+
+BytecodeGen::Place BytecodeGen::emit_assign_expr(AssignExpr* expr) {
+    const Place place = emit_place(expr->lhs());
+
+    if (expr->op_code() == AssignOp::Equal) {
+        // a local is assigned by evaluating straight into its register
+        if (place.kind == Place::Register) {
+            emit_expr(expr->rhs(), place.reg);
+        }
+        else {
+            write_place(place, emit_expr(expr->rhs()));
+        }
+
+        return place;
+    }
+
+    const BinaryOp op = to_binary_operator(expr->op_code());
+    const u16 curr = read_place(place, std::nullopt);
+    const u16 reg = place.kind == Place::Register ? place.reg : new_register();
+
+    auto imm = constant_operand<i32>(expr->rhs());
+
+    if ((op == BinaryOp::Plus || op == BinaryOp::Minus) && place.type.is_integer_ty() && imm) {
+        const bc::Op imm_op = immediate_op(op, place.type);
+
+        emit(imm_op, reg, curr, 0, *imm);
+
+        if (imm_op == bc::AddImm || imm_op == bc::SubImm) {
+            emit_normalize(place.type, reg, reg);
+        }
+    }
+    else {
+        emit_arithmetic(op, place.type, reg, curr, emit_expr(expr->rhs()));
+    }
+
+    write_place(place, reg);
+
+    // the assignment designates the object assigned to
+    return place;
+}
+
+void BytecodeGen::emit_arithmetic_imm(BinaryOp op, const QualType& ty, u16 dst, u16 src, i32 imm) {
+    const bc::Op imm_op = immediate_op(op, ty);
+
+    emit(imm_op, dst, src, 0, imm);
+
+    if (imm_op == bc::AddImm || imm_op == bc::SubImm) {
+        emit_normalize(ty, dst, dst);
+    }
+}
+
+void BytecodeGen::emit_arithmetic(BinaryOp op, const QualType& ty, u16 dst, u16 lhs, u16 rhs) {
+    const bool is_signed = ty.is_signed_ty();
+
+    if (is_i32(ty)) {
+        switch (op) {
+        case BinaryOp::Plus:
+            emit(bc::Add32, dst, lhs, rhs);
+            return;
+        case BinaryOp::Minus:
+            emit(bc::Sub32, dst, lhs, rhs);
+            return;
+        case BinaryOp::Multiply:
+            emit(bc::Mul32, dst, lhs, rhs);
+            return;
+        default:
+            break;
+        }
+    }
+
+    bc::Op instr = bc::Add;
+    // false if the result of canonical operands is canonical
+    bool normalize = false;
+    i32 imm = 0;
+
+    switch (op) {
+    case BinaryOp::Plus:
+        instr = bc::Add;
+        normalize = true;
+        break;
+    case BinaryOp::Minus:
+        instr = bc::Sub;
+        normalize = true;
+        break;
+    case BinaryOp::Multiply:
+        instr = bc::Mul;
+        normalize = true;
+        break;
+    // the interpreter traps on the minimum value divided by -1, it needs the width
+    case BinaryOp::Divide:
+        instr = is_signed ? bc::SDiv : bc::UDiv;
+        imm = is_signed ? (i32)ty.size() * 8 : 0;
+        break;
+    case BinaryOp::Modulo:
+        instr = is_signed ? bc::SRem : bc::URem;
+        imm = is_signed ? (i32)ty.size() * 8 : 0;
+        break;
+    case BinaryOp::LeftShift:
+        instr = bc::Shl;
+        normalize = true;
+        break;
+    case BinaryOp::RightShift:
+        instr = is_signed ? bc::AShr : bc::LShr;
+        break;
+    case BinaryOp::BitwiseAnd:
+        instr = bc::And;
+        break;
+    case BinaryOp::BitwiseOr:
+        instr = bc::Or;
+        break;
+    case BinaryOp::BitwiseXor:
+        instr = bc::Xor;
+        break;
+    case BinaryOp::Equal:
+        instr = bc::Eq;
+        break;
+    case BinaryOp::NotEqual:
+        instr = bc::Ne;
+        break;
+    case BinaryOp::Less:
+        instr = is_signed ? bc::SLt : bc::ULt;
+        break;
+    case BinaryOp::LessEqual:
+        instr = is_signed ? bc::SLe : bc::ULe;
+        break;
+    case BinaryOp::Greater:
+        instr = is_signed ? bc::SGt : bc::UGt;
+        break;
+    case BinaryOp::GreaterEqual:
+        instr = is_signed ? bc::SGe : bc::UGe;
+        break;
+    case BinaryOp::And:
+    case BinaryOp::Or:
+        DELTA_UNREACHABLE("logical operators short circuit");
+    }
+
+    emit(instr, dst, lhs, rhs, imm);
+
+    if (normalize) {
+        emit_normalize(ty, dst, dst);
+    }
+}
+
+void BytecodeGen::emit_normalize(const QualType& ty, u16 dst, u16 src) {
+    const usize size = ty.size();
+
+    if (size >= 8 || ty.is_bool_ty() || !ty.is_integer_ty()) {
+        if (dst != src) {
+            emit(bc::Move, dst, src);
+        }
+
+        return;
+    }
+
+    const bool is_signed = ty.is_signed_ty();
+
+    switch (size) {
+    case 1:
+        emit(is_signed ? bc::Sext8 : bc::Zext8, dst, src);
+        break;
+    case 2:
+        emit(is_signed ? bc::Sext16 : bc::Zext16, dst, src);
+        break;
+    default:
+        emit(is_signed ? bc::Sext32 : bc::Zext32, dst, src);
+        break;
+    }
+}
+
+static bc::MemKind memory_kind(const QualType& ty) {
+    if (ty.is_ptr_ty()) {
+        return bc::MemU64;
+    }
+
+    const bool is_signed = ty.is_signed_ty();
+
+    switch (ty.size()) {
+    case 1:
+        return is_signed ? bc::MemI8 : bc::MemU8;
+    case 2:
+        return is_signed ? bc::MemI16 : bc::MemU16;
+    case 4:
+        return is_signed ? bc::MemI32 : bc::MemU32;
+    default:
+        return is_signed ? bc::MemI64 : bc::MemU64;
+    }
+}
+
+u16 BytecodeGen::read_place(const Place& place, std::optional<u16> dst) {
+    switch (place.kind) {
+    case Place::Register:
+        return place.reg;
+
+    case Place::Global: {
+        const u16 reg = target_register(dst);
+
+        emit(bc::LoadGlobal, reg, 0, 0, (i32)place.global);
+        return reg;
+    }
+
+    case Place::Memory: {
+        const u16 reg = target_register(dst);
+
+        emit(bc::Load, reg, place.reg, memory_kind(place.type));
+        return reg;
+    }
+    }
+
+    DELTA_UNREACHABLE("unknown place");
+}
+
+void BytecodeGen::write_place(const Place& place, u16 src) {
+    switch (place.kind) {
+    case Place::Register:
+        if (place.reg != src) {
+            emit(bc::Move, place.reg, src);
+        }
+        break;
+
+    case Place::Global:
+        emit(bc::StoreGlobal, src, 0, 0, (i32)place.global);
+        break;
+
+    case Place::Memory:
+        emit(bc::Store, place.reg, src, memory_kind(place.type));
+        break;
+    }
+}
+
+usize BytecodeGen::emit(bc::Op op, u16 a, u16 b, u16 c, i32 imm) {
+    ++NumBytecodeInstrs;
+
+    if (op >= bc::Add32) {
+        ++NumSuperInstrs;
+    }
+
+    curr_function->code.push_back({ op, a, b, c, imm });
+    return curr_function->code.size() - 1;
+}
+
+void BytecodeGen::emit_load_constant(u16 dst, u64 value) {
+    if ((i64)value >= std::numeric_limits<i32>::min() && (i64)value <= std::numeric_limits<i32>::max()) {
+        emit(bc::LoadImm, dst, 0, 0, (i32)(i64)value);
+        return;
+    }
+
+    emit(bc::LoadConst, dst, 0, 0, (i32)module->constants.size());
+    module->constants.push_back(value);
+}
+
+void BytecodeGen::patch_jump(usize jump) {
+    curr_function->code[jump].imm = (i32)curr_function->code.size();
+}
+
+u16 BytecodeGen::new_register() {
+    if (next_register == std::numeric_limits<u16>::max()) {
+        unsupported("functions that need more than 65535 registers");
+        return 0;
+    }
+
+    const u16 reg = next_register++;
+    curr_function->num_registers = std::max(curr_function->num_registers, next_register);
+
+    return reg;
+}
+
+void BytecodeGen::unsupported(std::string_view what) {
+    if (unsupported_what.empty()) {
+        unsupported_what = what;
+    }
+}
+
+}
@@ -0,0 +1,205 @@
+#include "charscan.hpp"
+#include "charinfo.hpp"
+
+#if defined(__SSE2__)
+#define DELTA_HAS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace deltac {
+
+namespace {
+
+const char* skip_whitespace_scalar(const char* ptr, const char* end) {
+    while (ptr != end && is_whitespace(*ptr)) {
+        ptr++;
+    }
+
+    return ptr;
+}
+
+const char* find_first_of_scalar(const char* ptr, const char* end, char a, char b) {
+    while (ptr != end && *ptr != a && *ptr != b) {
+        ptr++;
+    }
+
+    return ptr;
+}
+
+const char* find_first_of4_scalar(const char* ptr, const char* end, char a, char b, char c, char d) {
+    while (ptr != end && *ptr != a && *ptr != b && *ptr != c && *ptr != d) {
+        ptr++;
+    }
+
+    return ptr;
+}
+
+#ifdef DELTA_HAS_X86_SIMD
+
+// whitespace is ' ' or one of '\t', '\n', '\v', '\f', '\r' (9 to 13)
+inline __m128i whitespace_mask_sse2(__m128i chunk) {
+    __m128i is_space = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '));
+    __m128i offset = _mm_sub_epi8(chunk, _mm_set1_epi8('\t'));
+    __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(4)), offset);
+    return _mm_or_si128(is_space, in_range);
+}
+
+const char* skip_whitespace_sse2(const char* ptr, const char* end) {
+    for (; end - ptr >= 16; ptr += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(whitespace_mask_sse2(chunk)) & 0xFFFFu;
+
+        if (mask != 0) {
+            return ptr + __builtin_ctz(mask);
+        }
+    }
+
+    return skip_whitespace_scalar(ptr, end);
+}
+
+const char* find_first_of_sse2(const char* ptr, const char* end, char a, char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+
+    for (; end - ptr >= 16; ptr += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb));
+        unsigned mask = (unsigned)_mm_movemask_epi8(found);
+
+        if (mask != 0) {
+            return ptr + __builtin_ctz(mask);
+        }
+    }
+
+    return find_first_of_scalar(ptr, end, a, b);
+}
+
+const char* find_first_of4_sse2(const char* ptr, const char* end, char a, char b, char c, char d) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+    const __m128i vd = _mm_set1_epi8(d);
+
+    for (; end - ptr >= 16; ptr += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        __m128i found = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, vc), _mm_cmpeq_epi8(chunk, vd))
+        );
+        unsigned mask = (unsigned)_mm_movemask_epi8(found);
+
+        if (mask != 0) {
+            return ptr + __builtin_ctz(mask);
+        }
+    }
+
+    return find_first_of4_scalar(ptr, end, a, b, c, d);
+}
+
+__attribute__((target("avx2")))
+const char* skip_whitespace_avx2(const char* ptr, const char* end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i range = _mm256_set1_epi8(4);
+
+    for (; end - ptr >= 32; ptr += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        __m256i is_space = _mm256_cmpeq_epi8(chunk, space);
+        __m256i offset = _mm256_sub_epi8(chunk, tab);
+        __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, range), offset);
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_or_si256(is_space, in_range));
+
+        if (mask != 0) {
+            return ptr + __builtin_ctz(mask);
+        }
+    }
+
+    return skip_whitespace_sse2(ptr, end);
+}
+
+__attribute__((target("avx2")))
+const char* find_first_of_avx2(const char* ptr, const char* end, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+
+    for (; end - ptr >= 32; ptr += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(found);
+
+        if (mask != 0) {
+            return ptr + __builtin_ctz(mask);
+        }
+    }
+
+    return find_first_of_sse2(ptr, end, a, b);
+}
+
+__attribute__((target("avx2")))
+const char* find_first_of4_avx2(const char* ptr, const char* end, char a, char b, char c, char d) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    const __m256i vc = _mm256_set1_epi8(c);
+    const __m256i vd = _mm256_set1_epi8(d);
+
+    for (; end - ptr >= 32; ptr += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        __m256i found = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, vc), _mm256_cmpeq_epi8(chunk, vd))
+        );
+        unsigned mask = (unsigned)_mm256_movemask_epi8(found);
+
+        if (mask != 0) {
+            return ptr + __builtin_ctz(mask);
+        }
+    }
+
+    return find_first_of4_sse2(ptr, end, a, b, c, d);
+}
+
+#endif
+
+struct ScanImpl {
+    const char* (*skip_whitespace)(const char*, const char*);
+    const char* (*find_first_of)(const char*, const char*, char, char);
+    const char* (*find_first_of4)(const char*, const char*, char, char, char, char);
+    const char* name;
+};
+
+ScanImpl select_impl() {
+#ifdef DELTA_HAS_X86_SIMD
+    // runs during static initialization, before the cpu model is guaranteed to be set up
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return { skip_whitespace_avx2, find_first_of_avx2, find_first_of4_avx2, "avx2" };
+    }
+
+    return { skip_whitespace_sse2, find_first_of_sse2, find_first_of4_sse2, "sse2" };
+#else
+    return { skip_whitespace_scalar, find_first_of_scalar, find_first_of4_scalar, "scalar" };
+#endif
+}
+
+const ScanImpl impl = select_impl();
+
+}
+
+const char* skip_whitespace(const char* ptr, const char* end) {
+    return impl.skip_whitespace(ptr, end);
+}
+
+const char* find_first_of(const char* ptr, const char* end, char a, char b) {
+    return impl.find_first_of(ptr, end, a, b);
+}
+
+const char* find_first_of(const char* ptr, const char* end, char a, char b, char c, char d) {
+    return impl.find_first_of4(ptr, end, a, b, c, d);
+}
+
+const char* charscan_impl_name() {
+    return impl.name;
+}
+
+}
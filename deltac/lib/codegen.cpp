@@ -0,0 +1,808 @@
+#include "codegen.hpp"
+#include "stack.hpp"
+#include "statistic.hpp"
+#include "timetrace.hpp"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
+#include <mutex>
+
+namespace deltac {
+
+DELTAC_STATISTIC(NumFunctionsEmitted, "codegen", "Number of function bodies lowered to LLVM IR");
+DELTAC_STATISTIC(NumGlobalsEmitted, "codegen", "Number of global variables lowered to LLVM IR");
+DELTAC_STATISTIC(NumDynamicGlobalInits, "codegen", "Number of globals initialized by the module constructor");
+
+CodeGen::CodeGen(const ASTContext& context, std::string_view module_name, OptLevel level) :
+    context(context),
+    llvm_context(std::make_unique<llvm::LLVMContext>()),
+    llvm_module(std::make_unique<llvm::Module>(llvm::StringRef(module_name.data(), module_name.size()), *llvm_context)),
+    builder(*llvm_context),
+    level(level) {}
+
+CodeGen::~CodeGen() = default;
+
+bool CodeGen::initialize_native_target() {
+    static std::once_flag once;
+    static bool initialized = false;
+
+    std::call_once(once, []() {
+        initialized = !llvm::InitializeNativeTarget() && !llvm::InitializeNativeTargetAsmPrinter();
+    });
+
+    return initialized;
+}
+
+llvm::CodeGenOpt::Level CodeGen::codegen_level(OptLevel level) {
+    switch (level) {
+    case OptLevel::O0:
+        return llvm::CodeGenOpt::None;
+    case OptLevel::O1:
+        return llvm::CodeGenOpt::Less;
+    case OptLevel::O2:
+        return llvm::CodeGenOpt::Default;
+    case OptLevel::O3:
+        return llvm::CodeGenOpt::Aggressive;
+    }
+
+    DELTA_UNREACHABLE("unknown optimization level");
+}
+
+/*
+ * Functions are declared first, so global initializers and bodies can refer to any of them,
+ * then the globals are created in declaration order, then the bodies are lowered.
+ */
+bool CodeGen::generate(std::string& error) {
+    TimeTraceScope scope("CodeGen", llvm_module->getModuleIdentifier());
+
+    const std::string triple = llvm::sys::getDefaultTargetTriple();
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+
+    if (!target) {
+        return false;
+    }
+
+    machine.reset(target->createTargetMachine(
+        triple, "generic", "", llvm::TargetOptions(), llvm::Reloc::PIC_, llvm::None, codegen_level(level)
+    ));
+
+    if (!machine) {
+        error = "cannot create a target machine for '" + triple + "'";
+        return false;
+    }
+
+    // the IR builder takes alignments from the data layout
+    llvm_module->setTargetTriple(triple);
+    llvm_module->setDataLayout(machine->createDataLayout());
+
+    // nothing that was parsed can call a function whose body is still pending
+    for (FuncDecl* fn : context.toplevel_funcdecls()) {
+        if (!fn->is_body_pending()) {
+            declare_function(fn);
+        }
+    }
+
+    for (VarDecl* var : context.toplevel_vardecls()) {
+        emit_global_var(var);
+    }
+
+    // the module constructor is only kept if some initializer did not fold
+    if (curr_function) {
+        if (curr_function->size() == 1 && curr_function->getEntryBlock().empty()) {
+            curr_function->eraseFromParent();
+        }
+        else {
+            builder.CreateRetVoid();
+            llvm::appendToGlobalCtors(*llvm_module, curr_function, 65535);
+        }
+
+        curr_function = nullptr;
+    }
+
+    for (FuncDecl* fn : context.toplevel_funcdecls()) {
+        if (fn->has_body()) {
+            emit_function_body(fn);
+        }
+    }
+
+    if (!unsupported_what.empty()) {
+        error = "cannot generate code for " + unsupported_what;
+        return false;
+    }
+
+    llvm::raw_string_ostream os(error);
+
+    if (llvm::verifyModule(*llvm_module, &os)) {
+        os.flush();
+        error = "generated invalid LLVM IR: " + error;
+        return false;
+    }
+
+    return true;
+}
+
+void CodeGen::optimize() {
+    TimeTraceScope scope("Optimize", llvm_module->getModuleIdentifier());
+
+    DELTA_ASSERT_MSG(machine, "generate must succeed before optimizing");
+
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+
+    // the target machine provides the cost models of the vectorizers and the inliner
+    llvm::PassBuilder pb(machine.get());
+
+    pb.registerModuleAnalyses(mam);
+    pb.registerCGSCCAnalyses(cgam);
+    pb.registerFunctionAnalyses(fam);
+    pb.registerLoopAnalyses(lam);
+    pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+    static const llvm::OptimizationLevel* const LEVELS[] = {
+        &llvm::OptimizationLevel::O0,
+        &llvm::OptimizationLevel::O1,
+        &llvm::OptimizationLevel::O2,
+        &llvm::OptimizationLevel::O3,
+    };
+
+    const llvm::OptimizationLevel& opt = *LEVELS[util::to_underlying(level)];
+
+    llvm::ModulePassManager mpm = level == OptLevel::O0
+        ? pb.buildO0DefaultPipeline(opt)
+        : pb.buildPerModuleDefaultPipeline(opt);
+
+    mpm.run(*llvm_module, mam);
+}
+
+bool CodeGen::emit_object_file(const std::string& path, std::string& error) {
+    TimeTraceScope scope("Emit object file", path);
+
+    DELTA_ASSERT_MSG(machine, "generate must succeed before emitting code");
+
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_None);
+
+    if (ec) {
+        error = "cannot open '" + path + "': " + ec.message();
+        return false;
+    }
+
+    // instruction selection still runs on the legacy pass manager
+    llvm::legacy::PassManager pm;
+
+    if (machine->addPassesToEmitFile(pm, os, nullptr, llvm::CGFT_ObjectFile)) {
+        error = "the target cannot emit object files";
+        return false;
+    }
+
+    pm.run(*llvm_module);
+    os.flush();
+
+    return true;
+}
+
+std::pair<std::unique_ptr<llvm::LLVMContext>, std::unique_ptr<llvm::Module>> CodeGen::release_module() {
+    DELTA_ASSERT_MSG(llvm_module, "the module was already released");
+
+    // the builder keeps a reference to the context, but does not use it again
+    builder.ClearInsertionPoint();
+
+    return { std::move(llvm_context), std::move(llvm_module) };
+}
+
+bool CodeGen::emit_llvm_ir(const std::string& path, std::string& error) {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_Text);
+
+    if (ec) {
+        error = "cannot open '" + path + "': " + ec.message();
+        return false;
+    }
+
+    llvm_module->print(os, nullptr);
+    return true;
+}
+
+llvm::Type* CodeGen::convert_type(const QualType& ty) {
+    Type* raw = ty.raw_type();
+
+    switch (raw->type_class()) {
+    case Type::Builtin:
+        switch (util::cast<BuiltinType>(raw)->get_kind()) {
+        case BuiltinType::Void:
+            return builder.getVoidTy();
+        case BuiltinType::Bool:
+            return builder.getInt1Ty();
+        case BuiltinType::F32:
+            return builder.getFloatTy();
+        case BuiltinType::F64:
+            return builder.getDoubleTy();
+        default:
+            return builder.getIntNTy((unsigned)ty.size() * 8);
+        }
+
+    case Type::Ptr: {
+        QualType pointee = util::cast<PtrType>(raw)->pointee();
+
+        // like void* in clang
+        if (pointee.is_void_ty()) {
+            return builder.getInt8PtrTy();
+        }
+
+        return convert_type(pointee)->getPointerTo();
+    }
+
+    case Type::Function:
+        return convert_function_type(util::cast<FunctionType>(raw));
+    }
+
+    DELTA_UNREACHABLE("unknown type class");
+}
+
+llvm::FunctionType* CodeGen::convert_function_type(const FunctionType* ty) {
+    llvm::SmallVector<llvm::Type*, 4> params;
+
+    for (const QualType& param : ty->param_types()) {
+        params.push_back(convert_type(param));
+    }
+
+    return llvm::FunctionType::get(convert_type(ty->return_type()), params, false);
+}
+
+void CodeGen::declare_function(FuncDecl* fn) {
+    auto* ty = convert_function_type(util::cast<FunctionType>(fn->decl_type().raw_type()));
+    auto* func = llvm::Function::Create(ty, llvm::Function::ExternalLinkage, fn->get_identifier(), *llvm_module);
+
+    for (auto [arg, param] : llvm::zip(func->args(), fn->parameters())) {
+        arg.setName(param.name->name());
+    }
+
+    decl_values[fn] = func;
+}
+
+void CodeGen::emit_global_var(VarDecl* var) {
+    ++NumGlobalsEmitted;
+
+    llvm::Type* ty = convert_type(var->decl_type());
+    auto* global = new llvm::GlobalVariable(
+        *llvm_module, ty, false, llvm::GlobalValue::ExternalLinkage, llvm::Constant::getNullValue(ty),
+        var->get_identifier()
+    );
+
+    decl_values[var] = global;
+
+    if (!var->has_body()) {
+        return;
+    }
+
+    // emitted into the module constructor, nothing is emitted if the value folds
+    if (!curr_function) {
+        curr_function = llvm::Function::Create(
+            llvm::FunctionType::get(builder.getVoidTy(), false), llvm::Function::InternalLinkage,
+            "__deltac_global_init", *llvm_module
+        );
+
+        builder.SetInsertPoint(llvm::BasicBlock::Create(*llvm_context, "entry", curr_function));
+    }
+
+    llvm::BasicBlock* block = builder.GetInsertBlock();
+    const usize num_insts = block->size();
+
+    llvm::Value* init = emit_rvalue(var->get_expr());
+
+    if (!init) {
+        return;
+    }
+
+    auto* constant = llvm::dyn_cast<llvm::Constant>(init);
+
+    if (constant && builder.GetInsertBlock() == block && block->size() == num_insts) {
+        global->setInitializer(constant);
+        global->setConstant(var->decl_type().is_const());
+        return;
+    }
+
+    ++NumDynamicGlobalInits;
+    builder.CreateStore(init, global);
+}
+
+void CodeGen::emit_function_body(FuncDecl* fn) {
+    TimeTraceScope scope("CodeGen function", fn->get_identifier());
+
+    ++NumFunctionsEmitted;
+
+    curr_function = llvm::cast<llvm::Function>(decl_values[fn]);
+
+    builder.SetInsertPoint(llvm::BasicBlock::Create(*llvm_context, "entry", curr_function));
+
+    // parameters are variables like any other, mem2reg removes the copies
+    for (auto [arg, var] : llvm::zip(curr_function->args(), fn->param_decls())) {
+        llvm::AllocaInst* slot = create_entry_alloca(arg.getType(), arg.getName());
+
+        builder.CreateStore(&arg, slot);
+        decl_values[var] = slot;
+    }
+
+    emit_stmt(fn->get_body());
+
+    // falling off the end of the body, Sema has rejected it unless the function returns void
+    if (is_reachable()) {
+        DELTA_ASSERT(curr_function->getReturnType()->isVoidTy());
+        builder.CreateRetVoid();
+    }
+
+    builder.ClearInsertionPoint();
+    curr_function = nullptr;
+}
+
+void CodeGen::emit_stmt(Stmt* stmt) {
+    if (stack::is_nearly_exhausted()) {
+        unsupported("statements nested this deeply");
+        return;
+    }
+
+    switch (stmt->stmt_kind()) {
+    case Stmt::CompoundStmtKind:
+        emit_compound_stmt(util::cast<CompoundStmt>(stmt));
+        break;
+
+    case Stmt::ExprStmtKind: {
+        Expr* expr = util::cast<ExprStmt>(stmt)->get_expr();
+
+        if (expr->is_lval()) {
+            emit_lvalue(expr);
+        }
+        else {
+            emit_rvalue(expr);
+        }
+        break;
+    }
+
+    case Stmt::DeclStmtKind:
+        if (auto* var = util::dyn_cast<VarDecl>(util::cast<DeclStmt>(stmt)->get_decl())) {
+            emit_local_var(var);
+        }
+        else {
+            unsupported("local declarations other than variables");
+        }
+        break;
+
+    case Stmt::ReturnStmtKind:
+        emit_return_stmt(util::cast<ReturnStmt>(stmt));
+        break;
+
+    case Stmt::IfStmtKind:
+        emit_if_stmt(util::cast<IfStmt>(stmt));
+        break;
+
+    default:
+        unsupported("this statement");
+        break;
+    }
+}
+
+void CodeGen::emit_compound_stmt(CompoundStmt* stmt) {
+    for (Stmt* s : stmt->body()) {
+        if (!is_reachable()) {
+            break;
+        }
+
+        emit_stmt(s);
+    }
+}
+
+void CodeGen::emit_if_stmt(IfStmt* stmt) {
+    llvm::Value* cond = emit_rvalue(stmt->get_cond());
+
+    if (!cond) {
+        return;
+    }
+
+    auto* then_block = llvm::BasicBlock::Create(*llvm_context, "if.then", curr_function);
+    auto* end_block = llvm::BasicBlock::Create(*llvm_context, "if.end");
+    auto* else_block = stmt->has_else() ? llvm::BasicBlock::Create(*llvm_context, "if.else") : end_block;
+
+    builder.CreateCondBr(cond, then_block, else_block);
+
+    builder.SetInsertPoint(then_block);
+    emit_stmt(stmt->get_then());
+
+    if (is_reachable()) {
+        builder.CreateBr(end_block);
+    }
+
+    if (stmt->has_else()) {
+        else_block->insertInto(curr_function);
+        builder.SetInsertPoint(else_block);
+        emit_stmt(stmt->get_else());
+
+        if (is_reachable()) {
+            builder.CreateBr(end_block);
+        }
+    }
+
+    // every branch returned
+    if (llvm::pred_empty(end_block)) {
+        delete end_block;
+        builder.ClearInsertionPoint();
+        return;
+    }
+
+    end_block->insertInto(curr_function);
+    builder.SetInsertPoint(end_block);
+}
+
+void CodeGen::emit_return_stmt(ReturnStmt* stmt) {
+    if (!stmt->has_expr()) {
+        builder.CreateRetVoid();
+        return;
+    }
+
+    if (llvm::Value* value = emit_rvalue(stmt->get_expr())) {
+        builder.CreateRet(value);
+    }
+}
+
+void CodeGen::emit_local_var(VarDecl* var) {
+    llvm::AllocaInst* slot = create_entry_alloca(convert_type(var->decl_type()), var->get_identifier());
+
+    decl_values[var] = slot;
+
+    if (var->has_body()) {
+        if (llvm::Value* init = emit_rvalue(var->get_expr())) {
+            builder.CreateStore(init, slot);
+        }
+    }
+}
+
+llvm::Value* CodeGen::emit_rvalue(Expr* expr) {
+    DELTA_ASSERT(expr->is_rval());
+
+    if (stack::is_nearly_exhausted()) {
+        unsupported("expressions nested this deeply");
+        return nullptr;
+    }
+
+    switch (expr->expr_kind()) {
+    case Expr::IntLiteralExprKind: {
+        auto* ty = llvm::cast<llvm::IntegerType>(convert_type(expr->type()));
+        const llvm::APSInt& value = util::cast<IntLiteralExpr>(expr)->get_value();
+
+        return llvm::ConstantInt::get(ty, value.extOrTrunc(ty->getBitWidth()));
+    }
+
+    case Expr::BinaryExprKind:
+        return emit_binary_expr(util::cast<BinaryExpr>(expr));
+
+    case Expr::UnaryExprKind:
+        return emit_unary_expr(util::cast<UnaryExpr>(expr));
+
+    case Expr::ImplicitCastExprKind:
+    case Expr::ExplicitCastExprKind:
+        return emit_cast_expr(util::cast<CastExpr>(expr));
+
+    case Expr::CallExprKind:
+        return emit_call_expr(util::cast<CallExpr>(expr));
+
+    case Expr::ParenExprKind:
+        return emit_rvalue(util::cast<ParenExpr>(expr)->sub_expr());
+
+    // only functions are named by rvalues
+    case Expr::IdExprKind:
+        return decl_values.lookup(util::cast<IdExpr>(expr)->get_decl());
+
+    default:
+        unsupported("this expression");
+        return nullptr;
+    }
+}
+
+llvm::Value* CodeGen::emit_lvalue(Expr* expr) {
+    DELTA_ASSERT(expr->is_lval());
+
+    if (stack::is_nearly_exhausted()) {
+        unsupported("expressions nested this deeply");
+        return nullptr;
+    }
+
+    switch (expr->expr_kind()) {
+    case Expr::IdExprKind:
+        return decl_values.lookup(util::cast<IdExpr>(expr)->get_decl());
+
+    case Expr::ParenExprKind:
+        return emit_lvalue(util::cast<ParenExpr>(expr)->sub_expr());
+
+    case Expr::UnaryExprKind: {
+        auto* unary = util::cast<UnaryExpr>(expr);
+
+        DELTA_ASSERT(unary->op_code() == UnaryOp::Deref);
+        return emit_rvalue(unary->expr());
+    }
+
+    case Expr::AssignExprKind:
+        return emit_assign_expr(util::cast<AssignExpr>(expr));
+
+    default:
+        unsupported("this lvalue");
+        return nullptr;
+    }
+}
+
+// the operation of a binary or compound assignment operator on two values of type ty
+static llvm::Value* emit_arithmetic(llvm::IRBuilder<>& builder, BinaryOp op, const QualType& ty,
+                                    llvm::Value* lhs, llvm::Value* rhs) {
+    const bool is_signed = ty.is_signed_ty();
+
+    switch (op) {
+    case BinaryOp::Plus:
+        return builder.CreateAdd(lhs, rhs, "add");
+    case BinaryOp::Minus:
+        return builder.CreateSub(lhs, rhs, "sub");
+    case BinaryOp::Multiply:
+        return builder.CreateMul(lhs, rhs, "mul");
+    case BinaryOp::Divide:
+        return is_signed ? builder.CreateSDiv(lhs, rhs, "div") : builder.CreateUDiv(lhs, rhs, "div");
+    case BinaryOp::Modulo:
+        return is_signed ? builder.CreateSRem(lhs, rhs, "rem") : builder.CreateURem(lhs, rhs, "rem");
+    case BinaryOp::LeftShift:
+        return builder.CreateShl(lhs, rhs, "shl");
+    case BinaryOp::RightShift:
+        return is_signed ? builder.CreateAShr(lhs, rhs, "shr") : builder.CreateLShr(lhs, rhs, "shr");
+    case BinaryOp::BitwiseAnd:
+        return builder.CreateAnd(lhs, rhs, "and");
+    case BinaryOp::BitwiseOr:
+        return builder.CreateOr(lhs, rhs, "or");
+    case BinaryOp::BitwiseXor:
+        return builder.CreateXor(lhs, rhs, "xor");
+    case BinaryOp::Equal:
+        return builder.CreateICmpEQ(lhs, rhs, "cmp");
+    case BinaryOp::NotEqual:
+        return builder.CreateICmpNE(lhs, rhs, "cmp");
+    case BinaryOp::Less:
+        return is_signed ? builder.CreateICmpSLT(lhs, rhs, "cmp") : builder.CreateICmpULT(lhs, rhs, "cmp");
+    case BinaryOp::Greater:
+        return is_signed ? builder.CreateICmpSGT(lhs, rhs, "cmp") : builder.CreateICmpUGT(lhs, rhs, "cmp");
+    case BinaryOp::LessEqual:
+        return is_signed ? builder.CreateICmpSLE(lhs, rhs, "cmp") : builder.CreateICmpULE(lhs, rhs, "cmp");
+    case BinaryOp::GreaterEqual:
+        return is_signed ? builder.CreateICmpSGE(lhs, rhs, "cmp") : builder.CreateICmpUGE(lhs, rhs, "cmp");
+    case BinaryOp::And:
+    case BinaryOp::Or:
+        break;
+    }
+
+    DELTA_UNREACHABLE("logical operators short circuit");
+}
+
+llvm::Value* CodeGen::emit_binary_expr(BinaryExpr* expr) {
+    // a chain like a + b + c is a tree as deep as it has operators, all leaning on the
+    // left operand; the left operands are followed in a loop and the operations emitted
+    // from the innermost one out, so only the right operands recurse
+    llvm::SmallVector<BinaryExpr*, 8> chain = { expr };
+
+    while (auto* lhs = util::dyn_cast<BinaryExpr>(chain.back()->lhs())) {
+        chain.push_back(lhs);
+    }
+
+    llvm::Value* value = emit_rvalue(chain.back()->lhs());
+
+    for (BinaryExpr* binary : llvm::reverse(chain)) {
+        if (!value) {
+            return nullptr;
+        }
+
+        value = emit_binary_operation(binary, value);
+    }
+
+    return value;
+}
+
+llvm::Value* CodeGen::emit_binary_operation(BinaryExpr* expr, llvm::Value* lhs) {
+    if (expr->op_code() == BinaryOp::And || expr->op_code() == BinaryOp::Or) {
+        return emit_logical_expr(expr, lhs);
+    }
+
+    llvm::Value* rhs = emit_rvalue(expr->rhs());
+
+    if (!rhs) {
+        return nullptr;
+    }
+
+    // Sema converted both operands to the same type
+    return emit_arithmetic(builder, expr->op_code(), expr->lhs()->type(), lhs, rhs);
+}
+
+llvm::Value* CodeGen::emit_logical_expr(BinaryExpr* expr, llvm::Value* lhs) {
+    const bool is_or = expr->op_code() == BinaryOp::Or;
+
+    llvm::BasicBlock* lhs_block = builder.GetInsertBlock();
+    auto* rhs_block = llvm::BasicBlock::Create(*llvm_context, is_or ? "lor.rhs" : "land.rhs", curr_function);
+    auto* end_block = llvm::BasicBlock::Create(*llvm_context, is_or ? "lor.end" : "land.end", curr_function);
+
+    // the result is known from lhs when it is true for || and false for &&
+    if (is_or) {
+        builder.CreateCondBr(lhs, end_block, rhs_block);
+    }
+    else {
+        builder.CreateCondBr(lhs, rhs_block, end_block);
+    }
+
+    builder.SetInsertPoint(rhs_block);
+
+    llvm::Value* rhs = emit_rvalue(expr->rhs());
+
+    if (!rhs) {
+        return nullptr;
+    }
+
+    // rhs may have added blocks
+    llvm::BasicBlock* rhs_end_block = builder.GetInsertBlock();
+    builder.CreateBr(end_block);
+
+    builder.SetInsertPoint(end_block);
+
+    llvm::PHINode* phi = builder.CreatePHI(builder.getInt1Ty(), 2, is_or ? "lor" : "land");
+    phi->addIncoming(builder.getInt1(is_or), lhs_block);
+    phi->addIncoming(rhs, rhs_end_block);
+
+    return phi;
+}
+
+llvm::Value* CodeGen::emit_unary_expr(UnaryExpr* expr) {
+    if (expr->op_code() == UnaryOp::AddressOf) {
+        return emit_lvalue(expr->expr());
+    }
+
+    llvm::Value* value = emit_rvalue(expr->expr());
+
+    if (!value) {
+        return nullptr;
+    }
+
+    switch (expr->op_code()) {
+    case UnaryOp::Plus:
+        return value;
+    case UnaryOp::Minus:
+        return builder.CreateNeg(value, "neg");
+    // the operand of ! is a bool
+    case UnaryOp::Not:
+    case UnaryOp::BitwiseNot:
+        return builder.CreateNot(value, "not");
+    case UnaryOp::Deref:
+    case UnaryOp::AddressOf:
+        break;
+    }
+
+    DELTA_UNREACHABLE("dereferences are lvalues");
+}
+
+llvm::Value* CodeGen::emit_cast_expr(CastExpr* expr) {
+    if (expr->cast_kind() == CastExpr::LValueToRValue) {
+        llvm::Value* address = emit_lvalue(expr->castee());
+
+        if (!address) {
+            return nullptr;
+        }
+
+        return builder.CreateLoad(convert_type(expr->type()), address);
+    }
+
+    llvm::Value* value = emit_rvalue(expr->castee());
+
+    if (!value) {
+        return nullptr;
+    }
+
+    switch (expr->cast_kind()) {
+    case CastExpr::NoOp:
+        return value;
+    // bool is unsigned, so it is zero extended
+    case CastExpr::IntCast:
+        return builder.CreateIntCast(value, convert_type(expr->type()), expr->castee()->type().is_signed_ty(), "conv");
+    case CastExpr::IntToBool:
+        return builder.CreateIsNotNull(value, "tobool");
+    case CastExpr::PtrToBool:
+        return builder.CreateIsNotNull(value, "tobool");
+    default:
+        unsupported("this conversion");
+        return nullptr;
+    }
+}
+
+llvm::Value* CodeGen::emit_call_expr(CallExpr* expr) {
+    llvm::Value* callee = emit_rvalue(expr->expr());
+
+    if (!callee) {
+        return nullptr;
+    }
+
+    llvm::SmallVector<llvm::Value*, 8> args;
+
+    for (Expr* arg : expr->arguments()) {
+        llvm::Value* value = emit_rvalue(arg);
+
+        if (!value) {
+            return nullptr;
+        }
+
+        args.push_back(value);
+    }
+
+    auto* fn_ty = convert_function_type(util::cast<FunctionType>(expr->expr()->type().raw_type()));
+    llvm::CallInst* call = builder.CreateCall(fn_ty, callee, args);
+
+    if (!fn_ty->getReturnType()->isVoidTy()) {
+        call->setName("call");
+    }
+
+    return call;
+}
+
+static BinaryOp to_binary_operator(AssignOp op) {
+    switch (op) {
+    case AssignOp::PlusEqual: return BinaryOp::Plus;
+    case AssignOp::MinusEqual: return BinaryOp::Minus;
+    case AssignOp::TimesEqual: return BinaryOp::Multiply;
+    case AssignOp::DevideEqual: return BinaryOp::Divide;
+    case AssignOp::ModEqual: return BinaryOp::Modulo;
+    case AssignOp::LeftShiftEqual: return BinaryOp::LeftShift;
+    case AssignOp::RightShiftEqual: return BinaryOp::RightShift;
+    case AssignOp::OrEqual: return BinaryOp::BitwiseOr;
+    case AssignOp::AndEqual: return BinaryOp::BitwiseAnd;
+    case AssignOp::XorEqual: return BinaryOp::BitwiseXor;
+    case AssignOp::Equal: break;
+    }
+
+    DELTA_UNREACHABLE("plain assignment has no binary operator");
+}
+
+llvm::Value* CodeGen::emit_assign_expr(AssignExpr* expr) {
+    llvm::Value* value = emit_rvalue(expr->rhs());
+    llvm::Value* address = emit_lvalue(expr->lhs());
+
+    if (!value || !address) {
+        return nullptr;
+    }
+
+    if (expr->op_code() != AssignOp::Equal) {
+        const QualType& ty = expr->lhs()->type();
+        llvm::Value* curr = builder.CreateLoad(convert_type(ty), address);
+
+        value = emit_arithmetic(builder, to_binary_operator(expr->op_code()), ty, curr, value);
+    }
+
+    builder.CreateStore(value, address);
+
+    // the assignment designates the object assigned to
+    return address;
+}
+
+llvm::AllocaInst* CodeGen::create_entry_alloca(llvm::Type* ty, llvm::StringRef name) {
+    llvm::BasicBlock& entry = curr_function->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+
+    return entry_builder.CreateAlloca(ty, nullptr, name);
+}
+
+void CodeGen::unsupported(std::string_view what) {
+    if (unsupported_what.empty()) {
+        unsupported_what = what;
+    }
+}
+
+}
@@ -0,0 +1,396 @@
+#include "constexpr_evaluator.hpp"
+#include "stack.hpp"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <limits>
+
+namespace deltac {
+
+// the low width bits of value, extended to 64 bits
+static u64 extend(u64 value, u32 width, bool is_signed) {
+    if (width >= 64) {
+        return value;
+    }
+
+    const u64 mask = (u64(1) << width) - 1;
+
+    if (is_signed) {
+        const u64 sign = u64(1) << (width - 1);
+        return ((value & mask) ^ sign) - sign;
+    }
+
+    return value & mask;
+}
+
+static u32 type_width(const QualType& ty) {
+    return ty.is_bool_ty() ? 1 : (u32)ty.size() * 8;
+}
+
+ConstInt::ConstInt(u64 bits, u32 width, bool is_signed) :
+    value(extend(bits, width, is_signed)), bitwidth(width), sign(is_signed) {
+    DELTA_ASSERT_MSG(width <= 64, "wide constants are built from an APSInt");
+}
+
+ConstInt::ConstInt(const llvm::APSInt& value) : bitwidth(value.getBitWidth()), sign(value.isSigned()) {
+    if (bitwidth <= 64) {
+        this->value = sign ? (u64)value.getSExtValue() : value.getZExtValue();
+    }
+    else {
+        wide = value;
+    }
+}
+
+ConstInt ConstInt::of_type(u64 bits, const QualType& ty) {
+    return ConstInt(bits, type_width(ty), ty.is_signed_ty());
+}
+
+llvm::APSInt ConstInt::to_apsint() const {
+    if (wide) {
+        return *wide;
+    }
+
+    return llvm::APSInt(llvm::APInt(bitwidth, value, sign), !sign);
+}
+
+ConstInt ConstInt::convert(u32 width, bool is_signed) const {
+    if (!is_wide() && width <= 64) {
+        return ConstInt(value, width, is_signed);
+    }
+
+    // extends by the signedness of the source like an IntCast
+    llvm::APSInt ret = to_apsint().extOrTrunc(width);
+    ret.setIsSigned(is_signed);
+
+    return ConstInt(ret);
+}
+
+std::optional<ConstInt> ConstExprEvaluator::literal_value(const Expr* expr) {
+    while (auto* paren = util::dyn_cast<ParenExpr>(expr)) {
+        expr = paren->sub_expr();
+    }
+
+    auto* literal = util::dyn_cast<IntLiteralExpr>(expr);
+
+    if (!literal) {
+        return std::nullopt;
+    }
+
+    const QualType& ty = literal->type();
+    return ConstInt(literal->get_value()).convert(type_width(ty), ty.is_signed_ty());
+}
+
+std::optional<ConstInt> ConstExprEvaluator::evaluate(const Expr* expr) {
+    if (stack::is_nearly_exhausted()) {
+        return std::nullopt;
+    }
+
+    switch (expr->expr_kind()) {
+    case Expr::IntLiteralExprKind:
+        return literal_value(expr);
+
+    case Expr::ParenExprKind:
+        return evaluate(util::cast<ParenExpr>(expr)->sub_expr());
+
+    case Expr::BinaryExprKind: {
+        // a chain like a + b + c leans on its left operands, which are followed in a loop
+        llvm::SmallVector<const BinaryExpr*, 8> chain = { util::cast<BinaryExpr>(expr) };
+
+        while (auto* lhs = util::dyn_cast<BinaryExpr>(chain.back()->lhs())) {
+            chain.push_back(lhs);
+        }
+
+        auto value = evaluate(chain.back()->lhs());
+
+        for (const BinaryExpr* binary : llvm::reverse(chain)) {
+            if (!value) {
+                return std::nullopt;
+            }
+
+            auto rhs = evaluate(binary->rhs());
+
+            if (!rhs) {
+                return std::nullopt;
+            }
+
+            value = fold_binary(binary->op_code(), *value, *rhs, binary->type());
+        }
+
+        return value;
+    }
+
+    case Expr::UnaryExprKind: {
+        auto* unary = util::cast<UnaryExpr>(expr);
+        auto operand = evaluate(unary->expr());
+
+        return operand ? fold_unary(unary->op_code(), *operand, expr->type()) : std::nullopt;
+    }
+
+    case Expr::ImplicitCastExprKind:
+    case Expr::ExplicitCastExprKind: {
+        auto* cast = util::cast<CastExpr>(expr);
+        auto operand = evaluate(cast->castee());
+
+        return operand ? fold_cast(cast->cast_kind(), *operand, expr->type()) : std::nullopt;
+    }
+
+    default:
+        return std::nullopt;
+    }
+}
+
+std::optional<ConstInt> ConstExprEvaluator::fold_binary(BinaryOp op, const ConstInt& lhs, const ConstInt& rhs,
+                                                        const QualType& ty) {
+    const u32 width = type_width(ty);
+
+    if (lhs.is_wide() || rhs.is_wide() || width > 64) {
+        return fold_wide_binary(op, lhs, rhs, ty);
+    }
+
+    // the operands have the same type after Sema, comparisons have a bool type
+    const bool is_signed = lhs.is_signed();
+    const u64 a = lhs.bits();
+    const u64 b = rhs.bits();
+
+    // the result wrapped around at the width, which overflows if it changed a signed value
+    auto wrap = [&](u64 exact, bool overflow) {
+        ConstInt ret(exact, width, is_signed);
+
+        overflowed |= is_signed && (overflow || ret.bits() != exact);
+        return ret;
+    };
+
+    i64 result = 0;
+
+    // the quotient of the minimum value and -1 does not fit, the division traps at run time
+    const bool division_overflows = is_signed && (i64)b == -1 && a == ~u64(0) << (width - 1);
+
+    switch (op) {
+    case BinaryOp::Plus:
+        if (is_signed) {
+            return wrap((u64)result, __builtin_add_overflow((i64)a, (i64)b, &result));
+        }
+        return ConstInt(a + b, width, false);
+
+    case BinaryOp::Minus:
+        if (is_signed) {
+            return wrap((u64)result, __builtin_sub_overflow((i64)a, (i64)b, &result));
+        }
+        return ConstInt(a - b, width, false);
+
+    case BinaryOp::Multiply:
+        if (is_signed) {
+            return wrap((u64)result, __builtin_mul_overflow((i64)a, (i64)b, &result));
+        }
+        return ConstInt(a * b, width, false);
+
+    case BinaryOp::Divide:
+        if (b == 0 || division_overflows) {
+            return std::nullopt;
+        }
+
+        if (is_signed) {
+            return ConstInt((u64)((i64)a / (i64)b), width, true);
+        }
+        return ConstInt(a / b, width, false);
+
+    case BinaryOp::Modulo:
+        if (b == 0 || division_overflows) {
+            return std::nullopt;
+        }
+
+        if (is_signed) {
+            return ConstInt((u64)((i64)a % (i64)b), width, true);
+        }
+        return ConstInt(a % b, width, false);
+
+    case BinaryOp::LeftShift: {
+        if (b >= width) {
+            return std::nullopt;
+        }
+
+        ConstInt ret(a << b, width, is_signed);
+
+        // bits shifted out, or into the sign
+        if (is_signed && (ret.sext() >> b) != (i64)a) {
+            overflowed = true;
+        }
+
+        return ret;
+    }
+
+    case BinaryOp::RightShift:
+        if (b >= width) {
+            return std::nullopt;
+        }
+
+        return ConstInt(is_signed ? (u64)((i64)a >> b) : a >> b, width, is_signed);
+
+    case BinaryOp::BitwiseAnd:
+        return ConstInt(a & b, width, is_signed);
+    case BinaryOp::BitwiseOr:
+        return ConstInt(a | b, width, is_signed);
+    case BinaryOp::BitwiseXor:
+        return ConstInt(a ^ b, width, is_signed);
+
+    case BinaryOp::Equal:
+        return ConstInt(a == b, 1, false);
+    case BinaryOp::NotEqual:
+        return ConstInt(a != b, 1, false);
+    case BinaryOp::Less:
+        return ConstInt(is_signed ? (i64)a < (i64)b : a < b, 1, false);
+    case BinaryOp::Greater:
+        return ConstInt(is_signed ? (i64)a > (i64)b : a > b, 1, false);
+    case BinaryOp::LessEqual:
+        return ConstInt(is_signed ? (i64)a <= (i64)b : a <= b, 1, false);
+    case BinaryOp::GreaterEqual:
+        return ConstInt(is_signed ? (i64)a >= (i64)b : a >= b, 1, false);
+
+    case BinaryOp::And:
+        return ConstInt(a != 0 && b != 0, 1, false);
+    case BinaryOp::Or:
+        return ConstInt(a != 0 || b != 0, 1, false);
+    }
+
+    DELTA_UNREACHABLE("unknown binary operator");
+}
+
+std::optional<ConstInt> ConstExprEvaluator::fold_wide_binary(BinaryOp op, const ConstInt& lhs, const ConstInt& rhs,
+                                                             const QualType& ty) {
+    const u32 width = std::max(lhs.width(), rhs.width());
+    const bool is_signed = lhs.is_signed();
+
+    llvm::APSInt a = lhs.to_apsint().extOrTrunc(width);
+    llvm::APSInt b = rhs.to_apsint().extOrTrunc(width);
+    bool overflow = false;
+
+    auto arithmetic = [&](const llvm::APInt& value) {
+        overflowed |= is_signed && overflow;
+        return ConstInt(llvm::APSInt(value, !is_signed)).convert(type_width(ty), ty.is_signed_ty());
+    };
+
+    auto boolean = [](bool value) { return ConstInt(value, 1, false); };
+
+    switch (op) {
+    case BinaryOp::Plus:
+        return arithmetic(is_signed ? a.sadd_ov(b, overflow) : a.uadd_ov(b, overflow));
+    case BinaryOp::Minus:
+        return arithmetic(is_signed ? a.ssub_ov(b, overflow) : a.usub_ov(b, overflow));
+    case BinaryOp::Multiply:
+        return arithmetic(is_signed ? a.smul_ov(b, overflow) : a.umul_ov(b, overflow));
+    case BinaryOp::Divide:
+    case BinaryOp::Modulo:
+        if (b.isZero() || (is_signed && a.isMinSignedValue() && b.isAllOnes())) {
+            return std::nullopt;
+        }
+
+        if (op == BinaryOp::Divide) {
+            return arithmetic(is_signed ? a.sdiv(b) : a.udiv(b));
+        }
+        return arithmetic(is_signed ? a.srem(b) : a.urem(b));
+    case BinaryOp::LeftShift:
+        if (b.uge(width)) {
+            return std::nullopt;
+        }
+        return arithmetic(is_signed ? a.sshl_ov(b, overflow) : a.shl(b));
+    case BinaryOp::RightShift:
+        if (b.uge(width)) {
+            return std::nullopt;
+        }
+        return arithmetic(is_signed ? a.ashr(b) : a.lshr(b));
+    case BinaryOp::BitwiseAnd:
+        return arithmetic(a & b);
+    case BinaryOp::BitwiseOr:
+        return arithmetic(a | b);
+    case BinaryOp::BitwiseXor:
+        return arithmetic(a ^ b);
+    case BinaryOp::Equal:
+        return boolean(a == b);
+    case BinaryOp::NotEqual:
+        return boolean(a != b);
+    case BinaryOp::Less:
+        return boolean(a < b);
+    case BinaryOp::Greater:
+        return boolean(a > b);
+    case BinaryOp::LessEqual:
+        return boolean(a <= b);
+    case BinaryOp::GreaterEqual:
+        return boolean(a >= b);
+    case BinaryOp::And:
+        return boolean(!a.isZero() && !b.isZero());
+    case BinaryOp::Or:
+        return boolean(!a.isZero() || !b.isZero());
+    }
+
+    DELTA_UNREACHABLE("unknown binary operator");
+}
+
+std::optional<ConstInt> ConstExprEvaluator::fold_unary(UnaryOp op, const ConstInt& operand, const QualType& ty) {
+    const u32 width = type_width(ty);
+    const bool is_signed = ty.is_signed_ty();
+
+    if (operand.is_wide() || width > 64) {
+        llvm::APSInt value = operand.to_apsint();
+
+        switch (op) {
+        case UnaryOp::Plus:
+            return operand;
+        case UnaryOp::Minus:
+            overflowed |= is_signed && value.isMinSignedValue();
+            return ConstInt(llvm::APSInt(-value, !is_signed));
+        case UnaryOp::BitwiseNot:
+            return ConstInt(llvm::APSInt(~value, !is_signed));
+        default:
+            return std::nullopt;
+        }
+    }
+
+    switch (op) {
+    case UnaryOp::Plus:
+        return operand;
+
+    case UnaryOp::Minus: {
+        if (!is_signed) {
+            return ConstInt(0 - operand.bits(), width, false);
+        }
+
+        i64 result = 0;
+        const bool overflow = __builtin_sub_overflow((i64)0, operand.sext(), &result);
+        ConstInt ret((u64)result, width, true);
+
+        overflowed |= overflow || ret.sext() != result;
+        return ret;
+    }
+
+    case UnaryOp::BitwiseNot:
+        return ConstInt(~operand.bits(), width, is_signed);
+
+    // the operand of ! is a bool
+    case UnaryOp::Not:
+        return ConstInt(operand.bits() ^ 1, 1, false);
+
+    case UnaryOp::Deref:
+    case UnaryOp::AddressOf:
+        return std::nullopt;
+    }
+
+    DELTA_UNREACHABLE("unknown unary operator");
+}
+
+std::optional<ConstInt> ConstExprEvaluator::fold_cast(CastExpr::CastKind kind, const ConstInt& operand,
+                                                      const QualType& ty) {
+    switch (kind) {
+    case CastExpr::NoOp:
+    case CastExpr::IntCast:
+        return operand.convert(type_width(ty), ty.is_signed_ty());
+
+    case CastExpr::IntToBool:
+        return ConstInt(!operand.is_zero(), 1, false);
+
+    default:
+        return std::nullopt;
+    }
+}
+
+}
@@ -0,0 +1,107 @@
+#include "diagnostics.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace deltac {
+
+static constexpr diag::Level diag_level[] = {
+#define DIAG(ID, LEVEL, TEXT) diag::LEVEL,
+#include "diagnostic_kinds.inc"
+};
+
+static constexpr std::string_view diag_text[] = {
+#define DIAG(ID, LEVEL, TEXT) TEXT,
+#include "diagnostic_kinds.inc"
+};
+
+diag::Level diag::level(Kind kind) {
+    return diag_level[kind];
+}
+
+void DiagnosticsEngine::report(SourceLocation loc, diag::Kind kind, std::initializer_list<std::string_view> args) {
+    std::string_view text = diag_text[kind];
+    std::string message;
+
+    message.reserve(text.size());
+
+    for (usize i = 0; i < text.size(); i++) {
+        usize arg = i + 1 < text.size() ? (usize)(text[i + 1] - '0') : args.size();
+
+        if (text[i] == '%' && arg < args.size()) {
+            message += args.begin()[arg];
+            i++;
+        }
+        else {
+            message += text[i];
+        }
+    }
+
+    if (diag::level(kind) == diag::Error) {
+        num_errors++;
+    }
+
+    diags.push_back({ loc, kind, std::move(message) });
+}
+
+void DiagnosticsEngine::take(DiagnosticsEngine& other, usize first) {
+    DELTA_ASSERT(first <= other.diags.size());
+
+    for (usize i = first; i < other.diags.size(); i++) {
+        if (other.diags[i].level() == diag::Error) {
+            num_errors++;
+            other.num_errors--;
+        }
+
+        diags.push_back(std::move(other.diags[i]));
+    }
+
+    other.diags.resize(first);
+}
+
+void DiagnosticsEngine::insert(usize position, DiagnosticsEngine& other) {
+    DELTA_ASSERT(position <= diags.size());
+
+    diags.insert(diags.begin() + position, std::make_move_iterator(other.diags.begin()),
+        std::make_move_iterator(other.diags.end()));
+
+    num_errors += other.num_errors;
+    other.clear();
+}
+
+void DiagnosticsEngine::drop_after_first_error() {
+    auto first_error = std::find_if(diags.begin(), diags.end(), [](const Diagnostic& d) {
+        return d.level() == diag::Error;
+    });
+
+    if (first_error != diags.end()) {
+        diags.erase(first_error + 1, diags.end());
+        num_errors = 1;
+    }
+}
+
+void DiagnosticsEngine::truncate(usize count) {
+    if (count >= diags.size()) {
+        return;
+    }
+
+    diags.erase(diags.begin() + count, diags.end());
+    num_errors = (usize)std::count_if(diags.begin(), diags.end(), [](const Diagnostic& d) {
+        return d.level() == diag::Error;
+    });
+}
+
+void DiagnosticsEngine::clear() {
+    diags.clear();
+    num_errors = 0;
+}
+
+std::string DiagnosticsEngine::format(const Diagnostic& d, const SourceManager& sources, std::string_view file) {
+    std::string ret = d.location.is_valid() ? sources.format_location(d.location) : std::string(file);
+
+    ret += d.level() == diag::Error ? ": error: " : ": warning: ";
+    ret += d.message;
+    return ret;
+}
+
+}
@@ -0,0 +1,507 @@
+#include "driver.hpp"
+#include "bytecode.hpp"
+#include "codegen.hpp"
+#include "diagnostics.hpp"
+#include "filebuffer.hpp"
+#include "interpreter.hpp"
+#include "jit.hpp"
+#include "parser.hpp"
+#include "sourcemanager.hpp"
+#include "statistic.hpp"
+#include "timetrace.hpp"
+#include "tokenbuffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace deltac {
+
+// a file with many broken tokens is not worth reporting in full
+static constexpr usize MAX_LEX_ERRORS = 20;
+
+Driver::Driver(DriverOptions options) : options(std::move(options)) {}
+
+void Driver::print_help(std::ostream& os) {
+    os << "usage: deltac [options] <file.dl>...\n"
+          "       deltac [options] --run <file.dl> [program arguments]...\n"
+          "       deltac [options] --interpret <file.dl> [program arguments]...\n"
+          "\n"
+          "options:\n"
+          "  -c                              write an object file for each input (default)\n"
+          "  -emit-llvm                      write textual LLVM IR for each input\n"
+          "  -emit-bytecode                  write the interpreter bytecode of each input\n"
+          "  -fsyntax-only                   only check the inputs\n"
+          "  --run                           compile the input just in time and run its main\n"
+          "  --interpret                     run the main of the input with the bytecode interpreter\n"
+          "  -o <file>                       write the output to file, for a single input\n"
+          "  -O0, -O1, -O2, -O3              optimization level (default: -O0)\n"
+          "  -j <n>, -j<n>                   compile n files at the same time (default: one per hardware thread)\n"
+          "  -ftime-trace[=<file>]           write a Chrome trace of the compiler phases (default: deltac.trace.json)\n"
+          "  -ftime-trace-granularity=<us>   leave out trace events shorter than this (default: 500)\n"
+          "  -stats                          print compiler statistics to stderr\n"
+          "  -stats-json=<file>              write compiler statistics as JSON\n"
+          "  -h, --help                      print this message\n";
+}
+
+static bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+static std::optional<unsigned> parse_unsigned(std::string_view text) {
+    if (text.empty() || text.size() > 9) {
+        return std::nullopt;
+    }
+
+    unsigned ret = 0;
+
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return std::nullopt;
+        }
+
+        ret = ret * 10 + (unsigned)(c - '0');
+    }
+
+    return ret;
+}
+
+std::optional<DriverOptions> Driver::parse_args(int argc, const char* const* argv, std::ostream& err) {
+    DriverOptions ret;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        // everything after the program belongs to it
+        if (runs_main(ret.output_kind) && !ret.inputs.empty()) {
+            ret.program_args.emplace_back(arg);
+            continue;
+        }
+
+        if (arg == "-h" || arg == "--help") {
+            print_help(err);
+            return std::nullopt;
+        }
+        else if (arg == "-c") {
+            ret.output_kind = OutputKind::Object;
+        }
+        else if (arg == "-emit-llvm") {
+            ret.output_kind = OutputKind::LLVMIR;
+        }
+        else if (arg == "-fsyntax-only") {
+            ret.output_kind = OutputKind::None;
+        }
+        else if (arg == "-emit-bytecode") {
+            ret.output_kind = OutputKind::Bytecode;
+        }
+        else if (arg == "--run") {
+            ret.output_kind = OutputKind::Run;
+        }
+        else if (arg == "--interpret") {
+            ret.output_kind = OutputKind::Interpret;
+        }
+        else if (starts_with(arg, "-o")) {
+            std::string_view value = arg.substr(2);
+
+            if (value.empty() && i + 1 < argc) {
+                value = argv[++i];
+            }
+
+            if (value.empty()) {
+                err << "error: missing file name after '-o'\n";
+                return std::nullopt;
+            }
+
+            ret.output_path = value;
+        }
+        else if (starts_with(arg, "-O")) {
+            auto level = parse_unsigned(arg.substr(2));
+
+            if (!level || *level > 3) {
+                err << "error: invalid optimization level '" << arg << "'\n";
+                return std::nullopt;
+            }
+
+            ret.opt_level = *level;
+        }
+        else if (starts_with(arg, "-j")) {
+            std::string_view value = arg.substr(2);
+
+            if (value.empty() && i + 1 < argc) {
+                value = argv[++i];
+            }
+
+            auto jobs = parse_unsigned(value);
+
+            if (!jobs || *jobs == 0) {
+                err << "error: invalid job count '" << value << "'\n";
+                return std::nullopt;
+            }
+
+            ret.jobs = *jobs;
+        }
+        else if (arg == "-ftime-trace") {
+            ret.time_trace_path = "deltac.trace.json";
+        }
+        else if (starts_with(arg, "-ftime-trace=")) {
+            ret.time_trace_path = arg.substr(std::string_view("-ftime-trace=").size());
+        }
+        else if (starts_with(arg, "-ftime-trace-granularity=")) {
+            auto granularity = parse_unsigned(arg.substr(std::string_view("-ftime-trace-granularity=").size()));
+
+            if (!granularity) {
+                err << "error: invalid value in '" << arg << "'\n";
+                return std::nullopt;
+            }
+
+            ret.time_trace_granularity = *granularity;
+        }
+        else if (arg == "-stats") {
+            ret.print_stats = true;
+        }
+        else if (starts_with(arg, "-stats-json=")) {
+            ret.stats_json_path = arg.substr(std::string_view("-stats-json=").size());
+        }
+        else if (starts_with(arg, "-")) {
+            err << "error: unknown argument '" << arg << "'\n";
+            return std::nullopt;
+        }
+        else {
+            ret.inputs.emplace_back(arg);
+        }
+    }
+
+    if (ret.inputs.empty()) {
+        err << "error: no input files\n";
+        return std::nullopt;
+    }
+
+    if (runs_main(ret.output_kind)) {
+        // main sees the file name as argv[0], like a script interpreter
+        ret.program_args.insert(ret.program_args.begin(), ret.inputs.front());
+    }
+
+    if (!ret.output_path.empty() && ret.inputs.size() > 1) {
+        err << "error: cannot specify -o with multiple input files\n";
+        return std::nullopt;
+    }
+
+    // the inputs are compiled at the same time, two of them must not write the same file
+    if (ret.output_path.empty() && ret.output_kind != OutputKind::None && !runs_main(ret.output_kind)) {
+        std::map<std::string, const std::string*> outputs;
+
+        for (const std::string& input : ret.inputs) {
+            auto [it, inserted] = outputs.emplace(default_output_path(input, ret.output_kind), &input);
+
+            if (!inserted) {
+                err << "error: '" << *it->second << "' and '" << input << "' would both be written to '" << it->first << "'\n";
+                return std::nullopt;
+            }
+        }
+    }
+
+    return ret;
+}
+
+unsigned Driver::job_count() const {
+    if (options.jobs != 0) {
+        return options.jobs;
+    }
+
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::string Driver::default_output_path(const std::string& input, OutputKind kind) {
+    std::filesystem::path output = std::filesystem::path(input).filename();
+
+    switch (kind) {
+    case OutputKind::LLVMIR:
+        output.replace_extension(".ll");
+        break;
+    case OutputKind::Bytecode:
+        output.replace_extension(".dlbc");
+        break;
+    default:
+        output.replace_extension(".o");
+        break;
+    }
+
+    return output.string();
+}
+
+CompileResult Driver::compile_file(const std::string& path, const DriverOptions& options, unsigned threads) {
+    TimeTraceScope scope("Compile file", path);
+
+    CompileResult result;
+
+    // errors that do not come from the source
+    auto error = [&](std::string_view message) {
+        result.success = false;
+        result.diagnostics += path;
+        result.diagnostics += ": error: ";
+        result.diagnostics += message;
+        result.diagnostics += '\n';
+    };
+
+    auto report = [&](const DiagnosticsEngine& diags, const SourceManager& sources) {
+        for (const DiagnosticsEngine::Diagnostic& d : diags.diagnostics()) {
+            result.diagnostics += DiagnosticsEngine::format(d, sources, path);
+            result.diagnostics += '\n';
+        }
+
+        if (diags.has_errors()) {
+            result.success = false;
+        }
+    };
+
+    // SourceBuffer exits on a missing file
+    if (!std::ifstream(path).is_open()) {
+        error("cannot open file");
+        return result;
+    }
+
+    SourceBuffer buffer(path);
+    SourceManager sources;
+
+    SourceManager::FileID fid = sources.add_buffer(buffer.ptr_cbegin(), buffer.size(), path);
+
+    if (fid == SourceManager::INVALID_FILE) {
+        error("file too large");
+        return result;
+    }
+
+    ASTContext context;
+    Sema sema(context);
+
+    TokenBuffer tokens;
+    Lexer lexer(buffer, sources.start_location(fid));
+    lexer.set_identifier_table(&context.identifier_table());
+    lexer.set_diagnostics(&sema.diagnostics());
+
+    if (!lexer.lex_all(tokens, threads)) {
+        sema.diagnostics().truncate(MAX_LEX_ERRORS);
+        report(sema.diagnostics(), sources);
+        return result;
+    }
+
+    Parser parser(tokens, sema);
+    Decl* decl = nullptr;
+
+    parser.set_lazy_bodies(true);
+
+    while (parser.parse_top_level_decl(decl)) {}
+
+    // running main only needs the functions it can reach, everything else checks and
+    // emits every function
+    const bool declarations_parsed = parser.is_eof();
+    bool bodies_parsed = false;
+
+    if (declarations_parsed && runs_main(options.output_kind)) {
+        llvm::SmallVector<FuncDecl*, 1> roots;
+
+        if (auto res = context.lookup_decl_with_id("main"); res.is_function()) {
+            roots.push_back(util::cast<FuncDecl>(res.result_decl()));
+        }
+
+        bodies_parsed = parser.parse_referenced_bodies(roots);
+    }
+    else {
+        // the first error in the file may be in a body skipped before a declaration error
+        bodies_parsed = parser.parse_pending_bodies(threads) && declarations_parsed;
+    }
+
+    // parsing stops at the first error, warnings before it are reported as well
+    report(sema.diagnostics(), sources);
+
+    if (!bodies_parsed) {
+        result.success = false;
+        return result;
+    }
+
+    if (options.output_kind == OutputKind::None) {
+        return result;
+    }
+
+    const std::string output = options.output_path.empty()
+        ? default_output_path(path, options.output_kind)
+        : options.output_path;
+
+    std::string message;
+
+    // the interpreter starts without LLVM
+    if (!uses_llvm(options.output_kind)) {
+        bc::Module module;
+
+        if (!BytecodeGen(context).generate(module, message)) {
+            error(message);
+            return result;
+        }
+
+        if (options.output_kind == OutputKind::Bytecode) {
+            std::ofstream ofs(output);
+
+            if (!ofs.is_open()) {
+                error("cannot open '" + output + "'");
+            }
+            else {
+                module.dump(ofs);
+            }
+
+            return result;
+        }
+
+        std::optional<int> exit_code = Interpreter(module).run_main(options.program_args, message);
+
+        if (!exit_code) {
+            error(message);
+        }
+        else {
+            result.exit_code = *exit_code;
+        }
+
+        return result;
+    }
+
+    CodeGen codegen(context, path, (CodeGen::OptLevel)options.opt_level);
+
+    if (!codegen.generate(message)) {
+        error(message);
+        return result;
+    }
+
+    codegen.optimize();
+
+    if (options.output_kind == OutputKind::Run) {
+        std::optional<int> exit_code = jit::run_main(codegen, options.program_args, message);
+
+        if (!exit_code) {
+            error(message);
+        }
+        else {
+            result.exit_code = *exit_code;
+        }
+
+        return result;
+    }
+
+    bool written = options.output_kind == OutputKind::Object
+        ? codegen.emit_object_file(output, message)
+        : codegen.emit_llvm_ir(output, message);
+
+    if (!written) {
+        error(message);
+    }
+
+    return result;
+}
+
+int Driver::run(std::ostream& diag) {
+    const bool time_trace = !options.time_trace_path.empty();
+
+    if (time_trace) {
+        timetrace::initialize(options.time_trace_granularity);
+    }
+
+    if (options.print_stats || !options.stats_json_path.empty()) {
+        stats::enable();
+    }
+
+    if (uses_llvm(options.output_kind) && !CodeGen::initialize_native_target()) {
+        diag << "error: cannot initialize the native target" << std::endl;
+        return 1;
+    }
+
+    const usize count = options.inputs.size();
+    const unsigned jobs = (unsigned)std::min<usize>(job_count(), count);
+    // a single file gets all the threads for lexing and parsing instead
+    const unsigned file_threads = count == 1 ? job_count() : 1;
+
+    std::vector<std::optional<CompileResult>> results(count);
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::atomic<usize> next_input = 0;
+
+    auto worker = [&]() {
+        for (usize idx; (idx = next_input.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            CompileResult result = compile_file(options.inputs[idx], options, file_threads);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                results[idx] = std::move(result);
+            }
+
+            finished.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(jobs);
+
+    for (unsigned i = 0; i < jobs; i++) {
+        workers.emplace_back(worker);
+    }
+
+    bool failed = false;
+    int exit_code = 0;
+
+    // prints in input order while later files are still being compiled
+    for (usize idx = 0; idx < count; idx++) {
+        CompileResult result;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]() { return results[idx].has_value(); });
+            result = std::move(*results[idx]);
+            results[idx].reset();
+        }
+
+        diag << result.diagnostics;
+        failed |= !result.success;
+        exit_code = result.exit_code;
+    }
+
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    diag << std::flush;
+
+    if (time_trace) {
+        if (!timetrace::write(options.time_trace_path)) {
+            diag << "error: cannot write time trace to '" << options.time_trace_path << "'\n";
+            failed = true;
+        }
+
+        timetrace::cleanup();
+    }
+
+    if (options.print_stats) {
+        stats::print(diag);
+    }
+
+    if (!options.stats_json_path.empty()) {
+        std::ofstream ofs(options.stats_json_path);
+
+        if (!ofs.is_open()) {
+            diag << "error: cannot write statistics to '" << options.stats_json_path << "'\n";
+            failed = true;
+        }
+        else {
+            stats::print_json(ofs);
+        }
+    }
+
+    if (failed) {
+        return 1;
+    }
+
+    // the exit code of the program with --run or --interpret
+    return exit_code;
+}
+
+}
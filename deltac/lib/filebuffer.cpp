@@ -1,20 +1,116 @@
 #include "filebuffer.hpp"
+#include "timetrace.hpp"
+
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DELTA_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace deltac {
 
 SourceBuffer::SourceBuffer(std::string_view path_name) : file_path(path_name) {
-    std::ifstream ifs(file_path);
+    TimeTraceScope scope("Load file", path_name);
+
+    if (map_file()) {
+        return;
+    }
+
+    std::ifstream ifs(file_path, std::ios::binary);
 
     if (!ifs.is_open()) {
         std::cerr << "cannot openfile";
         std::exit(2);
     }
 
-    buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    read_stream(ifs);
 }
 
 SourceBuffer::SourceBuffer(std::istream& input) {
+    TimeTraceScope scope("Load file", "<stream>");
+
+    read_stream(input);
+}
+
+SourceBuffer::~SourceBuffer() {
+#ifdef DELTA_HAS_MMAP
+    if (mapping) {
+        ::munmap(mapping, mapping_size);
+    }
+#endif
+}
+
+void SourceBuffer::read_stream(std::istream& input) {
     buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    length = buffer.size();
+
+    // std::string keeps one more null character after the padding
+    buffer.resize(length + PADDING, '\0');
+    start = buffer.data();
+}
+
+/*
+ * Maps the file read-only and makes sure that at least PADDING zero bytes follow it.
+ * An anonymous zero-filled region large enough for the file and its padding is
+ * reserved first, then the file is mapped over the beginning of that region.
+ * The kernel zero-fills the remainder of the last file page, and the anonymous
+ * pages after it are zero as well.
+ * Returns false if the file cannot be mapped, leaving the stream path to handle it.
+ */
+bool SourceBuffer::map_file() {
+#ifdef DELTA_HAS_MMAP
+    int fd = ::open(file_path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    const usize file_size = (usize)st.st_size;
+    const usize page_size = (usize)::sysconf(_SC_PAGESIZE);
+    const usize total = (file_size + PADDING + page_size - 1) / page_size * page_size;
+
+    void* region = ::mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (region == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    if (file_size != 0) {
+        void* file = ::mmap(region, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+
+        if (file == MAP_FAILED) {
+            ::munmap(region, total);
+            ::close(fd);
+            return false;
+        }
+
+        ::madvise(region, file_size, MADV_SEQUENTIAL);
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    mapping = region;
+    mapping_size = total;
+    start = static_cast<const char*>(region);
+    length = file_size;
+
+    return true;
+#else
+    return false;
+#endif
 }
 
 }
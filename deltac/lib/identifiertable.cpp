@@ -0,0 +1,101 @@
+#include "identifiertable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace deltac {
+
+static constexpr usize INITIAL_CAPACITY = 1024;
+
+IdentifierTable::IdentifierTable() : slots(INITIAL_CAPACITY, nullptr) {}
+
+IdentifierInfo* IdentifierTable::get(std::string_view name, u32 hash) {
+    DELTA_ASSERT(hash == IdentifierTable::hash(name));
+
+    u32 idx = find_slot(name, hash);
+
+    if (slots[idx] != nullptr) {
+        return slots[idx];
+    }
+
+    char* spelling = (char*)allocate(name.size());
+    std::memcpy(spelling, name.data(), name.size());
+
+    void* mem = allocate(sizeof(IdentifierInfo));
+    auto* info = new (mem) IdentifierInfo(spelling, (u32)name.size(), hash, (u32)infos.size());
+
+    slots[idx] = info;
+    infos.push_back(info);
+
+    // keep the load factor at most 1/2
+    if (infos.size() * 2 > slots.size()) {
+        grow();
+    }
+
+    return info;
+}
+
+IdentifierInfo* IdentifierTable::find(std::string_view name) const {
+    return slots[find_slot(name, hash(name))];
+}
+
+usize IdentifierTable::memory_usage() const {
+    return block_bytes + slots.size() * sizeof(IdentifierInfo*) + infos.size() * sizeof(IdentifierInfo*);
+}
+
+u32 IdentifierTable::find_slot(std::string_view name, u32 hash) const {
+    usize mask = slots.size() - 1;
+    usize idx = hash & mask;
+
+    while (slots[idx] != nullptr && (slots[idx]->hash() != hash || slots[idx]->name() != name)) {
+        idx = (idx + 1) & mask;
+    }
+
+    return (u32)idx;
+}
+
+void IdentifierTable::grow() {
+    std::vector<IdentifierInfo*> old = std::move(slots);
+    slots.assign(old.size() * 2, nullptr);
+
+    usize mask = slots.size() - 1;
+
+    for (IdentifierInfo* info : old) {
+        if (info == nullptr) {
+            continue;
+        }
+
+        usize idx = info->hash() & mask;
+
+        while (slots[idx] != nullptr) {
+            idx = (idx + 1) & mask;
+        }
+
+        slots[idx] = info;
+    }
+}
+
+void* IdentifierTable::allocate(usize bytes) {
+    constexpr usize align = alignof(IdentifierInfo);
+
+    usize pad = (align - (uintptr_t)block_curr % align) % align;
+
+    if (block_curr == nullptr || (usize)(block_end - block_curr) < pad + bytes) {
+        usize size = std::max(BLOCK_SIZE, bytes + align);
+
+        blocks.emplace_back(new char[size]);
+        block_curr = blocks.back().get();
+        block_end = block_curr + size;
+        block_bytes += size;
+
+        pad = (align - (uintptr_t)block_curr % align) % align;
+    }
+
+    void* ret = block_curr + pad;
+    block_curr += pad + bytes;
+
+    return ret;
+}
+
+}
@@ -0,0 +1,390 @@
+#include "interpreter.hpp"
+#include "timetrace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// labels as values, a GNU extension
+#if defined(__GNUC__) && !defined(DELTAC_VM_SWITCH_DISPATCH)
+#define DELTAC_VM_COMPUTED_GOTO 1
+#endif
+
+namespace deltac {
+
+Interpreter::Interpreter(const bc::Module& module, usize stack_size) :
+    module(module), globals(module.globals), stack(new u64[stack_size]), stack_size(stack_size) {
+    frames.reserve(64);
+}
+
+namespace {
+
+template <class T>
+u64 load(const void* address) {
+    T value;
+    std::memcpy(&value, address, sizeof(T));
+
+    // sign or zero extends to the canonical register value
+    return (u64)(std::conditional_t<std::is_signed_v<T>, i64, u64>)value;
+}
+
+template <class T>
+void store(void* address, u64 value) {
+    const T narrow = (T)value;
+    std::memcpy(address, &narrow, sizeof(T));
+}
+
+u64 load_memory(u64 address, u16 kind) {
+    const void* ptr = reinterpret_cast<const void*>(address);
+
+    switch (kind) {
+    case bc::MemI8: return load<i8>(ptr);
+    case bc::MemI16: return load<i16>(ptr);
+    case bc::MemI32: return load<i32>(ptr);
+    case bc::MemU8: return load<u8>(ptr);
+    case bc::MemU16: return load<u16>(ptr);
+    case bc::MemU32: return load<u32>(ptr);
+    default: return load<u64>(ptr);
+    }
+}
+
+void store_memory(u64 address, u64 value, u16 kind) {
+    void* ptr = reinterpret_cast<void*>(address);
+
+    switch (kind) {
+    case bc::MemI8:
+    case bc::MemU8:
+        store<u8>(ptr, value);
+        break;
+    case bc::MemI16:
+    case bc::MemU16:
+        store<u16>(ptr, value);
+        break;
+    case bc::MemI32:
+    case bc::MemU32:
+        store<u32>(ptr, value);
+        break;
+    default:
+        store<u64>(ptr, value);
+        break;
+    }
+}
+
+/*
+ * Integer and pointer arguments are passed in the same registers whatever their width in
+ * the x86-64 and AArch64 calling conventions, so every native function is called as if
+ * it took and returned 64 bit integers. The lowering extends the low bits of the result.
+ */
+u64 call_native(const bc::NativeFunction& fn, const u64* args) {
+    void* address = fn.address;
+
+    switch (fn.num_params) {
+    case 0:
+        return reinterpret_cast<u64 (*)()>(address)();
+    case 1:
+        return reinterpret_cast<u64 (*)(u64)>(address)(args[0]);
+    case 2:
+        return reinterpret_cast<u64 (*)(u64, u64)>(address)(args[0], args[1]);
+    case 3:
+        return reinterpret_cast<u64 (*)(u64, u64, u64)>(address)(args[0], args[1], args[2]);
+    case 4:
+        return reinterpret_cast<u64 (*)(u64, u64, u64, u64)>(address)(args[0], args[1], args[2], args[3]);
+    case 5:
+        return reinterpret_cast<u64 (*)(u64, u64, u64, u64, u64)>(address)(
+            args[0], args[1], args[2], args[3], args[4]
+        );
+    case 6:
+        return reinterpret_cast<u64 (*)(u64, u64, u64, u64, u64, u64)>(address)(
+            args[0], args[1], args[2], args[3], args[4], args[5]
+        );
+    }
+
+    DELTA_UNREACHABLE("the lowering rejects natives with more parameters");
+}
+
+inline u64 sext32(u64 value) {
+    return (u64)(i64)(i32)(u32)value;
+}
+
+// the minimum value of a signed integer of bits bits, as held by a register
+inline u64 signed_min(i32 bits) {
+    return ~u64(0) << (bits - 1);
+}
+
+} // namespace
+
+std::optional<u64> Interpreter::call(u32 function, llvm::ArrayRef<u64> args, std::string& error) {
+    const bc::Function& entry = module.functions[function];
+
+    DELTA_ASSERT(args.size() == entry.num_params);
+
+    if (entry.num_registers > stack_size) {
+        error = "stack overflow";
+        return std::nullopt;
+    }
+
+    std::copy(args.begin(), args.end(), stack.get());
+    frames.clear();
+
+    u64* r = stack.get();
+    u64* const stack_end = stack.get() + stack_size;
+    u64* const g = globals.data();
+    const u64* const k = module.constants.data();
+    const bc::Instr* code = entry.code.data();
+    const bc::Instr* pc = code;
+
+    u64 result = 0;
+    const char* fault = nullptr;
+
+#ifdef DELTAC_VM_COMPUTED_GOTO
+    static void* const LABELS[] = {
+#define OPCODE(X) &&op_##X,
+#include "opcodes.inc"
+    };
+
+#define CASE(X) op_##X:
+#define DISPATCH() goto *LABELS[pc->op]
+#define NEXT() goto *LABELS[(++pc)->op]
+
+    DISPATCH();
+#else
+#define CASE(X) case bc::X:
+#define DISPATCH() continue
+#define NEXT() { ++pc; continue; }
+
+    for (;;) switch (pc->op) {
+#endif
+
+#define A r[pc->a]
+#define B r[pc->b]
+#define C r[pc->c]
+#define SIGNED(X) ((i64)(X))
+#define JUMP_IF(COND) if (COND) { pc = code + pc->imm; DISPATCH(); } NEXT()
+
+    CASE(Move) A = B; NEXT();
+    CASE(LoadImm) A = (u64)(i64)pc->imm; NEXT();
+    CASE(LoadConst) A = k[pc->imm]; NEXT();
+    CASE(LoadGlobal) A = g[pc->imm]; NEXT();
+    CASE(StoreGlobal) g[pc->imm] = A; NEXT();
+    CASE(Load) A = load_memory(B, pc->c); NEXT();
+    CASE(Store) store_memory(A, B, pc->c); NEXT();
+
+    CASE(Add) A = B + C; NEXT();
+    CASE(Sub) A = B - C; NEXT();
+    CASE(Mul) A = B * C; NEXT();
+
+    CASE(SDiv)
+        if (C == 0) {
+            fault = "division by zero";
+            goto trap;
+        }
+
+        if (SIGNED(C) == -1 && B == signed_min(pc->imm)) {
+            fault = "division overflow";
+            goto trap;
+        }
+
+        A = (u64)(SIGNED(B) / SIGNED(C));
+        NEXT();
+
+    CASE(UDiv)
+        if (C == 0) {
+            fault = "division by zero";
+            goto trap;
+        }
+
+        A = B / C;
+        NEXT();
+
+    CASE(SRem)
+        if (C == 0) {
+            fault = "division by zero";
+            goto trap;
+        }
+
+        if (SIGNED(C) == -1 && B == signed_min(pc->imm)) {
+            fault = "division overflow";
+            goto trap;
+        }
+
+        A = (u64)(SIGNED(B) % SIGNED(C));
+        NEXT();
+
+    CASE(URem)
+        if (C == 0) {
+            fault = "division by zero";
+            goto trap;
+        }
+
+        A = B % C;
+        NEXT();
+
+    // shifting by the width or more is undefined, the amount wraps like on x86
+    CASE(Shl) A = B << (C & 63); NEXT();
+    CASE(AShr) A = (u64)(SIGNED(B) >> (C & 63)); NEXT();
+    CASE(LShr) A = B >> (C & 63); NEXT();
+    CASE(And) A = B & C; NEXT();
+    CASE(Or) A = B | C; NEXT();
+    CASE(Xor) A = B ^ C; NEXT();
+
+    CASE(Eq) A = B == C; NEXT();
+    CASE(Ne) A = B != C; NEXT();
+    CASE(SLt) A = SIGNED(B) < SIGNED(C); NEXT();
+    CASE(SLe) A = SIGNED(B) <= SIGNED(C); NEXT();
+    CASE(SGt) A = SIGNED(B) > SIGNED(C); NEXT();
+    CASE(SGe) A = SIGNED(B) >= SIGNED(C); NEXT();
+    CASE(ULt) A = B < C; NEXT();
+    CASE(ULe) A = B <= C; NEXT();
+    CASE(UGt) A = B > C; NEXT();
+    CASE(UGe) A = B >= C; NEXT();
+
+    CASE(Neg) A = 0 - B; NEXT();
+    CASE(Not) A = ~B; NEXT();
+    CASE(LogicalNot) A = B ^ 1; NEXT();
+
+    CASE(Sext8) A = (u64)(i64)(i8)(u8)B; NEXT();
+    CASE(Sext16) A = (u64)(i64)(i16)(u16)B; NEXT();
+    CASE(Sext32) A = sext32(B); NEXT();
+    CASE(Zext8) A = (u8)B; NEXT();
+    CASE(Zext16) A = (u16)B; NEXT();
+    CASE(Zext32) A = (u32)B; NEXT();
+    CASE(ToBool) A = B != 0; NEXT();
+
+    CASE(Jump) pc = code + pc->imm; DISPATCH();
+    CASE(JumpIfFalse) JUMP_IF(A == 0);
+    CASE(JumpIfTrue) JUMP_IF(A != 0);
+
+    CASE(Call) {
+        const bc::Function& callee = module.functions[pc->imm];
+        u64* window = r + pc->a;
+
+        if ((usize)(stack_end - window) < callee.num_registers || frames.size() == MAX_CALL_DEPTH) {
+            fault = "stack overflow";
+            goto trap;
+        }
+
+        frames.push_back({ code, pc + 1, r });
+
+        r = window;
+        code = callee.code.data();
+        pc = code;
+        DISPATCH();
+    }
+
+    CASE(CallNative) A = call_native(module.natives[pc->imm], &A); NEXT();
+
+    // the first register of the callee is the register the caller expects the result in
+    CASE(Return)
+        r[0] = A;
+        goto return_to_caller;
+
+    CASE(ReturnVoid)
+    return_to_caller: {
+        if (frames.empty()) {
+            result = r[0];
+            goto done;
+        }
+
+        const Frame& frame = frames.back();
+
+        code = frame.code;
+        pc = frame.return_pc;
+        r = frame.registers;
+
+        frames.pop_back();
+        DISPATCH();
+    }
+
+    CASE(Add32) A = sext32(B + C); NEXT();
+    CASE(Sub32) A = sext32(B - C); NEXT();
+    CASE(Mul32) A = sext32(B * C); NEXT();
+    CASE(AddImm) A = B + (u64)(i64)pc->imm; NEXT();
+    CASE(SubImm) A = B - (u64)(i64)pc->imm; NEXT();
+    CASE(AddImm32) A = sext32(B + (u64)(i64)pc->imm); NEXT();
+    CASE(SubImm32) A = sext32(B - (u64)(i64)pc->imm); NEXT();
+
+    CASE(JumpEq) JUMP_IF(A == B);
+    CASE(JumpNe) JUMP_IF(A != B);
+    CASE(JumpLt) JUMP_IF(SIGNED(A) < SIGNED(B));
+    CASE(JumpLe) JUMP_IF(SIGNED(A) <= SIGNED(B));
+    CASE(JumpGt) JUMP_IF(SIGNED(A) > SIGNED(B));
+    CASE(JumpGe) JUMP_IF(SIGNED(A) >= SIGNED(B));
+    CASE(JumpEqImm) JUMP_IF(SIGNED(A) == (i16)pc->c);
+    CASE(JumpNeImm) JUMP_IF(SIGNED(A) != (i16)pc->c);
+    CASE(JumpLtImm) JUMP_IF(SIGNED(A) < (i16)pc->c);
+    CASE(JumpLeImm) JUMP_IF(SIGNED(A) <= (i16)pc->c);
+    CASE(JumpGtImm) JUMP_IF(SIGNED(A) > (i16)pc->c);
+    CASE(JumpGeImm) JUMP_IF(SIGNED(A) >= (i16)pc->c);
+
+#ifndef DELTAC_VM_COMPUTED_GOTO
+    case bc::NumOps:
+        DELTA_UNREACHABLE("not an instruction");
+    }
+#endif
+
+#undef CASE
+#undef DISPATCH
+#undef NEXT
+#undef A
+#undef B
+#undef C
+#undef SIGNED
+#undef JUMP_IF
+
+trap:
+    error = fault;
+    return std::nullopt;
+
+done:
+    return entry.returns_value ? result : 0;
+}
+
+std::optional<int> Interpreter::run_main(const std::vector<std::string>& args, std::string& error) {
+    TimeTraceScope scope("Interpret");
+
+    const u32 main_fn = module.find_function("main");
+
+    if (main_fn == bc::Module::NO_FUNCTION) {
+        error = "no definition of 'main'";
+        return std::nullopt;
+    }
+
+    const bc::Function& main_def = module.functions[main_fn];
+
+    // the bytecode has no parameter types, only their number is checked
+    if (main_def.num_params != 0 && main_def.num_params != 2) {
+        error = "'main' must be fn main() i32, fn main() or fn main(argc i32, argv **u8) i32";
+        return std::nullopt;
+    }
+
+    if (module.init_function != bc::Module::NO_FUNCTION && !call(module.init_function, {}, error)) {
+        return std::nullopt;
+    }
+
+    std::optional<u64> ret;
+
+    if (main_def.num_params == 0) {
+        ret = call(main_fn, {}, error);
+    }
+    else {
+        std::vector<char*> argv;
+
+        for (const std::string& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+
+        argv.push_back(nullptr);
+
+        const u64 main_args[] = { (u64)args.size(), (u64)reinterpret_cast<uintptr_t>(argv.data()) };
+        ret = call(main_fn, main_args, error);
+    }
+
+    if (!ret) {
+        return std::nullopt;
+    }
+
+    return (int)(i32)*ret;
+}
+
+}
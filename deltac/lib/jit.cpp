@@ -0,0 +1,167 @@
+#include "jit.hpp"
+#include "timetrace.hpp"
+
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Support/Error.h"
+
+namespace deltac::jit {
+
+namespace {
+
+enum class MainKind {
+    Invalid,
+    // fn main()
+    Void,
+    // fn main() i32
+    NoArgs,
+    // fn main(argc i32, argv **u8) i32
+    WithArgs,
+};
+
+MainKind classify_main(const llvm::FunctionType* ty) {
+    llvm::Type* ret = ty->getReturnType();
+
+    if (ty->getNumParams() == 0) {
+        if (ret->isVoidTy()) {
+            return MainKind::Void;
+        }
+
+        return ret->isIntegerTy(32) ? MainKind::NoArgs : MainKind::Invalid;
+    }
+
+    if (ty->getNumParams() != 2 || !ret->isIntegerTy(32) || !ty->getParamType(0)->isIntegerTy(32)) {
+        return MainKind::Invalid;
+    }
+
+    // **u8
+    llvm::Type* argv = ty->getParamType(1);
+    llvm::Type* i8_ptr = llvm::Type::getInt8PtrTy(ty->getContext());
+
+    return argv == i8_ptr->getPointerTo() ? MainKind::WithArgs : MainKind::Invalid;
+}
+
+// moves the message of err into error
+bool failed(llvm::Error err, std::string& error) {
+    if (!err) {
+        return false;
+    }
+
+    error = llvm::toString(std::move(err));
+    return true;
+}
+
+} // namespace
+
+std::optional<int> run_main(CodeGen& codegen, const std::vector<std::string>& args, std::string& error) {
+    TimeTraceScope scope("JIT run");
+
+    const CodeGen::OptLevel level = codegen.opt_level();
+    auto [context, module] = codegen.release_module();
+
+    const llvm::Function* main_fn = module->getFunction("main");
+
+    if (!main_fn || main_fn->isDeclaration()) {
+        error = "no definition of 'main'";
+        return std::nullopt;
+    }
+
+    const MainKind kind = classify_main(main_fn->getFunctionType());
+
+    if (kind == MainKind::Invalid) {
+        error = "'main' must be fn main() i32, fn main() or fn main(argc i32, argv **u8) i32";
+        return std::nullopt;
+    }
+
+    auto machine_builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+
+    if (!machine_builder) {
+        failed(machine_builder.takeError(), error);
+        return std::nullopt;
+    }
+
+    machine_builder->setCodeGenOptLevel(CodeGen::codegen_level(level));
+
+    auto lazy_jit = llvm::orc::LLLazyJITBuilder()
+        .setJITTargetMachineBuilder(std::move(*machine_builder))
+        .create();
+
+    if (!lazy_jit) {
+        failed(lazy_jit.takeError(), error);
+        return std::nullopt;
+    }
+
+    llvm::orc::LLLazyJIT& jit = **lazy_jit;
+    llvm::orc::JITDylib& dylib = jit.getMainJITDylib();
+
+    // the host CPU may have a different layout than the generic one the module was built for
+    module->setDataLayout(jit.getDataLayout());
+
+    auto process_symbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        jit.getDataLayout().getGlobalPrefix()
+    );
+
+    if (!process_symbols) {
+        failed(process_symbols.takeError(), error);
+        return std::nullopt;
+    }
+
+    dylib.addGenerator(std::move(*process_symbols));
+
+    llvm::orc::ThreadSafeModule tsm(std::move(module), std::move(context));
+
+    if (failed(jit.addLazyIRModule(std::move(tsm)), error)) {
+        return std::nullopt;
+    }
+
+    // runs llvm.global_ctors
+    if (failed(jit.initialize(dylib), error)) {
+        return std::nullopt;
+    }
+
+    auto main_symbol = jit.lookup("main");
+
+    if (!main_symbol) {
+        failed(main_symbol.takeError(), error);
+        return std::nullopt;
+    }
+
+    const llvm::JITTargetAddress address = main_symbol->getAddress();
+    int ret = 0;
+
+    switch (kind) {
+    case MainKind::Void:
+        llvm::jitTargetAddressToFunction<void (*)()>(address)();
+        break;
+
+    case MainKind::NoArgs:
+        ret = llvm::jitTargetAddressToFunction<int (*)()>(address)();
+        break;
+
+    case MainKind::WithArgs: {
+        std::vector<char*> argv;
+
+        for (const std::string& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+
+        argv.push_back(nullptr);
+
+        ret = llvm::jitTargetAddressToFunction<int (*)(int, char**)>(address)((int)args.size(), argv.data());
+        break;
+    }
+
+    case MainKind::Invalid:
+        DELTA_UNREACHABLE("checked before compiling");
+    }
+
+    if (failed(jit.deinitialize(dylib), error)) {
+        return std::nullopt;
+    }
+
+    return ret;
+}
+
+}
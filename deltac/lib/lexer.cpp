@@ -1,21 +1,67 @@
 #include "lexer.hpp"
+#include "charscan.hpp"
+#include "statistic.hpp"
+#include "timetrace.hpp"
+
+#include <algorithm>
+#include <thread>
 
 namespace deltac {
 
-const KeywordTrie Lexer::kwtrie = {
-#define KEYWORD(X, Y) tok::X,
-#include "tokentype.inc"
-};
+static std::string_view token_kind_label(usize kind) {
+    return token_type_enum_name((tok::Kind)kind);
+}
+
+DELTAC_STATISTIC(NumTokens, "lexer", "Number of tokens lexed");
+DELTAC_STATISTIC(NumBytesLexed, "lexer", "Number of source bytes lexed into token buffers");
+DELTAC_STATISTIC_ARRAY(NumTokensByKind, "lexer", "Number of tokens lexed by kind", tok::NUM_KINDS, token_kind_label);
+
+void Lexer::count_token(tok::Kind kind) {
+    ++NumTokens;
+    NumTokensByKind.add(kind);
+}
+
+// counts tokens [first, size) of a finished buffer
+static void count_tokens(const TokenBuffer& tokens, usize first) {
+    if (!stats::is_enabled()) {
+        return;
+    }
 
-Lexer::Lexer(const char* begin, const char* end) : 
-    buffer_start(begin), buffer_end(end), buffer_curr(buffer_start) {}
+    NumTokens += tokens.size() - first;
+
+    for (usize i = first; i < tokens.size(); i++) {
+        NumTokensByKind.add(tokens.kind(i));
+    }
+}
+
+Lexer::Lexer(const char* begin, const char* end, SourceLocation start) : 
+    buffer_start(begin), buffer_end(end), buffer_curr(buffer_start), scan_end(end), start_loc(start) {}
+
+Lexer::Lexer(const SourceBuffer& buffer, SourceLocation start) : 
+    buffer_start(buffer.ptr_cbegin()), buffer_end(buffer.ptr_cend()), buffer_curr(buffer_start),
+    scan_end(buffer.cend() + SourceBuffer::PADDING), start_loc(start) {}
 
 void Lexer::form_token(Token& result, const char* token_end, tok::Kind type) {
     result.set_type(type);
     result.set_view(buffer_curr, token_end);
+
+    if (start_loc.is_valid()) {
+        result.set_location(start_loc.offset_by((u32)(buffer_curr - buffer_start)));
+    }
+
     buffer_curr = token_end;
 }
 
+bool Lexer::form_error(Token& result, const char* token_end, diag::Kind kind) {
+    form_token(result, token_end, tok::ERROR);
+
+    if (diags) {
+        diags->report(result.get_location(), kind, { result.get_view() });
+    }
+
+    return false;
+}
+
 // prev_char is numeric and consumed
 bool Lexer::lex_numeric_literal(Token& result, const char* curr_ptr) {
     bool dot = false;
@@ -52,18 +98,14 @@ bool Lexer::lex_numeric_literal(Token& result, const char* curr_ptr) {
         }
     }
     
-    // TODO: Error invalid numeric literal
-    form_token(result, curr_ptr, tok::ERROR);
-    return false;
+    return form_error(result, curr_ptr, diag::InvalidToken);
 }
 
 bool Lexer::lex_hex(Token& result, const char* curr_ptr) {
     while (true) {
         char digit = *curr_ptr;
         if (!is_hex_digit(digit) && is_alphanumeric(digit)) {
-            // TODO: Error invalid hexdec literal
-            form_token(result, curr_ptr, tok::ERROR);
-            return false;
+            return form_error(result, curr_ptr, diag::InvalidToken);
         }
         else if (is_hex_digit(digit)) {
             curr_ptr++;
@@ -79,55 +121,177 @@ bool Lexer::lex_hex(Token& result, const char* curr_ptr) {
 }
 
 
-bool Lexer::lex_string_literal(Token& result, const char* curr_ptr) {
+// curr_ptr points to the character after the opening quote
+// eof points to the null terminator of the buffer
+// returns the position after the closing quote, or nullptr if eof is reached first
+static const char* string_literal_end(const char* curr_ptr, const char* eof) {
     bool escaped = false;
-    while (true) {
-        char c = *curr_ptr++;
+    for (; curr_ptr < eof; curr_ptr++) {
+        char c = *curr_ptr;
         if (c == '\\' && !escaped) {
             escaped = true;
         }
         else if (c == '"' && !escaped) {
             // end of string literal
-            break;
+            return curr_ptr + 1;
         }
         else {
             escaped = false;
         }
     }
 
-    form_token(result, curr_ptr, tok::StringLiteral);
+    return nullptr;
+}
+
+// curr_ptr points to the character after the opening quote
+// eof points to the null terminator of the buffer
+// returns the position after the literal, valid is set if the literal is well formed
+static const char* char_literal_end(const char* curr_ptr, const char* eof, bool& valid) {
+    if (curr_ptr < eof && *curr_ptr == '\\') {
+        // skipping through escaped char
+        curr_ptr++;
+    }
+
+    if (curr_ptr < eof) {
+        curr_ptr++;
+    }
+
+    if (curr_ptr < eof && *curr_ptr == '\'') {
+        valid = true;
+        return curr_ptr + 1;
+    }
+
+    // skips until the next single quote
+    valid = false;
+
+    while (curr_ptr < eof && *curr_ptr != '\'') {
+        curr_ptr++;
+    }
+
+    return curr_ptr < eof ? curr_ptr + 1 : curr_ptr;
+}
+
+bool Lexer::lex_string_literal(Token& result, const char* curr_ptr) {
+    const char* literal_end = string_literal_end(curr_ptr, buffer_end - 1);
+
+    if (!literal_end) {
+        return form_error(result, buffer_end - 1, diag::UnterminatedString);
+    }
+
+    form_token(result, literal_end, tok::StringLiteral);
     return true;
 }
 
 
 bool Lexer::lex_identifier_continue(Token& result, const char* curr_ptr) {
+    // hashes the identifier in the same pass for interning
+    u32 hash = IdentifierTable::hash_step(IdentifierTable::HASH_SEED, *buffer_curr);
+
     while (is_alphanumeric(*curr_ptr) || *curr_ptr == '_') {
+        hash = IdentifierTable::hash_step(hash, *curr_ptr);
         curr_ptr++;
     }
 
-    form_token(result, curr_ptr, tok::Identifier);
+    std::string_view spelling = util::make_sv(buffer_curr, curr_ptr);
+    tok::Kind type = tok::Identifier;
+
+    // keywords will never start with capital letters
+    if (is_lowercase(*buffer_curr)) {
+        type = KeywordTable::lookup(spelling).value_or(tok::Identifier);
+    }
+
+    form_token(result, curr_ptr, type);
+
+    if (type == tok::Identifier && identifiers) {
+        result.set_identifier_info(identifiers->get(spelling, hash));
+    }
+
     return true;
 }
 
-bool Lexer::lex(Token& result) {
+// curr_ptr points to the character after "//"
+// returns the position of the newline or the null terminator ending the comment
+const char* Lexer::skip_line_comment(const char* curr_ptr) const {
+    while (true) {
+        curr_ptr = find_first_of(curr_ptr, scan_end, '\n', 0);
+
+        // a null character inside of the comment is not the end of file
+        if (*curr_ptr == 0 && curr_ptr + 1 != buffer_end) {
+            curr_ptr++;
+            continue;
+        }
+
+        return curr_ptr;
+    }
+}
+
+// curr_ptr points to the character after "/*"
+// returns the position after "*/", or nullptr if the comment is unterminated
+const char* Lexer::skip_block_comment(const char* curr_ptr) const {
+    while (true) {
+        curr_ptr = find_first_of(curr_ptr, scan_end, '*', 0);
+
+        if (*curr_ptr == 0) {
+            if (curr_ptr + 1 == buffer_end) {
+                return nullptr;
+            }
+        }
+        else if (curr_ptr[1] == '/') {
+            return curr_ptr + 2;
+        }
+
+        curr_ptr++;
+    }
+}
+
+// skips whitespaces and comments
+// returns the start of the next token, or the "/*" of an unterminated block comment
+const char* Lexer::skip_trivia(const char* curr_ptr) const {
+    while (true) {
+        if (is_whitespace(*curr_ptr)) {
+            curr_ptr = skip_whitespace(curr_ptr + 1, scan_end);
+        }
+
+        if (*curr_ptr != '/') {
+            return curr_ptr;
+        }
+
+        if (curr_ptr[1] == '/') {
+            curr_ptr = skip_line_comment(curr_ptr + 2);
+        }
+        else if (curr_ptr[1] == '*') {
+            const char* comment_end = skip_block_comment(curr_ptr + 2);
+
+            // lex_token reports it from there
+            if (!comment_end) {
+                return curr_ptr;
+            }
+
+            curr_ptr = comment_end;
+        }
+        else {
+            return curr_ptr;
+        }
+    }
+}
+
+bool Lexer::lex_token(Token& result) {
     result.start_token();
     
     if (is_eof())
         return false;
 
-    const char* curr_ptr = buffer_curr;
-
     // buffer_curr points to c, curr_ptr points to the next char
     char c;
     char next;
     tok::Kind type;
 
-    // skips all the whitespaces before a token
+    // skips all the whitespaces and comments before a token
     // buffer_curr points to the start of the token
     // curr_ptr points to the next character to lex
-    while (is_whitespace(c = *curr_ptr++)) {
-        buffer_curr++;
-    }
+    const char* curr_ptr = skip_trivia(buffer_curr);
+    buffer_curr = curr_ptr;
+    c = *curr_ptr++;
 
     switch (c) {
     case 0: // reached eof?
@@ -135,9 +299,7 @@ bool Lexer::lex(Token& result) {
             form_token(result, curr_ptr, tok::EndOfFile);
             return true;
         } else {
-            // TODO: warn null in buffer
-            form_token(result, curr_ptr, tok::ERROR);
-            return false;
+            return form_error(result, curr_ptr, diag::InvalidToken);
         }
         
     case '0': 
@@ -157,22 +319,12 @@ bool Lexer::lex(Token& result) {
     case 'h': case 'i': case 'j': case 'k': case 'l': case 'm': case 'n':
     case 'o': case 'p': case 'q': case 'r': case 's': case 't': case 'u':
     case 'v': case 'w': case 'x': case 'y': case 'z':
-        // encountered keyword or identifier
-        // keywords will never start with capital letters
-        curr_ptr--; // return back to the first character for trie matching
-        type = kwtrie.tok_search(curr_ptr).value_or(tok::Identifier);
-        if (type != tok::Identifier) {
-            break;
-        }
-
-        [[fallthrough]];
-
     case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
     case 'H': case 'I': case 'J': case 'K': case 'L': case 'M': case 'N':
     case 'O': case 'P': case 'Q': case 'R': case 'S': case 'T': case 'U':
     case 'V': case 'W': case 'X': case 'Y': case 'Z':
     case '_':
-        // encountered identifier
+        // encountered keyword or identifier
         return lex_identifier_continue(result, curr_ptr);
     
     // handling simple punctuations
@@ -275,6 +427,11 @@ bool Lexer::lex(Token& result) {
     case '/':
         next = *curr_ptr;
 
+        // skip_trivia only stops at a block comment that is never closed
+        if (next == '*') {
+            return form_error(result, buffer_end - 1, diag::UnterminatedComment);
+        }
+
         if (next == '=') {
             curr_ptr++;
             type = tok::SlashEqual;
@@ -446,32 +603,22 @@ bool Lexer::lex(Token& result) {
         // encountered a string literal
         return lex_string_literal(result, curr_ptr);
 
-    case '\'':
+    case '\'': {
         // encountered a char literal
-        next = *curr_ptr++;
+        bool valid;
+        curr_ptr = char_literal_end(curr_ptr, buffer_end - 1, valid);
 
-        if (next == '\\') {
-            // skipping through escaped char
-            curr_ptr++;
-        }
-        
-        if (*curr_ptr == '\'') {
+        if (valid) {
             form_token(result, curr_ptr, tok::CharLiteral);
             return true;
         }
 
-        // TODO: Error invalid char literal
-        // skips until the next single quote
-        do {
-            curr_ptr++;
-        } while (*curr_ptr != '\'' && *curr_ptr != 0);
-        
-        [[fallthrough]];
+        return form_error(result, curr_ptr, diag::InvalidToken);
+    }
 
     default:
         // unrecognized character or bad char literal
-        form_token(result, curr_ptr, tok::ERROR);
-        return false;
+        return form_error(result, curr_ptr, diag::InvalidToken);
     }
 
 SuccessEnd:
@@ -480,4 +627,226 @@ SuccessEnd:
     return true;
 }
 
+bool Lexer::lex_all(TokenBuffer& out) {
+    TimeTraceScope scope("Lex");
+
+    // roughly one token every six characters in typical sources
+    out.reset(buffer_start, identifiers, start_loc);
+    out.reserve((usize)(buffer_end - buffer_curr) / 6 + 1);
+
+    NumBytesLexed += (u64)(buffer_end - buffer_curr);
+
+    bool success = lex_chunk(out, buffer_end);
+    count_tokens(out, 0);
+
+    return success;
+}
+
+bool Lexer::lex_chunk(TokenBuffer& out, const char* stop) {
+    Token token;
+    bool success = true;
+
+    while (!is_eof()) {
+        bool lexed = lex_token(token);
+
+        // interned identifiers do not point into the buffer, the token ends at buffer_curr
+        const char* token_start = buffer_curr - token.get_length();
+
+        // the token belongs to the next chunk, which reports it if it is an error
+        if (token_start >= stop) {
+            if (!lexed && diags) {
+                diags->truncate(diags->diagnostics().size() - 1);
+            }
+
+            break;
+        }
+
+        IdentifierInfo* info = token.get_identifier_info();
+
+        success &= lexed;
+        out.push_back(token.get_type(), util::make_sv(token_start, buffer_curr), 
+                      info ? info->id() : IdentifierTable::NO_IDENT);
+    }
+
+    return success;
+}
+
+/*
+ * Splits the rest of the buffer into at most count chunks that can be lexed independently.
+ * Each chunk except the first begins right after a newline that is not part of a
+ * string literal, a char literal or a comment. The literals and comments are skipped
+ * with the same routines used by lex, so no token can cross a chunk boundary.
+ */
+std::vector<const char*> Lexer::find_chunk_starts(usize count) const {
+    std::vector<const char*> starts { buffer_curr };
+
+    const char* eof = buffer_end - 1;
+    const usize chunk_size = (usize)(eof - buffer_curr) / count;
+    const char* target = buffer_curr + chunk_size;
+    const char* curr_ptr = buffer_curr;
+
+    while (curr_ptr < eof && starts.size() < count) {
+        // only literals, comments and line ends matter for a chunk boundary
+        curr_ptr = find_first_of(curr_ptr, eof, '"', '\'', '/', '\n');
+
+        if (curr_ptr == eof) {
+            break;
+        }
+
+        switch (*curr_ptr) {
+        case '"':
+            curr_ptr = string_literal_end(curr_ptr + 1, eof);
+
+            if (!curr_ptr) {
+                return starts;
+            }
+            break;
+
+        case '\'': {
+            bool valid;
+            curr_ptr = char_literal_end(curr_ptr + 1, eof, valid);
+            break;
+        }
+
+        case '/':
+            if (curr_ptr[1] == '/') {
+                // stops at the newline, which is then a candidate
+                curr_ptr = skip_line_comment(curr_ptr + 2);
+            }
+            else if (curr_ptr[1] == '*') {
+                curr_ptr = skip_block_comment(curr_ptr + 2);
+
+                if (!curr_ptr) {
+                    return starts;
+                }
+            }
+            else {
+                curr_ptr++;
+            }
+            break;
+
+        case '\n':
+            curr_ptr++;
+
+            if (curr_ptr >= target && curr_ptr < eof) {
+                starts.push_back(curr_ptr);
+                target = curr_ptr + chunk_size;
+            }
+            break;
+
+        default:
+            DELTA_UNREACHABLE("find_first_of stops at one of the characters above");
+        }
+    }
+
+    return starts;
+}
+
+bool Lexer::lex_all(TokenBuffer& out, unsigned num_threads) {
+    TimeTraceScope scope("Lex");
+
+    const usize size = (usize)(buffer_end - buffer_curr);
+    const usize max_chunks = std::min<usize>(num_threads, size / MIN_PARALLEL_CHUNK);
+
+    if (max_chunks <= 1) {
+        return lex_all(out);
+    }
+
+    std::vector<const char*> starts = find_chunk_starts(max_chunks);
+    const usize count = starts.size();
+
+    if (count <= 1) {
+        return lex_all(out);
+    }
+
+    std::vector<TokenBuffer> chunks(count);
+    std::vector<char> results(count, false);
+    // the table is not thread safe, each chunk interns into one of its own
+    std::vector<IdentifierTable> chunk_identifiers(identifiers ? count : 0);
+    std::vector<DiagnosticsEngine> chunk_diags(diags ? count : 0);
+
+    auto lex_nth_chunk = [&](usize idx) {
+        TimeTraceScope chunk_scope("Lex chunk");
+
+        const char* stop = idx + 1 < count ? starts[idx + 1] : buffer_end;
+
+        Lexer chunk_lexer = *this;
+        chunk_lexer.buffer_curr = starts[idx];
+        chunk_lexer.identifiers = identifiers ? &chunk_identifiers[idx] : nullptr;
+        chunk_lexer.diags = diags ? &chunk_diags[idx] : nullptr;
+
+        chunks[idx].reset(buffer_start, chunk_lexer.identifiers);
+        chunks[idx].reserve((usize)(stop - starts[idx]) / 6 + 1);
+
+        results[idx] = chunk_lexer.lex_chunk(chunks[idx], stop);
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(count - 1);
+
+    for (usize i = 1; i < count; i++) {
+        workers.emplace_back(lex_nth_chunk, i);
+    }
+
+    lex_nth_chunk(0);
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // stitches the chunks back together in order
+    TimeTraceScope stitch_scope("Stitch token chunks");
+
+    usize total = 0;
+    for (const TokenBuffer& chunk : chunks) {
+        total += chunk.size();
+    }
+
+    out.reset(buffer_start, identifiers, start_loc);
+    out.reserve(total);
+
+    std::vector<u32> global_ids;
+
+    for (usize idx = 0; idx < count; idx++) {
+        usize first = out.size();
+        out.append(chunks[idx]);
+
+        if (diags) {
+            diags->take(chunk_diags[idx]);
+        }
+
+        if (!identifiers) {
+            continue;
+        }
+
+        // merges each name of the chunk once, with the hash the chunk lexer computed,
+        // in the order of its first token, which gives the same ids as a sequential lex
+        const IdentifierTable& local = chunk_identifiers[idx];
+        global_ids.assign(local.size(), IdentifierTable::NO_IDENT);
+
+        for (usize i = first; i < out.size(); i++) {
+            u32 local_id = out.ident_id(i);
+
+            if (local_id == IdentifierTable::NO_IDENT) {
+                continue;
+            }
+
+            if (global_ids[local_id] == IdentifierTable::NO_IDENT) {
+                const IdentifierInfo* info = local.info(local_id);
+                global_ids[local_id] = identifiers->get(info->name(), info->hash())->id();
+            }
+
+            out.set_ident_id(i, global_ids[local_id]);
+        }
+    }
+
+    NumBytesLexed += size;
+    count_tokens(out, 0);
+
+    // the whole buffer has been consumed by the chunk lexers
+    buffer_curr = buffer_end;
+
+    return std::all_of(results.begin(), results.end(), [](char r) { return r != 0; });
+}
+
 }
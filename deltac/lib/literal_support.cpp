@@ -23,7 +23,7 @@ static bool fits_into_64_bits(std::uint8_t radix, std::size_t numdigits) {
 }
 
 IntLiteralParser::IntLiteralParser(const Token& t) : 
-    begin(&t.get_view().front()), end(&t.get_view().back()) {
+    begin(t.get_view().data()), end(t.get_view().data() + t.get_view().size()) {
     const int prefix_size = 2;
 
     const std::string_view& sv = t.get_view();
@@ -33,7 +33,7 @@ IntLiteralParser::IntLiteralParser(const Token& t) :
         radix = 10;
     }
     else if (sv.substr(0, prefix_size) == "0x") {
-        digit_begin = &s[prefix_size];
+        digit_begin = begin + prefix_size;
         radix = 16;
     }
     else {
@@ -44,19 +44,15 @@ IntLiteralParser::IntLiteralParser(const Token& t) :
 }
 
 IntLiteralParser::IntLiteralParser(const Token& t, std::uint8_t radix) :
-    begin(&t.get_view().front()), end(&t.get_view().back()), 
+    begin(t.get_view().data()), end(t.get_view().data() + t.get_view().size()), 
     digit_begin(radix != 10 ? begin + 2 : begin), s(digit_begin),
     radix(radix) {}
     
 
 bool IntLiteralParser::get_apint_val(llvm::APInt& val) {
-    const std::size_t numdigits = end - begin;
+    const std::size_t numdigits = end - digit_begin;
 
-    if (!fits_into_64_bits(radix, numdigits)) {
-        // do not support over 64 bits for now
-        return false;
-    }
-    else {
+    if (fits_into_64_bits(radix, numdigits)) {
         uint64_t n = 0;
 
         for (char c : get_digits()) {
@@ -66,6 +62,27 @@ bool IntLiteralParser::get_apint_val(llvm::APInt& val) {
         val = n;
         return val.getZExtValue() != n;
     }
+
+    // the slow path of clang::NumericLiteralParser::GetIntegerValue
+    const llvm::APInt radix_val(val.getBitWidth(), radix);
+    llvm::APInt digit_val(val.getBitWidth(), 0);
+    bool overflow = false;
+
+    val = 0;
+
+    for (char c : get_digits()) {
+        llvm::APInt old_val = val;
+
+        digit_val = llvm::hexDigitValue(c);
+
+        val *= radix_val;
+        overflow |= val.udiv(radix_val) != old_val;
+
+        val += digit_val;
+        overflow |= val.ult(digit_val);
+    }
+
+    return overflow;
 }
 
 }
@@ -2,20 +2,43 @@
 
 #include "literal_support.hpp"
 #include "operators.hpp"
+#include "stack.hpp"
+#include "statistic.hpp"
+#include "timetrace.hpp"
 #include "tokentype.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <string>
 #include <string_view>
+#include <thread>
 
 namespace deltac {
 
-Parser::Parser(Lexer& lexer, Sema& s) : lexer(lexer), action(s) {
+DELTAC_STATISTIC(NumSkippedBodies, "parser", "Number of function bodies skipped by the declaration pass");
+DELTAC_STATISTIC(NumPendingBodiesParsed, "parser", "Number of skipped function bodies parsed later");
+
+Parser::Parser(Lexer& lexer, Sema& s) : lexer(&lexer), action(s) {
+    lexer.set_identifier_table(&s.identifier_table());
     lexer.lex(curr_token); // must at least have an EOF token
     
     if (curr_token.is(tok::EndOfFile))
         void();// TODO: diag empty file
 }
 
+Parser::Parser(const TokenBuffer& tokens, Sema& s) : tokens(&tokens), action(s) {
+    DELTA_ASSERT_MSG(!tokens.empty() && tokens.kind(tokens.size() - 1) == tok::EndOfFile, 
+                     "token buffer must end with EndOfFile");
+    DELTA_ASSERT_MSG(tokens.identifier_table() == &s.identifier_table(),
+                     "tokens must be lexed with the identifier table of the context");
+
+    curr_token = tokens.token(0);
+
+    if (curr_token.is(tok::EndOfFile))
+        void();// TODO: diag empty file
+}
+
 /*
  * Program
  *     : TopLevelDeclaration
@@ -31,6 +54,8 @@ bool Parser::parse_top_level_decl(Decl*& res) {
         return false;
     }
 
+    TimeTraceScope scope("Parse top level decl");
+
     auto declres = declaration();
 
     if (declres) {
@@ -41,8 +66,352 @@ bool Parser::parse_top_level_decl(Decl*& res) {
         return false;
     }
 }
+/*
+ * Declaration
+ *     : VariableDeclaration
+ *     | FunctionDeclaration
+ *     ;
+ */
+DeclResult Parser::declaration() {
+    switch (curr_token.get_type()) {
+    case tok::Let:
+        return variable_declaration();
+    case tok::Fn:
+        return function_declaration();
+    default:
+        report(diag::ExpectedDeclaration);
+        return action_error;
+    }
+}
+
+/*
+ * VariableDeclaration
+ *     : 'let' Identifier TypeSpecifier[opt] '=' Expression ';'
+ *     | 'let' Identifier TypeSpecifier ';'
+ *     ;
+ */
+DeclResult Parser::variable_declaration() {
+    advance(); // let
+
+    if (!curr_token.is(tok::Identifier)) {
+        report(diag::ExpectedIdentifier);
+        return action_error;
+    }
 
+    Token id = curr_token;
 
+    advance();
+
+    TypeResult ty = action_error;
+
+    if (!curr_token.is(tok::Equal)) {
+        ty = type();
+
+        if (!ty) {
+            return action_error;
+        }
+    }
+
+    ExprResult init = action_error;
+
+    if (try_advance(tok::Equal)) {
+        init = expression();
+
+        if (!init) {
+            return action_error;
+        }
+    }
+
+    if (!advance_expected(tok::Semicolon)) {
+        return action_error;
+    }
+
+    return action.act_on_var_decl(id, ty ? &*ty : nullptr, init ? *init : nullptr);
+}
+
+/*
+ * FunctionDeclaration
+ *     : 'fn' Identifier '(' ParameterList[opt] ')' TypeSpecifier[opt] CompoundStatement
+ *     | 'fn' Identifier '(' ParameterList[opt] ')' TypeSpecifier[opt] ';'
+ *     ;
+ *
+ * ParameterList
+ *     : ParameterDeclaration
+ *     | ParameterList ',' ParameterDeclaration
+ *     ;
+ */
+DeclResult Parser::function_declaration() {
+    advance(); // fn
+
+    if (!curr_token.is(tok::Identifier)) {
+        report(diag::ExpectedIdentifier);
+        return action_error;
+    }
+
+    Token id = curr_token;
+
+    advance();
+
+    ScratchList<Parameter> params(param_scratch);
+
+    bool is_valid = parse_list_of(
+        params,
+        [this] { return parameter(); },
+        tok::LeftParen,
+        tok::RightParen
+    );
+
+    if (!is_valid) {
+        return action_error;
+    }
+
+    TypeResult ret_ty = action_error;
+
+    if (!curr_token.is_one_of(tok::LeftBrace, tok::Semicolon)) {
+        ret_ty = type();
+
+        if (!ret_ty) {
+            return action_error;
+        }
+    }
+
+    // declared before the body, which may call the function
+    DeclResult decl = action.act_on_func_decl(id, params.elements(), ret_ty ? &*ret_ty : nullptr);
+    return_if_not(decl);
+
+    if (try_advance(tok::Semicolon)) {
+        return decl;
+    }
+
+    auto* fn = util::cast<FuncDecl>(*decl);
+
+    if (lazy_bodies && curr_token.is(tok::LeftBrace)) {
+        PendingBody pending = { fn, token_idx, 0, action.symbol_table().size(), action.diagnostics().diagnostics().size(), {} };
+
+        if (!skip_body()) {
+            return action_error;
+        }
+
+        pending.end_token = token_idx;
+        pending_body_index[fn] = pending_bodies.size();
+        pending_bodies.push_back(std::move(pending));
+        ++NumSkippedBodies;
+
+        return action.act_on_skipped_func_body(fn);
+    }
+
+    return function_body(fn);
+}
+
+DeclResult Parser::function_body(FuncDecl* fn) {
+    SymbolTable::ScopeGuard fn_scope(action.symbol_table(), SymbolTable::FunctionScope);
+
+    if (!action.act_on_start_func_body(fn)) {
+        return action_error;
+    }
+
+    StmtResult body = compound_statement();
+
+    return action.act_on_finish_func_body(fn, body ? *body : nullptr);
+}
+
+bool Parser::skip_body() {
+    DELTA_ASSERT(tokens && curr_token.is(tok::LeftBrace));
+
+    usize depth = 0;
+
+    // the buffer ends with EndOfFile, so the scan stops there at the latest
+    for (usize idx = token_idx; ; idx++) {
+        switch (tokens->kind(idx)) {
+        case tok::LeftBrace:
+            depth++;
+            break;
+        case tok::RightBrace:
+            if (--depth == 0) {
+                restore_position(idx);
+                advance(); // }
+                return true;
+            }
+            break;
+        case tok::EndOfFile:
+            restore_position(idx);
+            report(diag::ExpectedToken, { token_type_name(tok::RightBrace) });
+            return false;
+        default:
+            break;
+        }
+    }
+}
+
+bool Parser::parse_pending_body(FuncDecl* fn) {
+    const bool parsed = parse_pending(fn);
+
+    merge_body_diagnostics();
+    return parsed;
+}
+
+bool Parser::parse_pending(FuncDecl* fn) {
+    DELTA_ASSERT(fn->is_body_pending());
+
+    const usize resume = save_position();
+
+    if (!parse_body(pending_bodies[pending_body_index.find(fn)->second])) {
+        return false;
+    }
+
+    restore_position(resume);
+    return true;
+}
+
+bool Parser::parse_body(PendingBody& pending) {
+    TimeTraceScope scope("Parse pending body");
+
+    SymbolTable::VisibleGlobalsGuard globals(action.symbol_table(), pending.visible_globals);
+
+    restore_position(pending.first_token);
+
+    const usize first_diag = action.diagnostics().diagnostics().size();
+    const bool parsed = function_body(pending.fn).is_usable();
+
+    pending.diags.take(action.diagnostics(), first_diag);
+
+    if (!parsed) {
+        return false;
+    }
+
+    ++NumPendingBodiesParsed;
+    return true;
+}
+
+void Parser::merge_body_diagnostics() {
+    DiagnosticsEngine& diags = action.diagnostics();
+    usize inserted = 0;
+
+    // in the order of the file, the positions of the later bodies move with every insertion
+    for (PendingBody& pending : pending_bodies) {
+        pending.diag_position += inserted;
+        inserted += pending.diags.diagnostics().size();
+
+        diags.insert(pending.diag_position, pending.diags);
+    }
+
+    // an eager pass stops at the first error, the declaration pass may have gone past it
+    diags.drop_after_first_error();
+}
+
+bool Parser::parse_referenced_bodies(llvm::ArrayRef<FuncDecl*> roots) {
+    std::vector<FuncDecl*> worklist(roots.begin(), roots.end());
+
+    // includes the references from the global initializers
+    for (FuncDecl* fn : action.take_pending_references()) {
+        worklist.push_back(fn);
+    }
+
+    bool parsed = true;
+
+    while (parsed && !worklist.empty()) {
+        FuncDecl* fn = worklist.back();
+        worklist.pop_back();
+
+        if (!fn->is_body_pending()) {
+            continue;
+        }
+
+        parsed = parse_pending(fn);
+
+        for (FuncDecl* callee : action.take_pending_references()) {
+            worklist.push_back(callee);
+        }
+    }
+
+    merge_body_diagnostics();
+    return parsed;
+}
+
+bool Parser::parse_pending_bodies(unsigned threads) {
+    std::vector<usize> order;
+
+    for (usize idx = 0; idx < pending_bodies.size(); idx++) {
+        if (pending_bodies[idx].fn->is_body_pending()) {
+            order.push_back(idx);
+        }
+    }
+
+    threads = (unsigned)std::min<usize>(threads, order.size());
+
+    if (threads <= 1) {
+        bool parsed = true;
+
+        for (usize i = 0; parsed && i < order.size(); i++) {
+            parsed = parse_pending(pending_bodies[order[i]].fn);
+        }
+
+        merge_body_diagnostics();
+        action.take_pending_references();
+        return parsed;
+    }
+
+    TimeTraceScope scope("Parse bodies in parallel");
+
+    // the largest bodies first, so that no thread starts a long one when the others are done
+    std::stable_sort(order.begin(), order.end(), [&](usize a, usize b) {
+        return pending_bodies[a].size() > pending_bodies[b].size();
+    });
+
+    std::atomic<usize> next = 0;
+    // the index of the first body in the file that failed, the one a sequential pass
+    // would have reported
+    std::atomic<usize> first_error = SIZE_MAX;
+    std::vector<usize> error_token(pending_bodies.size());
+
+    auto worker = [&]() {
+        ASTContext::ArenaScope arena(action.ast_context());
+        SymbolTable symbols(&action.symbol_table());
+        Sema sema(action.ast_context(), symbols);
+        Parser parser(*tokens, sema);
+
+        for (usize i; (i = next.fetch_add(1, std::memory_order_relaxed)) < order.size();) {
+            const usize idx = order[i];
+
+            // a later error would not be reported
+            if (idx > first_error.load(std::memory_order_relaxed)) {
+                continue;
+            }
+
+            if (parser.parse_body(pending_bodies[idx])) {
+                continue;
+            }
+
+            error_token[idx] = parser.save_position();
+
+            for (usize prev = first_error.load(); idx < prev && !first_error.compare_exchange_weak(prev, idx);) {}
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+
+    for (unsigned i = 1; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    // a body after the first error may have been parsed meanwhile, its diagnostics are dropped
+    merge_body_diagnostics();
+
+    if (first_error != SIZE_MAX) {
+        restore_position(error_token[first_error]);
+        return false;
+    }
+
+    action.take_pending_references();
+    return true;
+}
 
 /*
  * ParameterDeclaration
@@ -51,15 +420,16 @@ bool Parser::parse_top_level_decl(Decl*& res) {
  */
 ParameterResult Parser::parameter() {
     if (!curr_token.is(tok::Identifier)) {
+        report(diag::ExpectedIdentifier);
         return action_error;
     }
 
-    std::string_view id = curr_token.get_view();
+    IdentifierInfo* id = curr_token.get_identifier_info();
 
     advance();
 
     if (auto ty = type()) {
-        return ParameterResult(std::in_place, id, std::move(ty));
+        return ParameterResult(std::in_place, id, *ty);
     }
     
     return action_error;
@@ -67,7 +437,7 @@ ParameterResult Parser::parameter() {
 
 /*
  * CompoundStmt
- *     : '{' StmtList '}'
+ *     : '{' StmtList[opt] '}'
  *     ;
  * 
  * StmtList
@@ -75,38 +445,63 @@ ParameterResult Parser::parameter() {
  *     : StmtList Stmt
  *     ;
  */
-/*
-CompoundStmt* Parser::compound_statement() {
-    std::unique_ptr<CompoundStmt> compstmt = std::make_unique<CompoundStmt>();
+StmtResult Parser::compound_statement() {
+    if (!nest() || !advance_expected(tok::LeftBrace)) {
+        return action_error;
+    }
 
-    advance_expected(TokenType::LeftBrace);
+    SymbolTable::ScopeGuard block_scope(action.symbol_table(), SymbolTable::BlockScope);
+
+    llvm::SmallVector<Stmt*, 16> stmts;
 
     // statement list
-    while (!curr_token.is_one_of(TokenType::RightBrace)) {
-        compstmt->stmts.push_back(statement());
+    while (!curr_token.is_one_of(tok::RightBrace, tok::EndOfFile)) {
+        StmtResult stmt = statement();
+        return_if_not(stmt);
+
+        stmts.push_back(*stmt);
     }
 
-    advance_expected(TokenType::RightBrace);
+    if (!advance_expected(tok::RightBrace)) {
+        return action_error;
+    }
 
-    return compstmt.release();
+    return action.act_on_compound_stmt(stmts);
 }
-*/
 
 /*
  * ExprStmt
  *     : Expr ';'
  *     ;
  */
+StmtResult Parser::expression_statement() {
+    ExprResult expr = expression();
+
+    if (!expr) {
+        return action_error;
+    }
+
+    if (!advance_expected(tok::Semicolon)) {
+        return action_error;
+    }
+
+    return action.act_on_expr_stmt(*expr);
+}
+
 /*
-ExprStmt* Parser::expression_statement() {
-    std::unique_ptr<ExprStmt> exprstmt = std::make_unique<ExprStmt>();
+ * DeclarationStmt
+ *     : VariableDeclaration
+ *     ;
+ */
+StmtResult Parser::declaration_statement() {
+    DeclResult decl = variable_declaration();
 
-    exprstmt->expr = expression();
-    advance_expected(TokenType::Semicolon);
+    if (!decl) {
+        return action_error;
+    }
 
-    return exprstmt.release();
+    return action.act_on_decl_stmt(*decl);
 }
-*/
 
 /*
  * TypeSpecifier
@@ -120,9 +515,13 @@ TypeResult Parser::type() {
 
     while (true) {
         if (curr_token.is(tok::Void)) {
+            Token t = curr_token;
+
             advance();
 
-            return (QualType)action.ast_context().get_void_ty();
+            builder.finalize(t);
+
+            return builder.release();
         }
         else if (curr_token.is(tok::Identifier)) {
             Token t = curr_token;
@@ -143,7 +542,8 @@ TypeResult Parser::type() {
             builder.add_ptr(is_const);
             // continue to parse compound type
         }
-        else { // TODO: unrecognized token in type
+        else {
+            report(diag::ExpectedType);
             return action_error;
         }
     }
@@ -158,31 +558,84 @@ TypeResult Parser::type() {
  */
 RawTypeResult Parser::raw_type() {
     if (!curr_token.is(tok::Identifier)) {
+        report(diag::ExpectedType);
         return action_error;
     }
 
-    return ;
+    Token t = curr_token;
+
+    advance();
+
+    return action.act_on_raw_type(t);
 }
 
 /*
  * ReturnStmt
  *     : 'return' Expression[opt] ';'
+ *     ;
  */
+StmtResult Parser::return_statement() {
+    Token return_tok = curr_token;
+
+    advance(); // return
+
+    ExprResult expr = action_error;
+
+    if (!curr_token.is(tok::Semicolon)) {
+        expr = expression();
+
+        if (!expr) {
+            return action_error;
+        }
+    }
+
+    if (!advance_expected(tok::Semicolon)) {
+        return action_error;
+    }
+
+    return action.act_on_return_stmt(return_tok, expr ? *expr : nullptr);
+}
+
 /*
-ReturnStmt* Parser::return_statement() {
-    std::unique_ptr<ReturnStmt> retstmt = std::make_unique<ReturnStmt>();
+ * IfStmt
+ *     : 'if' Expression CompoundStatement
+ *     | 'if' Expression CompoundStatement 'else' CompoundStatement
+ *     | 'if' Expression CompoundStatement 'else' IfStmt
+ *     ;
+ */
+StmtResult Parser::if_statement() {
+    if (!nest()) {
+        return action_error;
+    }
+
+    Token if_tok = curr_token;
+
+    advance(); // if
 
-    advance_expected(TokenType::Return);
+    ExprResult cond = expression();
 
-    if (!curr_token.is_one_of(TokenType::Semicolon)) {
-        retstmt->expr = expression();
+    if (!cond) {
+        return action_error;
     }
 
-    advance_expected(TokenType::Semicolon);
+    StmtResult then_stmt = compound_statement();
+
+    if (!then_stmt) {
+        return action_error;
+    }
+
+    StmtResult else_stmt = action_error;
+
+    if (try_advance(tok::Else)) {
+        else_stmt = curr_token.is(tok::If) ? if_statement() : compound_statement();
 
-    return retstmt.release();
+        if (!else_stmt) {
+            return action_error;
+        }
+    }
+
+    return action.act_on_if_stmt(if_tok, *cond, *then_stmt, else_stmt ? *else_stmt : nullptr);
 }
-*/
 
 /*
  * Stmt
@@ -190,31 +643,34 @@ ReturnStmt* Parser::return_statement() {
  *     | DeclarationStatement
  *     | ExprStatement
  *     | ReturnStatement
+ *     | IfStatement
  *     ;
  */
-/*
-Stmt* Parser::statement() {
+StmtResult Parser::statement() {
     switch (curr_token.get_type()) {
-        using enum TokenType;
-    case LeftBrace:
+    case tok::LeftBrace:
         return compound_statement();
-    case Let:
-        return variable_definition_statement();
-    case Fn:
-        return function_definition_statement();
-    case Return:
+    case tok::Let:
+        return declaration_statement();
+    case tok::Return:
         return return_statement();
+    case tok::If:
+        return if_statement();
     default:
         return expression_statement();
     }
 }
-*/
+
 /*
  * Expr
  *     : AssignmentExpr
  *     ;
  */
 ExprResult Parser::expression() {
+    if (!nest()) {
+        return action_error;
+    }
+
     return assignment_expression();
 }
 
@@ -241,7 +697,11 @@ ExprResult Parser::primary_expression() {
         return integer_literal_expression();
     }
     else if (curr_token.is(tok::Identifier)) {
-        // return action.act_on_id_expr(curr_token);
+        Token id = curr_token;
+
+        advance();
+
+        return action.act_on_id_expr(id);
     }
     else if (curr_token.is(tok::LeftParen)) {
         advance();
@@ -250,14 +710,13 @@ ExprResult Parser::primary_expression() {
         return_if_not(expr);
 
         if (!advance_expected(tok::RightParen)) {
-            expr.deletep();
             return action_error;
         }
 
-        // return new ParenExpr(expr);
+        return action.act_on_paren_expr(*expr);
     }
 
-    // TODO: unrecognized token for primary expression
+    report(diag::ExpectedExpression);
     return action_error;
 }
 
@@ -265,13 +724,15 @@ ExprResult Parser::integer_literal_expression() {
     u8 posix = 10;
     switch (curr_token.get_type()) {
         using namespace tok; 
-    case HexIntLiteral: {
+    case HexIntLiteral:
         posix = 16;
         [[fallthrough]];
-    case DecIntLiteral:
+    case DecIntLiteral: {
+        Token literal = curr_token;
+
         advance();
 
-        return action.act_on_int_literal(curr_token, posix, nullptr);
+        return action.act_on_int_literal(literal, posix, nullptr);
     }
     default:
         DELTA_UNREACHABLE("must be a literal expression type token");
@@ -290,20 +751,21 @@ ExprResult Parser::postfix_expression() {
     // CallExpression or IndexExpression
     while (true) {
         if (curr_token.is_one_of(tok::LeftParen)) { // callexpr
-            llvm::SmallVector<Expr*> args;
+            ScratchList<Expr*> args(arg_scratch);
             bool is_valid = parse_list_of(
-                std::back_inserter(args), 
-                bind_this(&Parser::expression),
+                args, 
+                [this] { return expression(); },
                 tok::LeftParen,
                 tok::RightParen
             );
             if (!is_valid) {
-                util::cleanup_ptrs(args.begin(), args.end());
-
-                expr.deletep();
-
+                // the parsed nodes stay in the AST arena
                 return action_error;
             }
+
+            // converted in place, then copied into the arena with the call
+            expr = action.act_on_call_expr(*expr, args.elements());
+            return_if_not(expr);
         } else {
             break;
         }
@@ -321,6 +783,10 @@ ExprResult Parser::postfix_expression() {
  */
 ExprResult Parser::unary_expression() {
     if (auto op = to_unary_operator(curr_token.get_type())) {
+        if (!nest()) {
+            return action_error;
+        }
+
         advance();
 
         auto expr = unary_expression();
@@ -333,46 +799,73 @@ ExprResult Parser::unary_expression() {
     }
 }
 
-// parsed according to precedence
+/*
+ * BinaryExpr
+ *     : UnaryExpr
+ *     | BinaryExpr BinaryOperator UnaryExpr
+ *     ;
+ *
+ * Operator precedence parsing without recursion: the operands and the operators that
+ * still wait for their right operand are kept on two stacks, with precedences strictly
+ * increasing up the operator stack (equal for right associative ones). An operator pops
+ * and builds every operator on the stack that binds tighter before it is pushed.
+ * The operator of a token is a single load from the table built from tokentype.inc.
+ */
 ExprResult Parser::binary_expression() {
-    return recursive_parse_binary_expression(prec::Unknown);
-}
+    ExprResult first = unary_expression();
+    return_if_not(first);
 
-ExprResult Parser::recursive_parse_binary_expression(prec::Binary min_precedence) {
-    ExprResult lhs = unary_expression();
-    return_if_not(lhs);
+    llvm::SmallVector<Expr*, 8> operands = { *first };
+    llvm::SmallVector<const BinaryOperatorInfo*, 8> operators;
 
-    while (true) {
-        auto opt_op = to_binary_operator(curr_token.get_type()); // not a binary operator, binary expression ends
-        if (!opt_op) 
-            break;
+    auto reduce = [&]() -> bool {
+        Expr* rhs = operands.pop_back_val();
+        Expr* lhs = operands.pop_back_val();
+
+        ExprResult expr = action.act_on_binary_expr(lhs, operators.pop_back_val()->op, rhs);
+
+        if (!expr) {
+            return false;
+        }
 
-        prec::Binary cur_op_precedence = get_precedence(opt_op.value());
+        operands.push_back(*expr);
+        return true;
+    };
 
-        if (cur_op_precedence < min_precedence) 
+    while (true) {
+        const BinaryOperatorInfo& info = binary_operator_info(curr_token.get_type());
+
+        // not a binary operator, the binary expression ends
+        if (info.precedence == prec::Unknown) {
             break;
+        }
 
-        advance();
+        while (!operators.empty() && (operators.back()->precedence > info.precedence ||
+               (operators.back()->precedence == info.precedence && info.assoc == Assoc::Left))) {
+            if (!reduce()) {
+                return action_error;
+            }
+        }
 
-        prec::Binary next_min_precedence = (prec::Binary)(cur_op_precedence + 1);
+        operators.push_back(&info);
+        advance();
 
-        ExprResult rhs = recursive_parse_binary_expression(next_min_precedence);
+        ExprResult rhs = unary_expression();
 
         if (!rhs) {
-            // TODO: diag
-            lhs.deletep();
             return action_error;
         }
 
-        lhs = action.act_on_binary_expr(*lhs, *opt_op, *rhs);
+        operands.push_back(*rhs);
+    }
 
-        if (!lhs) {
-            // TODO: diag
-            break;
+    while (!operators.empty()) {
+        if (!reduce()) {
+            return action_error;
         }
     }
 
-    return lhs;
+    return operands.front();
 }
 
 /*
@@ -386,12 +879,16 @@ ExprResult Parser::assignment_expression() {
     return_if_not(lhs);
 
     if (auto op = to_assignment_operator(curr_token.get_type())) {
+        if (!nest()) {
+            return action_error;
+        }
+
+        advance();
+
         if (auto ae = assignment_expression()) {
             return action.act_on_assignment_expr(*lhs, *op, *ae);
         }
         else {
-            lhs.deletep();
-            // TODO: diag invalid expr
             return action_error;
         }
     }
@@ -401,6 +898,7 @@ ExprResult Parser::assignment_expression() {
 
 bool Parser::advance_expected(tok::Kind type) {
     if (!curr_token.is(type)) {
+        report(diag::ExpectedToken, { token_type_name(type) });
         return false;
     }
 
@@ -409,11 +907,60 @@ bool Parser::advance_expected(tok::Kind type) {
 }
 
 bool Parser::try_advance(tok::Kind type) {
-    return advance_expected(type);
+    if (!curr_token.is(type)) {
+        return false;
+    }
+
+    advance();
+    return true;
+}
+
+bool Parser::nest() {
+    if (!stack::is_nearly_exhausted()) {
+        return true;
+    }
+
+    report(diag::NestingTooDeep);
+    return false;
+}
+
+void Parser::report(diag::Kind kind, std::initializer_list<std::string_view> args) {
+    action.diagnostics().report(curr_token.get_location(), kind, args);
 }
 
 void Parser::advance() {
-    lexer.lex(curr_token);
+    if (tokens) {
+        // stays on the EndOfFile token once reached
+        if (token_idx + 1 < tokens->size()) {
+            token_idx++;
+        }
+
+        curr_token = tokens->token(token_idx);
+    }
+    else {
+        lexer->lex(curr_token);
+    }
+}
+
+tok::Kind Parser::peek_kind(usize n) const {
+    DELTA_ASSERT_MSG(tokens, "lookahead requires a token buffer");
+
+    usize idx = std::min(token_idx + n, tokens->size() - 1);
+    return tokens->kind(idx);
+}
+
+usize Parser::save_position() const {
+    DELTA_ASSERT_MSG(tokens, "backtracking requires a token buffer");
+
+    return token_idx;
+}
+
+void Parser::restore_position(usize position) {
+    DELTA_ASSERT_MSG(tokens, "backtracking requires a token buffer");
+    DELTA_ASSERT(position < tokens->size());
+
+    token_idx = position;
+    curr_token = tokens->token(token_idx);
 }
 
 }
@@ -3,57 +3,71 @@
 #include "expression.hpp"
 #include "literal_support.hpp"
 #include "operators.hpp"
+#include "timetrace.hpp"
 #include "tokentype.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+
 namespace deltac {
 
-TypeBuilder::TypeBuilder(Sema& action) : res(action.context.get_void_ty()), base(&res), action(action) {}
+TypeBuilder::TypeBuilder(Sema& action) : res(action.context.get_void_ty()), action(action) {}
 
 bool TypeBuilder::add_ptr(bool constness) {
     assert(!errored);
 
-    res.add_ptr(constness);
+    ptr_layers.push_back(constness);
     return true;
 }
 
 bool TypeBuilder::finalize(const Token& token, bool constness) {
+    TimeTraceScope scope("Build type");
+
     DELTA_ASSERT(!errored);
 
     finalized = true;
 
-    if (token.is(tok::Void)) {
-        base->raw_type(action.context.get_void_ty());
-    }
-
-    Type* ty = action.new_type_from_tok(token);
+    Type* ty = token.is(tok::Void) ? action.context.get_void_ty() : action.new_type_from_tok(token);
 
     if (!ty) {
+        action.diags.report(token.get_location(), diag::UnknownTypeName, { token.get_view() });
         errored = true;
         return false;
     }
 
-    base->raw_type(ty);
-    
+    res = ty;
+
     if (constness) {
-        base->add_const();
+        if (!res.is_mutable()) {
+            action.diags.report(token.get_location(), diag::TypeCannotBeConst, { res.repr() });
+            errored = true;
+            return false;
+        }
+
+        res.add_const();
     }
 
+    wrap_ptr_layers();
+
     return true;
 }
 
 bool TypeBuilder::finalize(llvm::ArrayRef<QualType> param_ty, QualType ret_ty, util::use_move_t) {
+    TimeTraceScope scope("Build type");
+
     DELTA_ASSERT(!errored);
 
     finalized = true;
 
-    Type* ty = action.new_function_ty(param_ty, std::move(ret_ty));
+    Type* ty = action.new_function_ty(param_ty, ret_ty);
     if (!ty) {
         errored = true;
         return false;
     }
 
-    base->raw_type(ty);
+    res = ty;
+
+    wrap_ptr_layers();
 
     return true;
 }
@@ -68,7 +82,9 @@ bool TypeBuilder::reset() {
 
 TypeResult TypeBuilder::release() {
     if (!errored && finalized) {
-        return std::move(res);
+        QualType ret = res;
+        reset_internal();
+        return ret;
     }
 
     reset_internal();
@@ -89,44 +105,61 @@ void TypeBuilder::reset_internal() {
     finalized = false;
     
     res = action.context.get_void_ty();
-    base = &res;
+    ptr_layers.clear();
 }
 
-static Expr* new_lval_cast(Expr* expr) {
-    return new ImplicitCastExpr(expr, expr->type(), CastExpr::LValueToRValue);
+void TypeBuilder::wrap_ptr_layers() {
+    for (auto it = ptr_layers.rbegin(); it != ptr_layers.rend(); ++it) {
+        res = QualType(action.context.get_ptr_type(res), *it ? qual::Const : qual::NoQual);
+    }
 }
 
-static Expr* new_noop_cast(Expr* expr) {
-    return new ExplicitCastExpr(expr, expr->type(), CastExpr::NoOp);
+// the qualification of the object does not carry over to the value read from it
+static Expr* new_lval_cast(const ASTContext& ctx, Expr* expr) {
+    auto* cast = new (ctx) ImplicitCastExpr(expr, QualType::make_no_qual_ty(expr->type()), CastExpr::LValueToRValue);
+
+    cast->set_location(expr->location());
+    return cast;
 }
 
 ExprResult Sema::act_on_int_literal(const Token& tok, u8 posix, QualType* ty) {
+    TimeTraceScope scope("Sema expression");
+
     if (ty != nullptr && !ty->is_integer_ty()) {
-        // error incompatible specified type for int literal
+        diags.report(tok.get_location(), diag::IntLiteralType, { ty->repr() });
         return action_error;
     }
 
-    bool is_unsigned = true;
+    bool is_unsigned = false;
     auto bitwidth = 32u;
 
     if (ty) {
-        is_unsigned = ty->is_signed_ty();
-        bitwidth = (u32)ty->size();
+        is_unsigned = !ty->is_signed_ty();
+        bitwidth = (u32)ty->size() * 8;
     }
 
     IntLiteralParser literal_parser(tok, posix);
     llvm::APSInt val(bitwidth, is_unsigned);
 
-    if (literal_parser.get_apint_val(val)) {
-        // TODO: error overflow
+    // the digits are read as an unsigned number, a signed type has one bit less for it
+    if (literal_parser.get_apint_val(val) || (!is_unsigned && val.isNegative())) {
+        diags.report(tok.get_location(), diag::IntLiteralTooLarge, { ty ? ty->repr() : "i32" });
         return action_error;
     }
 
-    return new IntLiteralExpr(!ty ? context.get_i32_ty() : std::move(*ty), std::move(val));
+    auto* literal = new (context) IntLiteralExpr(!ty ? context.get_i32_ty() : *ty, val);
+
+    // APSInt only owns heap memory for values wider than 64 bits
+    if (val.needsCleanup()) {
+        context.add_cleanup(literal);
+    }
+
+    literal->set_location(tok.get_location());
+    return literal;
 }
 
 ExprResult Sema::act_on_unary_expr(UnaryOp op, Expr* expr) {
-    // TODO: handle error cases
+    TimeTraceScope scope("Sema expression");
 
     /*
      * 1) zero or one conversion from the following set:
@@ -141,77 +174,631 @@ ExprResult Sema::act_on_unary_expr(UnaryOp op, Expr* expr) {
     case UnaryOp::BitwiseNot:
     case UnaryOp::Deref:
         if (expr->is_lval()) {
-            expr = new_lval_cast(expr);
+            expr = new_lval_cast(context, expr);
         }
         break;
     case UnaryOp::AddressOf:
-        if (expr->is_rval()) {
+        if (!expr->is_lval()) {
+            diags.report(expr->location(), diag::AddressOfRValue, { expr->type().repr() });
             return action_error;
         }
         break;
     }
 
-    // lets leave implicit conversion to later...
     /*
-     * 2) zero or one numeric promotion or numeric conversion;
+     * 2) zero or one numeric conversion, integer promotions are left out except for bool
      */
-    /*
-    switch (op) {
-    case UnaryOp::Plus:
-    case UnaryOp::Minus:
-    case UnaryOp::BitwiseNot:
-        if (expr->type().is_integer_ty() && expr->type().size() < 32) {
-            expr = add_integer_promotion(expr);
+    if ((op == UnaryOp::Plus || op == UnaryOp::Minus || op == UnaryOp::BitwiseNot) && expr->type().is_bool_ty()) {
+        expr = add_integer_promotion(expr);
+    }
+    else if (op == UnaryOp::Not) {
+        Expr* converted = convert_implicitly(expr, context.get_bool_ty());
+
+        if (!converted) {
+            diags.report(expr->location(), diag::NotConvertibleToBool, { expr->type().repr() });
+            return action_error;
         }
-        break;
-    case UnaryOp::Not:
-        if (!expr->type().is_bool_ty()) {
-            expr = add_bool_cast(expr);
+
+        expr = converted;
+    }
+
+    // the operand of an arithmetic operator has the type of the result
+    if (op != UnaryOp::Deref && op != UnaryOp::AddressOf) {
+        if (auto value = ConstExprEvaluator::literal_value(expr)) {
+            if (auto folded = evaluator.fold_unary(op, *value, expr->type())) {
+                return new_int_literal(*folded, expr->type(), expr->location());
+            }
         }
-        break;
-    case UnaryOp::Deref:
-    case UnaryOp::AddressOf:
-        break;
     }
-    */
-    
+
     /* 
      * constructs the unary expression 
      */
+    UnaryExpr* res = nullptr;
+
     switch (op) {
     case UnaryOp::Plus:
     case UnaryOp::Minus:
-    case UnaryOp::Not:
     case UnaryOp::BitwiseNot:
-        return new UnaryExpr(expr->type(), Expr::RValue, op, expr);
+        if (!expr->type().is_integer_ty()) {
+            diags.report(expr->location(), diag::InvalidUnaryOperand, { expr->type().repr() });
+            return action_error;
+        }
+
+        res = new (context) UnaryExpr(expr->type(), Expr::RValue, op, expr);
+        break;
+
+    case UnaryOp::Not:
+        res = new (context) UnaryExpr(expr->type(), Expr::RValue, op, expr);
+        break;
 
     case UnaryOp::Deref:
         if (!expr->type().is_ptr_ty()) {
-            // error dereferencing non-pointer type
+            diags.report(expr->location(), diag::DerefNonPointer, { expr->type().repr() });
             return action_error;
         }
-        return new UnaryExpr(QualType::make_remove_ptr_ty(expr->type()), Expr::LValue, op, expr);
+
+        res = new (context) UnaryExpr(QualType::make_remove_ptr_ty(expr->type()), Expr::LValue, op, expr);
+        break;
 
     case UnaryOp::AddressOf:
-        if (expr->is_lval()) {
-            // TODO: error cannot take address of rvalue
+        res = new (context) UnaryExpr(context.get_ptr_type(expr->type()), Expr::RValue, op, expr);
+        break;
+    }
+
+    res->set_location(expr->location());
+    return res;
+}
+
+// the type both integer operands are converted to, the usual arithmetic conversions of C
+// without the promotion to int
+static QualType common_integer_type(QualType lhs, QualType rhs) {
+    if (lhs.size() != rhs.size()) {
+        return lhs.size() > rhs.size() ? lhs : rhs;
+    }
+
+    return lhs.is_unsigned_ty() ? lhs : rhs;
+}
+
+ExprResult Sema::act_on_binary_expr(Expr* lhs, BinaryOp op, Expr* rhs) {
+    TimeTraceScope scope("Sema expression");
+
+    SourceLocation loc = lhs->location();
+
+    // both operands are read
+    if (lhs->is_lval()) {
+        lhs = new_lval_cast(context, lhs);
+    }
+
+    if (rhs->is_lval()) {
+        rhs = new_lval_cast(context, rhs);
+    }
+
+    // bool takes part in arithmetic and comparisons as an integer, as in C
+    if (op != BinaryOp::And && op != BinaryOp::Or) {
+        if (lhs->type().is_bool_ty()) {
+            lhs = add_integer_promotion(lhs);
+        }
+
+        if (rhs->type().is_bool_ty()) {
+            rhs = add_integer_promotion(rhs);
+        }
+    }
+
+    const QualType lhs_ty = lhs->type();
+    const QualType rhs_ty = rhs->type();
+    const bool integer_operands = lhs_ty.is_integer_ty() && rhs_ty.is_integer_ty();
+
+    QualType ty = lhs_ty;
+
+    switch (op) {
+    case BinaryOp::And:
+    case BinaryOp::Or:
+        ty = context.get_bool_ty();
+        lhs = convert_implicitly(lhs, ty);
+        rhs = convert_implicitly(rhs, ty);
+        break;
+
+    case BinaryOp::Equal:
+    case BinaryOp::NotEqual:
+    case BinaryOp::Less:
+    case BinaryOp::Greater:
+    case BinaryOp::LessEqual:
+    case BinaryOp::GreaterEqual:
+        if (integer_operands) {
+            QualType common = common_integer_type(lhs_ty, rhs_ty);
+            lhs = convert_implicitly(lhs, common);
+            rhs = convert_implicitly(rhs, common);
+        }
+        else if (!lhs_ty.noqual_eq(rhs_ty)) {
+            diags.report(loc, diag::InvalidBinaryOperands, { lhs_ty.repr(), rhs_ty.repr() });
             return action_error;
         }
 
-        return new UnaryExpr(QualType::make_ptr_ty(expr->type()), Expr::RValue, op, expr);
+        ty = context.get_bool_ty();
+        break;
+
+    case BinaryOp::LeftShift:
+    case BinaryOp::RightShift:
+        if (!integer_operands) {
+            diags.report(loc, diag::InvalidBinaryOperands, { lhs_ty.repr(), rhs_ty.repr() });
+            return action_error;
+        }
+
+        // the shift amount takes the type of the shifted value
+        rhs = convert_implicitly(rhs, lhs_ty);
+        break;
+
+    default:
+        if (!integer_operands) {
+            diags.report(loc, diag::InvalidBinaryOperands, { lhs_ty.repr(), rhs_ty.repr() });
+            return action_error;
+        }
+
+        ty = common_integer_type(lhs_ty, rhs_ty);
+        lhs = convert_implicitly(lhs, ty);
+        rhs = convert_implicitly(rhs, ty);
+        break;
+    }
+
+    if (!lhs || !rhs) {
+        diags.report(loc, diag::InvalidBinaryOperands, { lhs_ty.repr(), rhs_ty.repr() });
+        return action_error;
+    }
+
+    // constant operands are already literals, so folding never walks the subtrees
+    auto lhs_value = ConstExprEvaluator::literal_value(lhs);
+    auto rhs_value = lhs_value ? ConstExprEvaluator::literal_value(rhs) : std::nullopt;
+
+    if (lhs_value && rhs_value) {
+        if (auto folded = evaluator.fold_binary(op, *lhs_value, *rhs_value, ty)) {
+            return new_int_literal(*folded, ty, loc);
+        }
+    }
+
+    auto* expr = new (context) BinaryExpr(ty, Expr::RValue, lhs, op, rhs);
+
+    expr->set_location(loc);
+    return expr;
+}
+
+ExprResult Sema::act_on_assignment_expr(Expr* lhs, AssignOp op, Expr* rhs) {
+    TimeTraceScope scope("Sema expression");
+
+    if (!lhs->is_lval()) {
+        diags.report(lhs->location(), diag::NotAssignable);
+        return action_error;
+    }
+
+    if (!lhs->type().is_mutable()) {
+        diags.report(lhs->location(), diag::AssignToConst, { lhs->type().repr() });
+        return action_error;
+    }
+
+    if (op != AssignOp::Equal && !lhs->type().is_integer_ty()) {
+        diags.report(lhs->location(), diag::CompoundAssignNonInteger, { lhs->type().repr() });
+        return action_error;
     }
+
+    Expr* converted = convert_operand(rhs, lhs->type());
+
+    if (!converted) {
+        diags.report(rhs->location(), diag::IncompatibleConversion, { rhs->type().repr(), lhs->type().repr() });
+        return action_error;
+    }
+
+    auto* expr = new (context) AssignExpr(lhs, op, converted);
+
+    expr->set_location(lhs->location());
+    return expr;
+}
+
+ExprResult Sema::act_on_paren_expr(Expr* expr) {
+    TimeTraceScope scope("Sema expression");
+
+    auto* paren = new (context) ParenExpr(expr);
+
+    paren->set_location(expr->location());
+    return paren;
+}
+
+ExprResult Sema::act_on_id_expr(const Token& tok) {
+    TimeTraceScope scope("Sema expression");
+
+    DELTA_ASSERT(tok.is(tok::Identifier));
+
+    LookupResult res = symbols->lookup(tok.get_identifier_info());
+    IdExpr* expr = nullptr;
+
+    if (res.is_variable()) {
+        auto* var = util::cast<VarDecl>(res.result_decl());
+        expr = new (context) IdExpr(var->decl_type(), tok.get_identifier_info(), var);
+    }
+    else if (res.is_function()) {
+        // a function designator is not an object, so it cannot be assigned to
+        auto* fn = util::cast<FuncDecl>(res.result_decl());
+        expr = new (context) IdExpr(fn->decl_type(), tok.get_identifier_info(), fn);
+        expr->set_rval();
+
+        if (fn->is_body_pending()) {
+            pending_references.push_back(fn);
+        }
+    }
+    else {
+        diags.report(tok.get_location(), diag::UndeclaredIdentifier, { tok.get_view() });
+        return action_error;
+    }
+
+    expr->set_location(tok.get_location());
+    return expr;
+}
+
+ExprResult Sema::act_on_call_expr(Expr* callee, llvm::MutableArrayRef<Expr*> args) {
+    TimeTraceScope scope("Sema expression");
+
+    if (!callee->type().is_func_ty()) {
+        diags.report(callee->location(), diag::NotAFunction, { callee->type().repr() });
+        return action_error;
+    }
+
+    auto* fn_ty = util::cast<FunctionType>(callee->type().raw_type());
+    llvm::ArrayRef<QualType> param_tys = fn_ty->param_types();
+
+    if (args.size() != param_tys.size()) {
+        diags.report(callee->location(), diag::WrongArgumentCount,
+                     { std::to_string(param_tys.size()), std::to_string(args.size()) });
+        return action_error;
+    }
+
+    for (usize i = 0; i < args.size(); i++) {
+        Expr* converted = convert_operand(args[i], param_tys[i]);
+
+        if (!converted) {
+            diags.report(args[i]->location(), diag::IncompatibleConversion, { args[i]->type().repr(), param_tys[i].repr() });
+            return action_error;
+        }
+
+        args[i] = converted;
+    }
+
+    auto* expr = CallExpr::create(context, fn_ty->return_type(), Expr::RValue, callee, args);
+
+    expr->set_location(callee->location());
+    return expr;
+}
+
+DeclResult Sema::act_on_var_decl(const Token& id_tok, QualType* ty, Expr* init) {
+    TimeTraceScope scope("Sema declaration");
+
+    DELTA_ASSERT(id_tok.is(tok::Identifier));
+
+    if (!ty && !init) {
+        diags.report(id_tok.get_location(), diag::CannotDeduceType, { id_tok.get_view() });
+        return action_error;
+    }
+
+    if (init) {
+        QualType init_ty = ty ? *ty : QualType::make_no_qual_ty(init->type());
+        Expr* converted = convert_operand(init, init_ty);
+
+        if (!converted) {
+            diags.report(init->location(), diag::IncompatibleConversion, { init->type().repr(), init_ty.repr() });
+            return action_error;
+        }
+
+        init = converted;
+    }
+
+    VarDecl* decl = ty ? new (context) VarDecl(id_tok.get_identifier_info(), *ty, init)
+                       : new (context) VarDecl(id_tok.get_identifier_info(), init);
+
+    if (!decl->decl_type().can_be_vardecl_ty()) {
+        diags.report(id_tok.get_location(), diag::IncompleteVariableType, { id_tok.get_view(), decl->decl_type().repr() });
+        return action_error;
+    }
+
+    decl->set_location(id_tok.get_location());
+
+    if (symbols->current_scope_kind() == SymbolTable::GlobalScope) {
+        if (!context.register_toplevel_decl(decl)) {
+            diags.report(id_tok.get_location(), diag::Redefinition, { id_tok.get_view() });
+            return action_error;
+        }
+    }
+    else if (symbols->insert(decl->get_identifier_info(), decl)) {
+        diags.report(id_tok.get_location(), diag::Redefinition, { id_tok.get_view() });
+        return action_error;
+    }
+
+    return decl;
+}
+
+DeclResult Sema::act_on_func_decl(const Token& id_tok, llvm::ArrayRef<Parameter> params, QualType* ret_ty) {
+    TimeTraceScope scope("Sema declaration");
+
+    DELTA_ASSERT(id_tok.is(tok::Identifier));
+
+    if (symbols->current_scope_kind() != SymbolTable::GlobalScope) {
+        diags.report(id_tok.get_location(), diag::NestedFunction);
+        return action_error;
+    }
+
+    llvm::SmallVector<QualType, 4> param_tys;
+
+    for (const Parameter& param : params) {
+        if (!param.type.can_be_vardecl_ty()) {
+            diags.report(id_tok.get_location(), diag::IncompleteParameterType, { param.name->name(), param.type.repr() });
+            return action_error;
+        }
+
+        param_tys.push_back(param.type);
+    }
+
+    QualType fn_ty = new_function_ty(param_tys, ret_ty ? *ret_ty : context.get_void_ty());
+
+    // params is the scratch storage of the parser
+    auto* decl = new (context) FuncDecl(id_tok.get_identifier_info(), fn_ty, context.copy_to_arena(params));
+
+    decl->set_location(id_tok.get_location());
+
+    if (!context.register_toplevel_decl(decl)) {
+        diags.report(id_tok.get_location(), diag::Redefinition, { id_tok.get_view() });
+        return action_error;
+    }
+
+    return decl;
+}
+
+bool Sema::act_on_start_func_body(FuncDecl* fn) {
+    DELTA_ASSERT(symbols->current_scope_kind() == SymbolTable::FunctionScope);
+
+    if (fn->has_body()) {
+        diags.report(fn->location(), diag::FunctionBodyRedefinition, { fn->get_identifier() });
+        return false;
+    }
+
+    llvm::SmallVector<VarDecl*, 4> vars;
+
+    for (const Parameter& param : fn->parameters()) {
+        auto* var = new (context) VarDecl(param.name, param.type);
+
+        var->set_location(fn->location());
+
+        if (symbols->insert(param.name, var)) {
+            diags.report(fn->location(), diag::DuplicateParameter, { param.name->name() });
+            return false;
+        }
+
+        vars.push_back(var);
+    }
+
+    fn->set_param_decls(context.copy_to_arena<VarDecl*>(vars));
+    curr_func = fn;
+
+    return true;
+}
+
+// whether every path through stmt ends with a return, the statements after one are never run
+static bool always_returns(Stmt* stmt) {
+    switch (stmt->stmt_kind()) {
+    case Stmt::ReturnStmtKind:
+        return true;
+
+    case Stmt::CompoundStmtKind: {
+        llvm::ArrayRef<Stmt*> body = util::cast<CompoundStmt>(stmt)->body();
+        return std::any_of(body.begin(), body.end(), always_returns);
+    }
+
+    case Stmt::IfStmtKind: {
+        auto* if_stmt = util::cast<IfStmt>(stmt);
+        return if_stmt->has_else() && always_returns(if_stmt->get_then()) && always_returns(if_stmt->get_else());
+    }
+
+    default:
+        return false;
+    }
+}
+
+DeclResult Sema::act_on_finish_func_body(FuncDecl* fn, Stmt* body) {
+    curr_func = nullptr;
+    fn->set_body_pending(false);
+
+    if (!body) {
+        return action_error;
+    }
+
+    // unlike C, the value of a call that falls off the end is never undefined
+    if (!fn->return_type().is_void_ty() && !always_returns(body)) {
+        diags.report(fn->location(), diag::MissingReturn, { fn->get_identifier() });
+        return action_error;
+    }
+
+    fn->set_body(body);
+    return fn;
+}
+
+DeclResult Sema::act_on_skipped_func_body(FuncDecl* fn) {
+    if (fn->has_body() || fn->is_body_pending()) {
+        diags.report(fn->location(), diag::FunctionBodyRedefinition, { fn->get_identifier() });
+        return action_error;
+    }
+
+    fn->set_body_pending(true);
+    return fn;
+}
+
+StmtResult Sema::act_on_compound_stmt(llvm::ArrayRef<Stmt*> stmts) {
+    return CompoundStmt::create(context, stmts);
+}
+
+StmtResult Sema::act_on_expr_stmt(Expr* expr) {
+    auto* stmt = new (context) ExprStmt(expr);
+
+    stmt->set_location(expr->location());
+    return stmt;
+}
+
+StmtResult Sema::act_on_decl_stmt(Decl* decl) {
+    auto* stmt = new (context) DeclStmt(decl);
+
+    stmt->set_location(decl->location());
+    return stmt;
+}
+
+StmtResult Sema::act_on_return_stmt(const Token& return_tok, Expr* expr) {
+    TimeTraceScope scope("Sema statement");
+
+    if (!curr_func) {
+        diags.report(return_tok.get_location(), diag::ReturnOutsideFunction);
+        return action_error;
+    }
+
+    QualType ret_ty = curr_func->return_type();
+
+    if (expr) {
+        if (ret_ty.is_void_ty()) {
+            diags.report(expr->location(), diag::ReturnValueFromVoid, { curr_func->get_identifier() });
+            return action_error;
+        }
+
+        Expr* converted = convert_operand(expr, ret_ty);
+
+        if (!converted) {
+            diags.report(expr->location(), diag::IncompatibleConversion, { expr->type().repr(), ret_ty.repr() });
+            return action_error;
+        }
+
+        expr = converted;
+    }
+    else if (!ret_ty.is_void_ty()) {
+        diags.report(return_tok.get_location(), diag::MissingReturnValue, { curr_func->get_identifier() });
+        return action_error;
+    }
+
+    auto* stmt = new (context) ReturnStmt(expr);
+
+    stmt->set_location(return_tok.get_location());
+    return stmt;
+}
+
+StmtResult Sema::act_on_if_stmt(const Token& if_tok, Expr* cond, Stmt* then_stmt, Stmt* else_stmt) {
+    TimeTraceScope scope("Sema statement");
+
+    Expr* converted = convert_operand(cond, context.get_bool_ty());
+
+    if (!converted) {
+        diags.report(cond->location(), diag::NotConvertibleToBool, { cond->type().repr() });
+        return action_error;
+    }
+
+    auto* stmt = new (context) IfStmt(converted, then_stmt, else_stmt);
+
+    stmt->set_location(if_tok.get_location());
+    return stmt;
 }
 
 RawTypeResult Sema::act_on_raw_type(const Token& id_token) {
+    TimeTraceScope scope("Sema type");
+
     DELTA_ASSERT(id_token.is(tok::Identifier));
 
+    Type* ty = new_type_from_tok(id_token);
+
+    if (!ty) {
+        diags.report(id_token.get_location(), diag::UnknownTypeName, { id_token.get_view() });
+        return action_error;
+    }
 
+    return ty;
+}
+
+Type* Sema::new_type_from_tok(const Token& token) {
+    if (auto kind = builtin_kind_from_name(token.get_view())) {
+        return context.get_builtin_type(*kind);
+    }
+
+    // TODO: lookup user defined types
+    return nullptr;
+}
+
+Type* Sema::new_function_ty(llvm::ArrayRef<QualType> param_ty, QualType ret_ty) {
+    return context.get_function_type(param_ty, ret_ty);
 }
 
 Expr* Sema::add_integer_promotion(Expr* expr) {
     DELTA_ASSERT(expr->is_rval());
 
-    return new ImplicitCastExpr(expr, context.get_i32_ty(), CastExpr::IntCast);
+    return new_implicit_cast(expr, context.get_i32_ty(), CastExpr::IntCast);
+}
+
+Expr* Sema::convert_implicitly(Expr* expr, QualType ty) {
+    DELTA_ASSERT(expr->is_rval());
+
+    const QualType& from = expr->type();
+    ty = QualType::make_no_qual_ty(ty);
+
+    CastExpr::CastKind kind;
+
+    if (from.noqual_eq(ty)) {
+        return expr;
+    }
+    else if (from.is_integer_ty() && ty.is_integer_ty()) {
+        kind = CastExpr::IntCast;
+    }
+    else if (from.is_bool_ty() && ty.is_integer_ty()) {
+        kind = CastExpr::IntCast;
+    }
+    else if (from.is_integer_ty() && ty.is_bool_ty()) {
+        kind = CastExpr::IntToBool;
+    }
+    else if (from.is_ptr_ty() && ty.is_bool_ty()) {
+        kind = CastExpr::PtrToBool;
+    }
+    else {
+        return nullptr;
+    }
+
+    return new_implicit_cast(expr, ty, kind);
+}
+
+Expr* Sema::new_implicit_cast(Expr* expr, QualType ty, CastExpr::CastKind kind) {
+    if (auto value = ConstExprEvaluator::literal_value(expr)) {
+        if (auto folded = evaluator.fold_cast(kind, *value, ty)) {
+            return new_int_literal(*folded, ty, expr->location());
+        }
+    }
+
+    auto* cast = new (context) ImplicitCastExpr(expr, ty, kind);
+
+    cast->set_location(expr->location());
+    return cast;
+}
+
+Expr* Sema::new_int_literal(const ConstInt& value, QualType ty, SourceLocation loc) {
+    if (evaluator.has_overflowed()) {
+        diags.report(loc, diag::ConstantOverflow, { ty.repr() });
+        evaluator.reset_overflow();
+    }
+
+    llvm::APSInt data = value.to_apsint();
+    const bool needs_cleanup = data.needsCleanup();
+
+    auto* literal = new (context) IntLiteralExpr(std::move(ty), std::move(data), !value.is_signed());
+
+    if (needs_cleanup) {
+        context.add_cleanup(literal);
+    }
+
+    literal->set_location(loc);
+    return literal;
+}
+
+Expr* Sema::convert_operand(Expr* expr, QualType ty) {
+    if (expr->is_lval()) {
+        expr = new_lval_cast(context, expr);
+    }
+
+    return convert_implicitly(expr, ty);
 }
 
 } // namespace deltac
@@ -0,0 +1,100 @@
+#include "sourcemanager.hpp"
+#include "charscan.hpp"
+#include "filebuffer.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace deltac {
+
+SourceManager::FileID SourceManager::add_buffer(const SourceBuffer& buffer) {
+    return add_buffer(buffer.ptr_cbegin(), buffer.size(), buffer.name());
+}
+
+SourceManager::FileID SourceManager::add_buffer(const char* begin, usize size, std::string name) {
+    // one extra location for the end of the buffer
+    if (size + 1 > (usize)(std::numeric_limits<u32>::max() - next_base)) {
+        // TODO: Error sources too large for 32-bit locations
+        return INVALID_FILE;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->start = begin;
+    entry->size = (u32)size;
+    entry->base = next_base;
+    entry->name = std::move(name);
+
+    next_base += (u32)size + 1;
+    entries.push_back(std::move(entry));
+
+    return (FileID)(entries.size() - 1);
+}
+
+SourceLocation SourceManager::location(FileID fid, const char* ptr) const {
+    const Entry& entry = *entries[fid];
+
+    DELTA_ASSERT(ptr >= entry.start && ptr <= entry.start + entry.size);
+
+    return SourceLocation::from_raw(entry.base + (u32)(ptr - entry.start));
+}
+
+SourceManager::FileID SourceManager::file_id(SourceLocation loc) const {
+    if (!loc.is_valid()) {
+        return INVALID_FILE;
+    }
+
+    // the last buffer starting at or before loc
+    auto it = std::upper_bound(entries.begin(), entries.end(), loc.raw(),
+        [](u32 raw, const std::unique_ptr<Entry>& e) { return raw < e->base; });
+
+    DELTA_ASSERT(it != entries.begin());
+
+    return (FileID)(it - entries.begin() - 1);
+}
+
+const char* SourceManager::character_data(SourceLocation loc) const {
+    const Entry& entry = *entries[file_id(loc)];
+
+    return entry.start + (loc.raw() - entry.base);
+}
+
+PresumedLoc SourceManager::presumed_loc(SourceLocation loc) const {
+    const Entry& entry = *entries[file_id(loc)];
+    const std::vector<u32>& lines = line_table(entry);
+
+    u32 offset = loc.raw() - entry.base;
+
+    // the line starting at or before offset
+    auto it = std::upper_bound(lines.begin(), lines.end(), offset);
+    u32 line = (u32)(it - lines.begin());
+
+    return { entry.name, line, offset - lines[line - 1] + 1 };
+}
+
+std::string SourceManager::format_location(SourceLocation loc) const {
+    if (!loc.is_valid()) {
+        return "<unknown>";
+    }
+
+    PresumedLoc p = presumed_loc(loc);
+
+    return std::string(p.file) + ":" + std::to_string(p.line) + ":" + std::to_string(p.column);
+}
+
+const std::vector<u32>& SourceManager::line_table(const Entry& entry) const {
+    std::call_once(entry.lines_built, [&entry] {
+        const char* ptr = entry.start;
+        const char* end = entry.start + entry.size;
+
+        entry.line_starts.push_back(0);
+
+        while ((ptr = find_first_of(ptr, end, '\n', '\n')) != end) {
+            ptr++;
+            entry.line_starts.push_back((u32)(ptr - entry.start));
+        }
+    });
+
+    return entry.line_starts;
+}
+
+}
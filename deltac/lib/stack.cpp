@@ -0,0 +1,44 @@
+#include "stack.hpp"
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+namespace deltac::stack {
+
+// stacks grow down on every target deltac supports
+// the lowest address a level may start at
+static std::uintptr_t find_limit() {
+#if defined(__linux__)
+    pthread_attr_t attr;
+
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void* low = nullptr;
+        size_t size = 0;
+        size_t guard = 0;
+
+        pthread_attr_getstack(&attr, &low, &size);
+        pthread_attr_getguardsize(&attr, &guard);
+        pthread_attr_destroy(&attr);
+
+        if (low) {
+            return (std::uintptr_t)low + guard + RESERVE;
+        }
+    }
+#endif
+
+    // the bounds are unknown, assumes the smallest default stack in use, 512 KiB,
+    // and that the first check on the thread is made close to its top
+    return (std::uintptr_t)__builtin_frame_address(0) - (usize(512) << 10) + RESERVE;
+}
+
+bool is_nearly_exhausted() {
+    // pthread_getattr_np reads /proc/self/maps for the main thread, so once per thread
+    thread_local const std::uintptr_t limit = find_limit();
+
+    return (std::uintptr_t)__builtin_frame_address(0) < limit;
+}
+
+}
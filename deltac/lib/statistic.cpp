@@ -0,0 +1,140 @@
+#include "statistic.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace deltac {
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<StatisticBase*> statistics;
+};
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+// sorted copy, so printing does not hold the lock while formatting
+std::vector<StatisticBase*> sorted_statistics() {
+    Registry& r = registry();
+    std::vector<StatisticBase*> ret;
+
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        ret = r.statistics;
+    }
+
+    std::sort(ret.begin(), ret.end(), [](const StatisticBase* lhs, const StatisticBase* rhs) {
+        if (lhs->get_group() != rhs->get_group()) {
+            return lhs->get_group() < rhs->get_group();
+        }
+
+        return lhs->get_name() < rhs->get_name();
+    });
+
+    return ret;
+}
+
+} // namespace
+
+void StatisticBase::register_statistic() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    // another thread may have won the race
+    if (registered.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    r.statistics.push_back(this);
+    registered.store(true, std::memory_order_release);
+}
+
+namespace stats {
+
+std::atomic<bool> detail::enabled = false;
+
+void enable(bool on) {
+    detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+void reset() {
+    for (StatisticBase* stat : sorted_statistics()) {
+        stat->reset();
+    }
+}
+
+void print(std::ostream& os) {
+    std::vector<StatisticBase*> statistics = sorted_statistics();
+
+    // values and groups are right and left aligned in their own columns
+    usize value_width = 1;
+    usize group_width = 1;
+
+    for (const StatisticBase* stat : statistics) {
+        group_width = std::max(group_width, stat->get_group().size());
+
+        for (usize i = 0; i < stat->size(); i++) {
+            value_width = std::max(value_width, std::to_string(stat->value(i)).size());
+        }
+    }
+
+    os << "===" << std::string(73, '-') << "===\n"
+       << std::string(26, ' ') << "... Statistics Collected ...\n"
+       << "===" << std::string(73, '-') << "===\n\n";
+
+    for (const StatisticBase* stat : statistics) {
+        for (usize i = 0; i < stat->size(); i++) {
+            // per kind counters only list the kinds that occurred
+            if (stat->size() > 1 && stat->value(i) == 0) {
+                continue;
+            }
+
+            os << std::setw((int)value_width) << std::right << stat->value(i) << ' '
+               << std::setw((int)group_width) << std::left << stat->get_group() << " - " << stat->get_desc();
+
+            if (!stat->label(i).empty()) {
+                os << " [" << stat->label(i) << "]";
+            }
+
+            os << '\n';
+        }
+    }
+
+    os << std::flush;
+}
+
+void print_json(std::ostream& os) {
+    bool first = true;
+
+    os << "{";
+
+    for (const StatisticBase* stat : sorted_statistics()) {
+        for (usize i = 0; i < stat->size(); i++) {
+            if (stat->size() > 1 && stat->value(i) == 0) {
+                continue;
+            }
+
+            os << (first ? "\n" : ",\n") << "\t\"" << stat->get_group() << '.' << stat->get_name();
+
+            if (!stat->label(i).empty()) {
+                os << '.' << stat->label(i);
+            }
+
+            os << "\": " << stat->value(i);
+            first = false;
+        }
+    }
+
+    os << "\n}\n" << std::flush;
+}
+
+} // namespace stats
+
+}
@@ -0,0 +1,187 @@
+#include "symboltable.hpp"
+#include "statistic.hpp"
+
+namespace deltac {
+
+static constexpr usize INITIAL_CAPACITY = 64;
+
+static std::string_view probe_length_label(usize bucket) {
+    static constexpr std::string_view LABELS[] = { "1", "2", "3", "4", "5-8", "9-16", "17+" };
+    return LABELS[bucket];
+}
+
+DELTAC_STATISTIC(NumSymbolLookups, "symbols", "Number of symbol table lookups and insertions");
+DELTAC_STATISTIC(NumSymbolProbes, "symbols", "Number of symbol table slots probed");
+DELTAC_STATISTIC_ARRAY(NumSymbolProbeLengths, "symbols", "Number of symbol table lookups by probe length", 7,
+                       probe_length_label);
+
+static void count_lookup(u32 probe_length) {
+    if (!stats::is_enabled()) {
+        return;
+    }
+
+    ++NumSymbolLookups;
+    NumSymbolProbes += probe_length;
+
+    usize bucket = probe_length <= 4 ? probe_length - 1
+                 : probe_length <= 8 ? 4
+                 : probe_length <= 16 ? 5
+                 : 6;
+
+    NumSymbolProbeLengths.add(bucket);
+}
+
+SymbolTable::SymbolTable() : slots(INITIAL_CAPACITY) {
+    scopes.push_back({ GlobalScope, 0 });
+}
+
+SymbolTable::SymbolTable(const SymbolTable* globals) : SymbolTable() {
+    this->globals = globals;
+}
+
+void SymbolTable::push_scope(ScopeKind kind) {
+    DELTA_ASSERT(kind != GlobalScope);
+
+    scopes.push_back({ kind, (u32)bindings.size() });
+}
+
+void SymbolTable::pop_scope() {
+    DELTA_ASSERT_MSG(scopes.size() > 1, "cannot pop the global scope");
+
+    u32 mark = scopes.back().first_binding;
+
+    while (bindings.size() > mark) {
+        const Binding& b = bindings.back();
+        slots[b.slot].binding = b.shadowed;
+        bindings.pop_back();
+    }
+
+    scopes.pop_back();
+}
+
+NamedDecl* SymbolTable::insert(const IdentifierInfo* name, NamedDecl* decl) {
+    DELTA_ASSERT(name != nullptr && decl != nullptr);
+
+    // keep the load factor at most 1/2
+    if ((num_names + 1) * 2 > slots.size()) {
+        grow();
+    }
+
+    u32 idx = find_slot(name);
+    Slot& slot = slots[idx];
+
+    if (slot.name == nullptr) {
+        slot.name = name;
+        num_names++;
+    }
+    else if (slot.binding != NO_BINDING && bindings[slot.binding].scope == scopes.size() - 1) {
+        return bindings[slot.binding].decl;
+    }
+
+    bindings.push_back({ decl, slot.binding, idx, (u32)(scopes.size() - 1) });
+    slot.binding = (i32)(bindings.size() - 1);
+
+    return nullptr;
+}
+
+NamedDecl* SymbolTable::lookup(const IdentifierInfo* name) const {
+    const Slot& slot = slots[find_slot(name)];
+
+    if (slot.binding == NO_BINDING) {
+        if (!globals) {
+            return nullptr;
+        }
+
+        u32 length = 0;
+        NamedDecl* decl = globals->lookup_global(name, visible_globals, length);
+
+        probes += length;
+        count_lookup(length);
+
+        return decl;
+    }
+
+    const Binding& binding = bindings[slot.binding];
+
+    // a global has no other binding in the global scope to fall back to
+    if (binding.scope == 0 && (usize)slot.binding >= visible_globals) {
+        return nullptr;
+    }
+
+    return binding.decl;
+}
+
+NamedDecl* SymbolTable::lookup_global(const IdentifierInfo* name, usize count, u32& length) const {
+    const Slot& slot = slots[probe(name, length)];
+
+    if (slot.binding == NO_BINDING || (usize)slot.binding >= count) {
+        return nullptr;
+    }
+
+    DELTA_ASSERT(bindings[slot.binding].scope == 0);
+    return bindings[slot.binding].decl;
+}
+
+NamedDecl* SymbolTable::lookup_in_current_scope(const IdentifierInfo* name) const {
+    const Slot& slot = slots[find_slot(name)];
+
+    if (slot.binding == NO_BINDING || bindings[slot.binding].scope != scopes.size() - 1) {
+        return nullptr;
+    }
+
+    return bindings[slot.binding].decl;
+}
+
+u32 SymbolTable::find_slot(const IdentifierInfo* name) const {
+    u32 length = 0;
+    u32 idx = probe(name, length);
+
+    lookups++;
+    probes += length;
+    count_lookup(length);
+
+    return idx;
+}
+
+u32 SymbolTable::probe(const IdentifierInfo* name, u32& length) const {
+    usize mask = slots.size() - 1;
+    usize idx = name->hash() & mask;
+
+    for (length = 1; ; length++) {
+        const Slot& slot = slots[idx];
+
+        if (slot.name == nullptr || slot.name == name) {
+            return (u32)idx;
+        }
+
+        idx = (idx + 1) & mask;
+    }
+}
+
+void SymbolTable::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, Slot());
+
+    usize mask = slots.size() - 1;
+
+    for (const Slot& slot : old) {
+        if (slot.name == nullptr) {
+            continue;
+        }
+
+        usize idx = slot.name->hash() & mask;
+
+        while (slots[idx].name != nullptr) {
+            idx = (idx + 1) & mask;
+        }
+
+        slots[idx] = slot;
+
+        // every live binding of the name is on the shadow chain of the slot
+        for (i32 b = slot.binding; b != NO_BINDING; b = bindings[b].shadowed) {
+            bindings[b].slot = (u32)idx;
+        }
+    }
+}
+
+}
@@ -0,0 +1,266 @@
+#include "timetrace.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace deltac::timetrace {
+
+namespace detail {
+
+std::atomic<bool> enabled = false;
+
+}
+
+namespace {
+
+using detail::Clock;
+
+struct Event {
+    std::string_view name;
+    std::string detail;
+    // microseconds since the trace started
+    u64 start;
+    u64 duration;
+};
+
+// short scopes such as the Sema actions only add up in nanoseconds
+struct Total {
+    u64 count = 0;
+    u64 duration_ns = 0;
+};
+
+// events of one thread, only touched by that thread until the trace is written
+struct ThreadTrace {
+    u32 tid;
+    std::vector<Event> events;
+    // names of the open scopes, innermost last
+    std::vector<std::string_view> open;
+    std::unordered_map<std::string_view, Total> totals;
+};
+
+struct Profiler {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadTrace>> threads;
+    // bumped by initialize and cleanup so threads drop their stale ThreadTrace
+    std::atomic<u64> generation = 0;
+
+    Clock::time_point start;
+    std::chrono::system_clock::time_point wall_start;
+    u64 granularity_us = 0;
+    std::string process_name;
+};
+
+Profiler& profiler() {
+    static Profiler p;
+    return p;
+}
+
+thread_local ThreadTrace* thread_trace = nullptr;
+thread_local u64 thread_generation = 0;
+
+ThreadTrace& current_thread() {
+    Profiler& p = profiler();
+
+    if (thread_trace != nullptr && thread_generation == p.generation.load(std::memory_order_acquire)) {
+        return *thread_trace;
+    }
+
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    p.threads.push_back(std::make_unique<ThreadTrace>());
+    p.threads.back()->tid = (u32)p.threads.size();
+
+    thread_trace = p.threads.back().get();
+    thread_generation = p.generation.load(std::memory_order_relaxed);
+
+    return *thread_trace;
+}
+
+u64 to_us(Clock::duration d) {
+    return (u64)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+void write_escaped(std::ostream& os, std::string_view s) {
+    static constexpr char HEX[] = "0123456789abcdef";
+
+    os << '"';
+
+    for (char c : s) {
+        switch (c) {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        case '\n':
+            os << "\\n";
+            break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                os << "\\u00" << HEX[(c >> 4) & 0xf] << HEX[c & 0xf];
+            }
+            else {
+                os << c;
+            }
+            break;
+        }
+    }
+
+    os << '"';
+}
+
+} // namespace
+
+void initialize(unsigned granularity_us, std::string_view process_name) {
+    Profiler& p = profiler();
+
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+
+        p.threads.clear();
+        p.generation++;
+        p.start = Clock::now();
+        p.wall_start = std::chrono::system_clock::now();
+        p.granularity_us = granularity_us;
+        p.process_name = process_name;
+    }
+
+    detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void cleanup() {
+    Profiler& p = profiler();
+
+    detail::enabled.store(false, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    p.threads.clear();
+    p.generation++;
+}
+
+bool is_enabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+void detail::begin_event(std::string_view name) {
+    current_thread().open.push_back(name);
+}
+
+void detail::end_event(std::string_view name, std::string_view detail, Clock::time_point start) {
+    Clock::time_point end = Clock::now();
+    ThreadTrace& thread = current_thread();
+
+    // the trace was restarted while the scope was open
+    if (thread.open.empty()) {
+        return;
+    }
+
+    thread.open.pop_back();
+
+    Profiler& p = profiler();
+    u64 duration = to_us(end - start);
+
+    // recursive scopes of the same phase count once
+    if (std::find(thread.open.begin(), thread.open.end(), name) == thread.open.end()) {
+        Total& total = thread.totals[name];
+        total.count++;
+        total.duration_ns += (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+
+    if (duration < p.granularity_us) {
+        return;
+    }
+
+    thread.events.push_back({ name, std::string(detail), to_us(start - p.start), duration });
+}
+
+void write(std::ostream& os) {
+    Profiler& p = profiler();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    bool first = true;
+
+    auto begin_object = [&]() {
+        os << (first ? "\n" : ",\n") << "{\"pid\":1,";
+        first = false;
+    };
+
+    os << "{\"traceEvents\":[";
+
+    std::unordered_map<std::string_view, Total> totals;
+
+    for (const auto& thread : p.threads) {
+        for (const Event& e : thread->events) {
+            begin_object();
+            os << "\"tid\":" << thread->tid << ",\"ph\":\"X\",\"ts\":" << e.start << ",\"dur\":" << e.duration
+               << ",\"name\":";
+            write_escaped(os, e.name);
+
+            if (!e.detail.empty()) {
+                os << ",\"args\":{\"detail\":";
+                write_escaped(os, e.detail);
+                os << "}";
+            }
+
+            os << "}";
+        }
+
+        for (const auto& [name, total] : thread->totals) {
+            Total& sum = totals[name];
+            sum.count += total.count;
+            sum.duration_ns += total.duration_ns;
+        }
+
+        begin_object();
+        os << "\"tid\":" << thread->tid << ",\"ph\":\"M\",\"name\":\"thread_name\",\"args\":{\"name\":";
+        write_escaped(os, "thread " + std::to_string(thread->tid));
+        os << "}}";
+    }
+
+    // summaries on their own track, longest first
+    std::vector<std::pair<std::string_view, Total>> sorted(totals.begin(), totals.end());
+
+    std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second.duration_ns > rhs.second.duration_ns;
+    });
+
+    for (const auto& [name, total] : sorted) {
+        begin_object();
+        os << "\"tid\":0,\"ph\":\"X\",\"ts\":0,\"dur\":" << total.duration_ns / 1000 << ",\"name\":";
+        write_escaped(os, "Total " + std::string(name));
+        os << ",\"args\":{\"count\":" << total.count
+           << ",\"avg ns\":" << total.duration_ns / std::max<u64>(total.count, 1) << "}}";
+    }
+
+    begin_object();
+    os << "\"tid\":0,\"ph\":\"M\",\"name\":\"thread_name\",\"args\":{\"name\":\"Totals\"}}";
+
+    begin_object();
+    os << "\"tid\":0,\"ph\":\"M\",\"name\":\"process_name\",\"args\":{\"name\":";
+    write_escaped(os, p.process_name);
+    os << "}}";
+
+    auto wall_us = std::chrono::duration_cast<std::chrono::microseconds>(p.wall_start.time_since_epoch());
+
+    os << "\n],\n\"beginningOfTime\":" << wall_us.count() << "}\n";
+}
+
+bool write(const std::string& path) {
+    std::ofstream ofs(path);
+
+    if (!ofs.is_open()) {
+        return false;
+    }
+
+    write(ofs);
+
+    return ofs.good();
+}
+
+}
@@ -0,0 +1,32 @@
+#include "tokenbuffer.hpp"
+
+namespace deltac {
+
+void TokenBuffer::reset(const char* src, IdentifierTable* idents, SourceLocation loc) {
+    source = src;
+    identifiers = idents;
+    start = loc;
+
+    kinds.clear();
+    offsets.clear();
+    lengths.clear();
+    ident_ids.clear();
+}
+
+void TokenBuffer::reserve(usize count) {
+    kinds.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    ident_ids.reserve(count);
+}
+
+void TokenBuffer::append(const TokenBuffer& other) {
+    DELTA_ASSERT(source == other.source);
+
+    kinds.insert(kinds.end(), other.kinds.begin(), other.kinds.end());
+    offsets.insert(offsets.end(), other.offsets.begin(), other.offsets.end());
+    lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+    ident_ids.insert(ident_ids.end(), other.ident_ids.begin(), other.ident_ids.end());
+}
+
+}
@@ -0,0 +1,13 @@
+#include "driver.hpp"
+
+#include <iostream>
+
+int main(int argc, char** argv) {
+    auto options = deltac::Driver::parse_args(argc, argv, std::cerr);
+
+    if (!options) {
+        return 1;
+    }
+
+    return deltac::Driver(std::move(*options)).run(std::cerr);
+}
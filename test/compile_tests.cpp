@@ -0,0 +1,649 @@
+#include "astcontext.hpp"
+#include "codegen.hpp"
+#include "constexpr_evaluator.hpp"
+#include "driver.hpp"
+
+#include <gtest/gtest.h>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace deltac;
+
+// the file of the program in the temporary directory, named after the test
+static std::string write_source(std::string_view source) {
+    const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    std::string name = std::string(info->test_suite_name()) + "_" + info->name() + ".dl";
+
+    for (char& c : name) {
+        if (c == '/') {
+            c = '_';
+        }
+    }
+
+    std::string path = (std::filesystem::path(::testing::TempDir()) / name).string();
+    std::ofstream(path) << source;
+    return path;
+}
+
+// args are passed to main after the file name
+static CompileResult compile(const std::string& path, OutputKind kind, unsigned opt_level,
+                             std::string output_path = "", const std::vector<std::string>& args = {}) {
+    DriverOptions options;
+    options.inputs = { path };
+    options.output_kind = kind;
+    options.opt_level = opt_level;
+    options.output_path = std::move(output_path);
+
+    if (runs_main(kind)) {
+        options.program_args = { path };
+        options.program_args.insert(options.program_args.end(), args.begin(), args.end());
+    }
+
+    return Driver::compile_file(path, options, 1);
+}
+
+class CompileTest : public ::testing::TestWithParam<unsigned> {
+protected:
+    static void SetUpTestSuite() {
+        ASSERT_TRUE(CodeGen::initialize_native_target());
+    }
+
+    // at the optimization level of the test
+    static CompileResult compile(const std::string& path, OutputKind kind, std::string output_path = "",
+                                 const std::vector<std::string>& args = {}) {
+        return ::compile(path, kind, GetParam(), std::move(output_path), args);
+    }
+
+    // main is run with the JIT, its output is returned in out
+    static CompileResult run(const std::string& path, std::string& out, const std::vector<std::string>& args = {}) {
+        ::testing::internal::CaptureStdout();
+        CompileResult result = compile(path, OutputKind::Run, "", args);
+        std::fflush(stdout);
+        out = ::testing::internal::GetCapturedStdout();
+        return result;
+    }
+};
+
+TEST_P(CompileTest, RunsFib) {
+    std::string out;
+    CompileResult result = run("fib.dl", out);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(out, "6765\n");
+}
+
+TEST_P(CompileTest, EmitsFib) {
+    std::string object = (std::filesystem::path(::testing::TempDir()) / "fib.o").string();
+    std::filesystem::remove(object);
+
+    CompileResult result = compile("fib.dl", OutputKind::Object, object);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_GT(std::filesystem::file_size(object), 0u);
+}
+
+TEST_P(CompileTest, SignedAndUnsignedArithmetic) {
+    // every check calls a function, so -O0 does the arithmetic at run time
+    std::string path = write_source(R"(
+        fn div(a i32, b i32) i32 { return a / b; }
+        fn rem(a i32, b i32) i32 { return a % b; }
+        fn udiv(a u32, b u32) u32 { return a / b; }
+        fn urem(a u32, b u32) u32 { return a % b; }
+        fn shr(a i32, n i32) i32 { return a >> n; }
+        fn ushr(a u32, n u32) u32 { return a >> n; }
+        fn mul(a i64, b i64) i64 { return a * b; }
+        fn narrow(a i32) u8 { return a; }
+
+        fn main() i32 {
+            if div(-7, 2) != -3 { return 1; }
+            if rem(-7, 2) != -1 { return 2; }
+            if udiv(0 - 1, 2) != 2147483647 { return 3; }
+            if urem(0 - 1, 10) != 5 { return 4; }
+            if shr(-16, 2) != -4 { return 5; }
+            if ushr(0 - 16, 28) != 15 { return 6; }
+            if mul(100000, 100000) != mul(1000, 10000000) { return 7; }
+            if narrow(300) != 44 { return 8; }
+            return 0;
+        }
+    )");
+
+    std::string out;
+    CompileResult result = run(path, out);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_EQ(result.exit_code, 0);
+}
+
+TEST_P(CompileTest, BitwiseLogicalAndCompoundAssignment) {
+    std::string path = write_source(R"(
+        let calls i32 = 0;
+
+        fn count(b i32) bool {
+            calls += 1;
+            return b != 0;
+        }
+
+        fn mix(a i32, b i32) i32 {
+            let x = a;
+            x ^= b;
+            x <<= 2;
+            x |= 1;
+            x &= 0xff;
+            return x - (a & b) + (a | b);
+        }
+
+        fn main() i32 {
+            // the right operand is only evaluated when it decides
+            if count(0) && count(1) { return 100; }
+            if !(count(1) || count(1)) { return 101; }
+
+            return mix(12, 10) * 10 + calls;
+        }
+    )");
+
+    std::string out;
+    CompileResult result = run(path, out);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    // ((12 ^ 10) << 2 | 1) & 0xff = 25, 25 - 8 + 14 = 31, and two calls of count
+    EXPECT_EQ(result.exit_code, 312);
+}
+
+TEST_P(CompileTest, ReportsMissingReturn) {
+    std::string path = write_source(R"(
+        fn f(a i32) i32 {
+            if a > 0 {
+                return 1;
+            }
+        }
+    )");
+
+    CompileResult result = compile(path, OutputKind::Object, path + ".o");
+
+    EXPECT_FALSE(result.success);
+    EXPECT_NE(result.diagnostics.find("2:12: error: non-void function 'f' does not return a value on every path"),
+              std::string::npos) << result.diagnostics;
+}
+
+TEST_P(CompileTest, JITPassesArgumentsToMain) {
+    std::string path = write_source(R"(
+        fn main(argc i32, argv **u8) i32 {
+            return argc * 1000 + **argv;
+        }
+    )");
+
+    std::string out;
+    CompileResult result = run(path, out, { "first", "second" });
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    // argv[0] is the file name
+    EXPECT_EQ(result.exit_code, 3000 + path.front());
+}
+
+TEST_P(CompileTest, JITRunsVoidMain) {
+    std::string path = write_source(R"(
+        fn putchar(c i32) i32;
+
+        fn main() {
+            putchar(65);
+        }
+    )");
+
+    std::string out;
+    CompileResult result = run(path, out);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(out, "A");
+}
+
+TEST_P(CompileTest, JITInitializesGlobalsBeforeMain) {
+    std::string path = write_source(R"(
+        fn seven() i32 { return 7; }
+
+        let base i32 = seven();
+        let twice i32 = base * 2;
+
+        fn main() i32 {
+            return twice;
+        }
+    )");
+
+    std::string out;
+    CompileResult result = run(path, out);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_EQ(result.exit_code, 14);
+}
+
+TEST_P(CompileTest, JITNeverResolvesUncalledFunctions) {
+    std::string path = write_source(R"(
+        fn no_such_function() i32;
+
+        fn unused() i32 {
+            return no_such_function();
+        }
+
+        fn main() i32 {
+            return 5;
+        }
+    )");
+
+    std::string out;
+    CompileResult result = run(path, out);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_EQ(result.exit_code, 5);
+}
+
+TEST_P(CompileTest, JITReportsMissingMain) {
+    std::string path = write_source("fn f() i32 { return 0; }\n");
+
+    std::string out;
+    CompileResult result = run(path, out);
+
+    EXPECT_FALSE(result.success);
+    EXPECT_NE(result.diagnostics.find("no definition of 'main'"), std::string::npos) << result.diagnostics;
+}
+
+TEST_P(CompileTest, RunAndInterpretAgree) {
+    // constants are folded, the same expressions on variables are not
+    std::string path = write_source(R"(
+        fn putchar(c i32) i32;
+
+        fn print(n i64) {
+            if n < 0 {
+                putchar(45);
+                n = -n;
+            }
+
+            if n >= 10 {
+                print(n / 10);
+            }
+
+            putchar(48 + n % 10);
+            putchar(32);
+        }
+
+        fn main() i32 {
+            let seven = 7;
+            let big u32 = 2000000000;
+            let small i8 = 100;
+
+            print(-7 / 2 + -7 % 2 * 10);
+            print(-seven / 2 + -seven % 2 * 10);
+            big *= 2;
+            print(2000000000 * 2 / 3);
+            print(big / 3 + big % 7);
+            print(100 + 100);
+            print(small + small);
+            small += 100;
+            print(small);
+            print(2147483647 + 1);
+            print((1 << 31) >> 3);
+            print((seven << 29) >> 3);
+            print(~seven ^ 0x55);
+            putchar(10);
+
+            return seven * 3 + small;
+        }
+    )");
+
+    for (const std::string& file : { std::string("fib.dl"), path }) {
+        std::string jit_out;
+        CompileResult jit = run(file, jit_out);
+
+        ::testing::internal::CaptureStdout();
+        CompileResult interpreted = compile(file, OutputKind::Interpret);
+        std::fflush(stdout);
+        std::string interpreted_out = ::testing::internal::GetCapturedStdout();
+
+        ASSERT_TRUE(jit.success) << jit.diagnostics;
+        ASSERT_TRUE(interpreted.success) << interpreted.diagnostics;
+        EXPECT_EQ(jit_out, interpreted_out) << file;
+        EXPECT_EQ(jit.exit_code, interpreted.exit_code) << file;
+        EXPECT_EQ(jit.diagnostics, interpreted.diagnostics) << file;
+    }
+}
+
+TEST_P(CompileTest, CallsWithNoAndManyArgumentsAndBlocksOfAnySize) {
+    // wide weighs each argument by its position, so the order of the arguments matters
+    const int many = 40;
+    std::string params;
+    std::string weighted;
+    std::string args;
+    std::string stmts;
+    int expected = 0;
+
+    for (int i = 0; i < many; i++) {
+        std::string n = std::to_string(i);
+
+        params += (i == 0 ? "p" : ", p") + n + " i32";
+        weighted += "    s = s + p" + n + " * " + std::to_string(i + 1) + ";\n";
+        args += (i == 0 ? "" : ", ") + n;
+        expected += i * (i + 1);
+    }
+
+    for (int i = 0; i < 2000; i++) {
+        stmts += "    x = x + 1;\n";
+    }
+
+    std::string path = write_source(
+        "fn none() i32 { return 7; }\n"
+        "fn nothing() {}\n"
+        "fn wide(" + params + ") i32 {\n    let s i32 = 0;\n" + weighted + "    return s;\n}\n"
+        "fn main() i32 {\n"
+        "    let x i32 = none() - 7;\n"
+        "    nothing();\n"
+        "    {}\n"
+        "    { {} {} }\n" + stmts +
+        "    return x - 2000 + wide(" + args + ") - " + std::to_string(expected) + ";\n"
+        "}\n");
+
+    std::string out;
+    CompileResult result = run(path, out);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_EQ(result.exit_code, 0);
+
+    result = compile(path, OutputKind::Interpret);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_EQ(result.exit_code, 0);
+}
+
+TEST_P(CompileTest, JobsDoNotChangeTheOutput) {
+    // enough bodies for every thread to parse some, warnings in the globals and the bodies,
+    // and with errors two bodies of which a sequential pass only reports the first
+    auto program = [](bool errors) {
+        std::string source = "fn putchar(c i32) i32;\n";
+
+        for (int i = 0; i < 64; i++) {
+            std::string n = std::to_string(i);
+            std::string prev = std::to_string(i == 0 ? 0 : i - 1);
+            std::string operand = errors && (i == 20 || i == 50) ? "undeclared" + n : n;
+
+            source += "let g" + n + " i32 = 2147483647 + " + n + ";\n";
+            source += "fn f" + n + "(a i32, depth i32) i32 {\n"
+                      "    let x i32 = a * 3 + g" + n + " - 2147483647 * 2;\n"
+                      "    if depth == 0 { return x % 251; }\n"
+                      "    return f" + prev + "(x / 2 + " + operand + ", depth - 1);\n"
+                      "}\n";
+        }
+
+        return source + "fn main() i32 { putchar(48 + f63(1, 200) % 10); return f40(7, 100) % 100; }\n";
+    };
+
+    std::string valid = write_source(program(false));
+    std::string broken = valid + ".broken.dl";
+    std::ofstream(broken) << program(true);
+
+    // the diagnostics, the exit code, and stdout followed by the output file in output
+    auto compile_with_jobs = [&](const std::string& path, OutputKind kind, unsigned jobs, std::string& output) {
+        DriverOptions options;
+        options.inputs = { path };
+        options.output_kind = kind;
+        options.opt_level = GetParam();
+        options.jobs = jobs;
+
+        if (kind == OutputKind::LLVMIR || kind == OutputKind::Bytecode) {
+            options.output_path = path + "." + std::to_string(jobs) + ".out";
+        }
+
+        std::ostringstream diag;
+
+        ::testing::internal::CaptureStdout();
+        int exit_code = Driver(options).run(diag);
+        std::fflush(stdout);
+        output = ::testing::internal::GetCapturedStdout();
+
+        if (!options.output_path.empty()) {
+            std::ifstream file(options.output_path);
+            output += std::string(std::istreambuf_iterator<char>(file), {});
+        }
+
+        return diag.str() + "exit code " + std::to_string(exit_code) + "\n";
+    };
+
+    for (OutputKind kind : { OutputKind::LLVMIR, OutputKind::Bytecode, OutputKind::Run, OutputKind::Interpret }) {
+        for (const std::string& path : { valid, broken }) {
+            SCOPED_TRACE(path + " as output kind " + std::to_string((int)kind));
+
+            std::string sequential_output;
+            std::string sequential = compile_with_jobs(path, kind, 1, sequential_output);
+
+            std::string parallel_output;
+            std::string parallel = compile_with_jobs(path, kind, 8, parallel_output);
+
+            EXPECT_NE(sequential.find("warning: overflow"), std::string::npos) << sequential;
+            EXPECT_EQ(sequential, parallel);
+            EXPECT_EQ(sequential_output, parallel_output);
+
+            if (path == broken) {
+                EXPECT_NE(sequential.find("'undeclared20'"), std::string::npos) << sequential;
+                EXPECT_EQ(sequential.find("'undeclared50'"), std::string::npos) << sequential;
+            }
+            else {
+                EXPECT_EQ(sequential.find("error"), std::string::npos) << sequential;
+                EXPECT_FALSE(sequential_output.empty());
+            }
+        }
+    }
+}
+
+TEST_P(CompileTest, BoundsTheNestingDepth) {
+    auto repeat = [](std::string_view text, int count) {
+        std::string ret;
+
+        for (int i = 0; i < count; i++) {
+            ret += text;
+        }
+
+        return ret;
+    };
+
+    auto program = [](const std::string& body) {
+        return "fn f(a i32) i32 { return a; }\nfn main() i32 {\n    let x i32 = 1;\n" + body + "\n    return x;\n}\n";
+    };
+
+    // a few thousand levels of every construct the lowering walks recurse on
+    std::string nested = program(
+        "    x = " + repeat("(", 4000) + "x + 1" + repeat(")", 4000) + ";\n"
+        "    x = " + repeat("- ", 4000) + "x + 1;\n"
+        "    x = x" + repeat(" + 1", 4000) + ";\n"
+        "    x = " + repeat("f(", 4000) + "x" + repeat(")", 4000) + " - 4000;\n"
+        "    " + repeat("{", 4000) + "x = x + 1;" + repeat("}", 4000) + "\n"
+        "    if x == 0 { x = 1; }" + repeat(" else if x == 0 { x = 1; }", 2000) + " else { x = x - 4; }");
+
+    std::string path = write_source(nested);
+
+    for (OutputKind kind : { OutputKind::Object, OutputKind::Bytecode, OutputKind::Run, OutputKind::Interpret }) {
+        CompileResult result = compile(path, kind, path + ".out");
+
+        ASSERT_TRUE(result.success) << result.diagnostics;
+        EXPECT_EQ(result.exit_code, 0);
+    }
+
+    // binary operators are not levels, the walks follow a chain in a loop
+    // the optimizer itself is slow on long chains of branches, the && chain is shorter
+    std::string chain = write_source(program(
+        "    x = x" + repeat(" + 1", 200000) + " - 200001;\n"
+        "    if x == 0" + repeat(" && x < 1", 200) + " { x = x * 2; }"));
+
+    for (OutputKind kind : { OutputKind::Object, OutputKind::Bytecode, OutputKind::Run, OutputKind::Interpret }) {
+        CompileResult result = compile(chain, kind, chain + ".out");
+
+        ASSERT_TRUE(result.success) << result.diagnostics;
+        EXPECT_EQ(result.exit_code, 0);
+    }
+
+    // deeper than any stack, reported before it is exhausted in every build type
+    for (const std::string& body : { "    x = " + repeat("(", 1000000) + "x" + repeat(")", 1000000) + ";",
+                                     "    x = " + repeat("-", 1000000) + "x;",
+                                     "    " + repeat("{", 1000000) + repeat("}", 1000000) }) {
+        std::string file = write_source(program(body));
+
+        for (OutputKind kind : { OutputKind::Object, OutputKind::Bytecode, OutputKind::Interpret }) {
+            CompileResult result = compile(file, kind, file + ".out");
+
+            EXPECT_FALSE(result.success);
+            EXPECT_NE(result.diagnostics.find("error: nesting is too deep"), std::string::npos)
+                << result.diagnostics.substr(0, 200);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(OptLevels, CompileTest, ::testing::Values(0u, 2u), [](const auto& info) {
+    return "O" + std::to_string(info.param);
+});
+
+TEST(InterpreterTest, TrapsOnDivisionOverflowLikeNativeCode) {
+    // the number of arguments picks the division
+    std::string path = write_source(R"(
+        fn div32(a i32, b i32) i32 { return a / b; }
+        fn rem32(a i32, b i32) i32 { return a % b; }
+        fn div64(a i64, b i64) i64 { return a / b; }
+        fn rem8(a i8, b i8) i8 { return a % b; }
+
+        fn main(argc i32, argv **u8) i32 {
+            let min32 = -2147483647 - 1;
+            let min64 i64 = 1;
+            min64 <<= 63;
+
+            if argc == 1 { return div32(min32, -1); }
+            if argc == 2 { return rem32(min32, -1); }
+            if argc == 3 { return div64(min64, -1); }
+            if argc == 4 { return rem8(-128, -1); }
+
+            // one off the minimum, or another divisor, does not overflow
+            if div32(min32 + 1, -1) != 2147483647 { return 1; }
+            if div32(min32, -2) != 1073741824 { return 2; }
+            if rem32(min32, 3) != -2 { return 3; }
+            if div64(min64, 2) * -2 != min64 { return 4; }
+            return 0;
+        }
+    )");
+
+    std::vector<std::string> args;
+
+    for (int overflow = 1; overflow <= 4; overflow++) {
+        CompileResult result = compile(path, OutputKind::Interpret, 0, "", args);
+
+        EXPECT_FALSE(result.success) << overflow;
+        EXPECT_NE(result.diagnostics.find("error: division overflow"), std::string::npos) << result.diagnostics;
+
+        args.emplace_back("x");
+    }
+
+    CompileResult result = compile(path, OutputKind::Interpret, 0, "", args);
+
+    ASSERT_TRUE(result.success) << result.diagnostics;
+    EXPECT_EQ(result.exit_code, 0);
+
+    // the hardware division of the JIT compiled code traps
+    ASSERT_TRUE(CodeGen::initialize_native_target());
+    EXPECT_EXIT(compile(path, OutputKind::Run, 0), ::testing::KilledBySignal(SIGFPE), "");
+}
+
+TEST(ConstExprEvaluatorTest, FoldsAndWrapsAtTheWidth) {
+    ASTContext context;
+    QualType i32_ty = context.get_i32_ty();
+    QualType u8_ty = context.get_builtin_type(BuiltinType::U8);
+    QualType i64_ty = context.get_builtin_type(BuiltinType::I64);
+    ConstExprEvaluator evaluator;
+
+    auto i32_value = [&](i64 value) { return ConstInt::of_type((u64)value, i32_ty); };
+
+    auto sum = evaluator.fold_binary(BinaryOp::Plus, i32_value(2), i32_value(3), i32_ty);
+    ASSERT_TRUE(sum);
+    EXPECT_EQ(sum->sext(), 5);
+    EXPECT_FALSE(evaluator.has_overflowed());
+
+    auto wrapped = evaluator.fold_binary(BinaryOp::Plus, i32_value(INT32_MAX), i32_value(1), i32_ty);
+    ASSERT_TRUE(wrapped);
+    EXPECT_EQ(wrapped->sext(), INT32_MIN);
+    EXPECT_TRUE(evaluator.has_overflowed());
+    evaluator.reset_overflow();
+
+    // unsigned arithmetic wraps without overflowing
+    auto byte = evaluator.fold_binary(BinaryOp::Plus, ConstInt::of_type(250, u8_ty), ConstInt::of_type(10, u8_ty),
+                                      u8_ty);
+    ASSERT_TRUE(byte);
+    EXPECT_EQ(byte->bits(), 4u);
+    EXPECT_FALSE(evaluator.has_overflowed());
+
+    auto product = evaluator.fold_binary(BinaryOp::Multiply, ConstInt::of_type(1u << 31, i64_ty),
+                                         ConstInt::of_type(4, i64_ty), i64_ty);
+    ASSERT_TRUE(product);
+    EXPECT_EQ(product->sext(), i64(1) << 33);
+
+    auto negated = evaluator.fold_unary(UnaryOp::Minus, i32_value(INT32_MIN), i32_ty);
+    ASSERT_TRUE(negated);
+    EXPECT_EQ(negated->sext(), INT32_MIN);
+    EXPECT_TRUE(evaluator.has_overflowed());
+    evaluator.reset_overflow();
+
+    auto narrowed = evaluator.fold_cast(CastExpr::IntCast, i32_value(300), u8_ty);
+    ASSERT_TRUE(narrowed);
+    EXPECT_EQ(narrowed->bits(), 44u);
+
+    auto quotient = evaluator.fold_binary(BinaryOp::Divide, i32_value(-7), i32_value(2), i32_ty);
+    auto remainder = evaluator.fold_binary(BinaryOp::Modulo, i32_value(-7), i32_value(2), i32_ty);
+    ASSERT_TRUE(quotient && remainder);
+    EXPECT_EQ(quotient->sext(), -3);
+    EXPECT_EQ(remainder->sext(), -1);
+}
+
+TEST(ConstExprEvaluatorTest, LeavesTrappingOperationsUnfolded) {
+    ASTContext context;
+    QualType i8_ty = context.get_builtin_type(BuiltinType::I8);
+    QualType i32_ty = context.get_i32_ty();
+    QualType i64_ty = context.get_builtin_type(BuiltinType::I64);
+    ConstExprEvaluator evaluator;
+
+    for (QualType ty : { i8_ty, i32_ty, i64_ty }) {
+        const u32 bits = (u32)ty.size() * 8;
+        ConstInt min = ConstInt::of_type(~u64(0) << (bits - 1), ty);
+        ConstInt minus_one = ConstInt::of_type(~u64(0), ty);
+
+        EXPECT_FALSE(evaluator.fold_binary(BinaryOp::Divide, min, minus_one, ty)) << bits;
+        EXPECT_FALSE(evaluator.fold_binary(BinaryOp::Modulo, min, minus_one, ty)) << bits;
+        EXPECT_FALSE(evaluator.fold_binary(BinaryOp::Divide, min, ConstInt::of_type(0, ty), ty)) << bits;
+        EXPECT_FALSE(evaluator.fold_binary(BinaryOp::LeftShift, minus_one, ConstInt::of_type(bits, ty), ty)) << bits;
+
+        // the other divisors of the minimum value are constants
+        auto half = evaluator.fold_binary(BinaryOp::Divide, min, ConstInt::of_type(~u64(1), ty), ty);
+        ASSERT_TRUE(half) << bits;
+        EXPECT_EQ(half->sext(), i64(1) << (bits - 2));
+    }
+
+    EXPECT_FALSE(evaluator.has_overflowed());
+
+    // operands wider than 64 bits take the APSInt path
+    ConstInt wide_min(llvm::APSInt(llvm::APInt::getSignedMinValue(128), false));
+    ConstInt wide_minus_one(llvm::APSInt(llvm::APInt::getAllOnes(128), false));
+
+    EXPECT_FALSE(evaluator.fold_binary(BinaryOp::Divide, wide_min, wide_minus_one, i64_ty));
+    EXPECT_FALSE(evaluator.fold_binary(BinaryOp::Modulo, wide_min, wide_minus_one, i64_ty));
+}
+
+TEST(InterpreterTest, DivisionOverflowInConstantsTrapsAtRunTime) {
+    std::string path = write_source(R"(
+        fn main() i32 {
+            return (-2147483647 - 1) / -1;
+        }
+    )");
+
+    CompileResult result = compile(path, OutputKind::Interpret, 0);
+
+    EXPECT_FALSE(result.success);
+    EXPECT_NE(result.diagnostics.find("error: division overflow"), std::string::npos) << result.diagnostics;
+}
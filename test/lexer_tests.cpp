@@ -1,23 +1,32 @@
-#include "../lexer.hpp"
-#include "../filebuffer.hpp"
-#include "../token.hpp"
-#include "../keywordtrie.hpp"
+#include "lexer.hpp"
+#include "filebuffer.hpp"
+#include "token.hpp"
+#include "keywordtrie.hpp"
+#include "charscan.hpp"
+#include "diagnostics.hpp"
+#include "statistic.hpp"
+#include "timetrace.hpp"
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace deltac;
 
 static constexpr std::string_view token_literals[] = {
 #define PUNCTUATOR(X, Y) Y,
 #define KEYWORD(X, Y) Y,
-#include "testtokentype.inc"
+#include "tokentype.inc"
 };
 
-static constexpr TokenType token_types[] = {
-#define TOK(X) TokenType::X,
-#include "testtokentype.inc"
+static constexpr tok::Kind token_types[] = {
+#define PUNCTUATOR(X, Y) tok::X,
+#define KEYWORD(X, Y) tok::X,
+#include "tokentype.inc"
 };
 
-void TokenLexTest(const std::string& input, TokenType expectedType, const std::string& expectedValue) {
+void TokenLexTest(const std::string& input, tok::Kind expectedType, const std::string& expectedValue) {
     std::istringstream iss(input);
     SourceBuffer buffer(iss);
     Lexer lexer(buffer);
@@ -26,7 +35,7 @@ void TokenLexTest(const std::string& input, TokenType expectedType, const std::s
     EXPECT_EQ(token.get_type(), expectedType) << "Mismatched token type for input: " << input;
     EXPECT_EQ(token.get_view(), expectedValue) << "Mismatched token value for input: " << input;
     EXPECT_TRUE(lexer.lex(token)) << "Missing EOF token";
-    EXPECT_EQ(token.get_type(), TokenType::EndOfFile);
+    EXPECT_EQ(token.get_type(), tok::EndOfFile);
 }
 
 class LexerTest : public ::testing::Test {
@@ -48,7 +57,7 @@ TEST_F(LexerTest, geqTest) {
     Lexer lexer2(buffer2);
     Token token2;
     lexer2.lex(token2);
-    EXPECT_EQ(token2.get_type(), TokenType::GreaterGreaterEqual);
+    EXPECT_EQ(token2.get_type(), tok::GreaterGreaterEqual);
     EXPECT_EQ(token2.get_view(), ">>=");
     std::cout << "the actual view is " << token2.get_view() << " for >>= symbol" << std::endl;
 }
@@ -58,27 +67,524 @@ TEST_F(LexerTest, HandlesNumericLiterals) {
     Lexer lexer(buffer);
     Token token;
     EXPECT_TRUE(lexer.lex(token));
-    EXPECT_EQ(token.get_type(), TokenType::DecIntLiteral);
+    EXPECT_EQ(token.get_type(), tok::DecIntLiteral);
     EXPECT_EQ(token.get_view(), "12323");
     EXPECT_TRUE(lexer.lex(token));
-    EXPECT_EQ(token.get_type(), TokenType::HexIntLiteral);
+    EXPECT_EQ(token.get_type(), tok::HexIntLiteral);
     EXPECT_EQ(token.get_view(), "0x7FFFFFFF");
     EXPECT_TRUE(lexer.lex(token));
-    EXPECT_EQ(token.get_type(), TokenType::FloatLiteral);
+    EXPECT_EQ(token.get_type(), tok::FloatLiteral);
     EXPECT_EQ(token.get_view(), "12345.");
     EXPECT_TRUE(lexer.lex(token));
-    EXPECT_EQ(token.get_type(), TokenType::DecIntLiteral);
+    EXPECT_EQ(token.get_type(), tok::DecIntLiteral);
     EXPECT_EQ(token.get_view(), "12345");
     EXPECT_TRUE(lexer.lex(token));
-    EXPECT_EQ(token.get_type(), TokenType::FloatLiteral);
+    EXPECT_EQ(token.get_type(), tok::FloatLiteral);
     EXPECT_EQ(token.get_view(), "123.123");
     EXPECT_TRUE(lexer.lex(token));
-    EXPECT_EQ(token.get_type(), TokenType::DecIntLiteral);
+    EXPECT_EQ(token.get_type(), tok::DecIntLiteral);
     EXPECT_EQ(token.get_view(), "12314");
     EXPECT_TRUE(lexer.lex(token));
-    EXPECT_EQ(token.get_type(), TokenType::EndOfFile);
+    EXPECT_EQ(token.get_type(), tok::EndOfFile);
     EXPECT_FALSE(lexer.lex(token));
-    EXPECT_EQ(token.get_type(), TokenType::ERROR);
+    EXPECT_EQ(token.get_type(), tok::ERROR);
+}
+
+TEST_F(LexerTest, SkipsWhitespaceAndComments) {
+    std::istringstream iss(
+        "                                        \t\n"
+        "// line comment\n"
+        "let /* block\n * comment */ x // trailing"
+    );
+    SourceBuffer buffer(iss);
+    Lexer lexer(buffer);
+    Token token;
+
+    EXPECT_TRUE(lexer.lex(token));
+    EXPECT_EQ(token.get_type(), tok::Let);
+    EXPECT_TRUE(lexer.lex(token));
+    EXPECT_EQ(token.get_type(), tok::Identifier);
+    EXPECT_EQ(token.get_view(), "x");
+    EXPECT_TRUE(lexer.lex(token));
+    EXPECT_EQ(token.get_type(), tok::EndOfFile);
+}
+
+TEST_F(LexerTest, UnterminatedBlockComment) {
+    std::istringstream iss("x /* never closed");
+    SourceBuffer buffer(iss);
+    SourceManager sources;
+    auto fid = sources.add_buffer(buffer.ptr_cbegin(), buffer.size(), "comment.dl");
+    DiagnosticsEngine diags;
+    Lexer lexer(buffer, sources.start_location(fid));
+    lexer.set_diagnostics(&diags);
+    Token token;
+
+    EXPECT_TRUE(lexer.lex(token));
+    EXPECT_FALSE(lexer.lex(token));
+    EXPECT_EQ(token.get_type(), tok::ERROR);
+    EXPECT_EQ(token.get_view(), "/* never closed");
+    EXPECT_TRUE(lexer.lex(token));
+    EXPECT_EQ(token.get_type(), tok::EndOfFile);
+
+    ASSERT_EQ(diags.diagnostics().size(), 1u);
+    EXPECT_EQ(DiagnosticsEngine::format(diags.diagnostics()[0], sources, "comment.dl"),
+              "comment.dl:1:3: error: unterminated block comment");
+}
+
+TEST_F(LexerTest, UnterminatedStringLiteral) {
+    std::istringstream iss("let s = \"abc\\\";\n");
+    SourceBuffer buffer(iss);
+    SourceManager sources;
+    auto fid = sources.add_buffer(buffer.ptr_cbegin(), buffer.size(), "string.dl");
+    DiagnosticsEngine diags;
+    Lexer lexer(buffer, sources.start_location(fid));
+    lexer.set_diagnostics(&diags);
+    TokenBuffer tokens;
+
+    EXPECT_FALSE(lexer.lex_all(tokens));
+    ASSERT_EQ(tokens.size(), 5u);
+    EXPECT_EQ(tokens.kind(3), tok::ERROR);
+    EXPECT_EQ(tokens.kind(4), tok::EndOfFile);
+
+    ASSERT_EQ(diags.diagnostics().size(), 1u);
+    EXPECT_EQ(diags.diagnostics()[0].kind, diag::UnterminatedString);
+    EXPECT_EQ(DiagnosticsEngine::format(diags.diagnostics()[0], sources, "string.dl"),
+              "string.dl:1:9: error: unterminated string literal");
+}
+
+TEST(CharScanTest, StopsAtEveryPosition) {
+    // runs ending at every offset of the 16 and 32 byte vector loops and of the scalar tail
+    const std::string_view whitespace = " \t\n\v\f\r";
+
+    for (size_t length = 0; length < 80; ++length) {
+        std::string text;
+        for (size_t i = 0; i < length; ++i) {
+            text += whitespace[i % whitespace.size()];
+        }
+        text += "x\"'";
+        text.append(64, '\0');
+
+        const char* begin = text.data();
+        const char* end = begin + text.size();
+
+        SCOPED_TRACE("run of " + std::to_string(length));
+        EXPECT_EQ(skip_whitespace(begin, end), begin + length);
+        EXPECT_EQ(find_first_of(begin, end, '"', '\''), begin + length + 1);
+        EXPECT_EQ(find_first_of(begin, begin + length, '"', '\''), begin + length);
+    }
+}
+
+TEST(CharScanTest, FindsAnyOfFourCharacters) {
+    const std::string_view targets = "\"'/\n";
+
+    for (size_t length = 0; length < 80; ++length) {
+        for (char target : targets) {
+            std::string text(length, 'a');
+            text += target;
+            text.append(64, '\0');
+
+            const char* begin = text.data();
+            const char* end = begin + text.size();
+
+            SCOPED_TRACE("run of " + std::to_string(length));
+            EXPECT_EQ(find_first_of(begin, end, '"', '\'', '/', '\n'), begin + length);
+            EXPECT_EQ(find_first_of(begin, begin + length, '"', '\'', '/', '\n'), begin + length);
+        }
+    }
+}
+
+TEST_F(LexerTest, LexAllMatchesLex) {
+    SourceBuffer buffer("./helloworld.dl");
+    Lexer streaming(buffer);
+    Lexer whole(buffer);
+    TokenBuffer tokens;
+
+    EXPECT_TRUE(whole.lex_all(tokens));
+    ASSERT_FALSE(tokens.empty());
+    EXPECT_EQ(tokens.kind(tokens.size() - 1), tok::EndOfFile);
+
+    Token token;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        EXPECT_TRUE(streaming.lex(token));
+        EXPECT_EQ(tokens.kind(i), token.get_type());
+        EXPECT_EQ(tokens.view(i), token.get_view());
+    }
+
+    EXPECT_TRUE(streaming.is_eof());
+    EXPECT_LT(TokenBuffer::BYTES_PER_TOKEN, sizeof(Token));
+}
+
+TEST_F(LexerTest, LexAllKeepsErrorTokens) {
+    std::istringstream iss("let a = 0x1F; $ fn /* open");
+    SourceBuffer buffer(iss);
+    Lexer lexer(buffer);
+    TokenBuffer tokens;
+
+    EXPECT_FALSE(lexer.lex_all(tokens));
+    EXPECT_TRUE(lexer.is_eof());
+
+    const tok::Kind expected[] = {
+        tok::Let, tok::Identifier, tok::Equal, tok::HexIntLiteral, tok::Semicolon,
+        tok::ERROR, tok::Fn, tok::ERROR, tok::EndOfFile,
+    };
+
+    ASSERT_EQ(tokens.size(), std::size(expected));
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        EXPECT_EQ(tokens.kind(i), expected[i]) << "token " << i;
+    }
+
+    EXPECT_EQ(tokens.view(3), "0x1F");
+    EXPECT_EQ(tokens.offset(6), 16u);
+
+    Token token = tokens.token(6);
+    EXPECT_EQ(token.get_type(), tok::Fn);
+    EXPECT_EQ(token.get_view(), "fn");
+}
+
+TEST_F(LexerTest, ParallelLexAllReportsErrorsOnceInOrder) {
+    // an error at the end of every unit, some of them at the start of a chunk
+    const std::string unit = "let a = b;\n$\n";
+
+    std::string source;
+    while (source.size() < 4 * Lexer::MIN_PARALLEL_CHUNK) {
+        source += unit;
+    }
+    source += "0x1G";
+
+    std::istringstream iss(source);
+    SourceBuffer buffer(iss);
+    SourceManager sources;
+    auto fid = sources.add_buffer(buffer.ptr_cbegin(), buffer.size(), "errors.dl");
+    DiagnosticsEngine sequential_diags;
+    DiagnosticsEngine parallel_diags;
+
+    Lexer sequential_lexer(buffer, sources.start_location(fid));
+    Lexer parallel_lexer(buffer, sources.start_location(fid));
+    sequential_lexer.set_diagnostics(&sequential_diags);
+    parallel_lexer.set_diagnostics(&parallel_diags);
+
+    TokenBuffer sequential;
+    TokenBuffer parallel;
+    EXPECT_FALSE(sequential_lexer.lex_all(sequential));
+    EXPECT_FALSE(parallel_lexer.lex_all(parallel, 4));
+
+    const usize num_errors = source.size() / unit.size() + 1;
+    ASSERT_EQ(sequential_diags.diagnostics().size(), num_errors);
+    ASSERT_EQ(parallel_diags.diagnostics().size(), num_errors);
+    EXPECT_EQ(parallel_diags.error_count(), num_errors);
+
+    for (usize i = 0; i < num_errors; i++) {
+        const auto& expected = sequential_diags.diagnostics()[i];
+        const auto& actual = parallel_diags.diagnostics()[i];
+
+        ASSERT_EQ(actual.location.raw(), expected.location.raw()) << "diagnostic " << i;
+        ASSERT_EQ(actual.message, expected.message) << "diagnostic " << i;
+    }
+
+    EXPECT_EQ(parallel_diags.diagnostics().back().message, "invalid token '0x1'");
+
+    parallel_diags.truncate(20);
+    EXPECT_EQ(parallel_diags.diagnostics().size(), 20u);
+    EXPECT_EQ(parallel_diags.error_count(), 20u);
+}
+
+TEST_F(LexerTest, ParallelLexAllMatchesSequential) {
+    // literals and comments spanning lines must not be split between chunks
+    const std::string unit =
+        "let s: *u8 = \"multi\nline \\\" string // not a comment\n\";\n"
+        "let c: u8 = '\\n'; /* block\n ' \" \n */ let d: u8 = '\"';\n"
+        "// comment with ' and \" chars\n"
+        "fn f() i32 { return 1 + 2 * 3 - x / y; }\n";
+
+    std::string source;
+    while (source.size() < 4 * Lexer::MIN_PARALLEL_CHUNK) {
+        source += unit;
+        // names first seen in every chunk
+        source += "let id" + std::to_string(source.size()) + " = x;\n";
+    }
+
+    std::istringstream iss(source);
+    SourceBuffer buffer(iss);
+    IdentifierTable sequential_ids;
+    IdentifierTable parallel_ids;
+    TokenBuffer sequential;
+    TokenBuffer parallel;
+
+    Lexer sequential_lexer(buffer);
+    Lexer parallel_lexer(buffer);
+    sequential_lexer.set_identifier_table(&sequential_ids);
+    parallel_lexer.set_identifier_table(&parallel_ids);
+
+    EXPECT_TRUE(sequential_lexer.lex_all(sequential));
+    EXPECT_TRUE(parallel_lexer.lex_all(parallel, 4));
+
+    ASSERT_EQ(sequential.size(), parallel.size());
+    for (size_t i = 0; i < sequential.size(); ++i) {
+        ASSERT_EQ(sequential.kind(i), parallel.kind(i));
+        ASSERT_EQ(sequential.offset(i), parallel.offset(i));
+        ASSERT_EQ(sequential.length(i), parallel.length(i));
+        ASSERT_EQ(sequential.ident_id(i), parallel.ident_id(i));
+
+        if (parallel.ident_id(i) != IdentifierTable::NO_IDENT) {
+            ASSERT_EQ(parallel.identifier_info(i)->name(), parallel.view(i));
+        }
+    }
+
+    EXPECT_EQ(sequential_ids.size(), parallel_ids.size());
+}
+
+TEST_F(LexerTest, InternsIdentifiers) {
+    std::string_view source = "let abc = abc + abd; fn ABC";
+    IdentifierTable identifiers;
+    Lexer lexer(source.data(), source.data() + source.size() + 1);
+    lexer.set_identifier_table(&identifiers);
+
+    std::vector<Token> tokens;
+    Token token;
+    while (lexer.lex(token)) {
+        tokens.push_back(token);
+    }
+
+    ASSERT_EQ(tokens.size(), 10u);
+    EXPECT_EQ(tokens[0].get_identifier_info(), nullptr);
+    ASSERT_NE(tokens[1].get_identifier_info(), nullptr);
+    EXPECT_EQ(tokens[1].get_identifier_info(), tokens[3].get_identifier_info());
+    EXPECT_NE(tokens[1].get_identifier_info(), tokens[5].get_identifier_info());
+    EXPECT_EQ(tokens[1].get_identifier_info()->name(), "abc");
+    EXPECT_EQ(identifiers.find("ABC"), tokens[8].get_identifier_info());
+    EXPECT_EQ(identifiers.find("fn"), nullptr);
+    EXPECT_EQ(identifiers.size(), 3u);
+}
+
+TEST(SourceManagerTest, ResolvesLocations) {
+    std::string_view first = "let a = 1;\nlet b = 2;\n\nfn";
+    std::string_view second = "x\ny";
+    SourceManager sources;
+    auto first_id = sources.add_buffer(first.data(), first.size(), "first.dl");
+    auto second_id = sources.add_buffer(second.data(), second.size(), "second.dl");
+
+    Lexer lexer(first.data(), first.data() + first.size() + 1, sources.start_location(first_id));
+    Token token;
+    for (int i = 0; i < 7; ++i) {
+        ASSERT_TRUE(lexer.lex(token));
+    }
+
+    ASSERT_EQ(token.get_view(), "b");
+    PresumedLoc loc = sources.presumed_loc(token.get_location());
+    EXPECT_EQ(loc.file, "first.dl");
+    EXPECT_EQ(loc.line, 2u);
+    EXPECT_EQ(loc.column, 5u);
+    EXPECT_EQ(sources.character_data(token.get_location()), first.data() + 15);
+
+    SourceLocation y = sources.start_location(second_id).offset_by(2);
+    EXPECT_EQ(sources.file_id(y), second_id);
+    EXPECT_EQ(sources.format_location(y), "second.dl:2:1");
+    EXPECT_EQ(sizeof(SourceLocation), 4u);
+}
+
+TEST(SourceManagerTest, ResolvesEveryLineFromManyThreads) {
+    // lines of every length up to past the width of the newline scan
+    std::string text;
+    std::vector<u32> line_starts;
+    for (u32 line = 0; line < 200; ++line) {
+        line_starts.push_back((u32)text.size());
+        text.append(line % 70, 'a');
+        text += '\n';
+    }
+
+    SourceManager sources;
+    auto fid = sources.add_buffer(text.data(), text.size(), "lines.dl");
+    SourceLocation start = sources.start_location(fid);
+
+    EXPECT_EQ(sources.file_id(SourceLocation()), SourceManager::INVALID_FILE);
+    EXPECT_EQ(sources.file_id(start.offset_by((u32)text.size())), fid);
+
+    // the line table is built by whichever thread resolves a location first
+    std::vector<std::thread> threads;
+    std::vector<char> results(4, false);
+    for (size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&, t] {
+            bool ok = true;
+            for (u32 line = 0; line < line_starts.size(); ++line) {
+                u32 length = line % 70;
+                PresumedLoc first = sources.presumed_loc(start.offset_by(line_starts[line]));
+                PresumedLoc newline = sources.presumed_loc(start.offset_by(line_starts[line] + length));
+                ok &= first.line == line + 1 && first.column == 1;
+                ok &= newline.line == line + 1 && newline.column == length + 1;
+            }
+            results[t] = ok;
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (char ok : results) {
+        EXPECT_TRUE(ok);
+    }
+}
+
+TEST(DiagnosticsTest, FormatsAndMovesDiagnostics) {
+    std::string_view text = "fn f() {\n  y;\n}";
+    SourceManager sources;
+    auto fid = sources.add_buffer(text.data(), text.size(), "diag.dl");
+    SourceLocation y = sources.start_location(fid).offset_by(11);
+
+    DiagnosticsEngine worker;
+    worker.report(y, diag::UndeclaredIdentifier, { "y" });
+    worker.report(y, diag::ConstantOverflow, { "i32" });
+    worker.report(y, diag::IncompatibleConversion, { "*i8", "i32" });
+    EXPECT_EQ(worker.error_count(), 2u);
+
+    ASSERT_EQ(worker.diagnostics().size(), 3u);
+    EXPECT_EQ(DiagnosticsEngine::format(worker.diagnostics()[0], sources, "diag.dl"),
+              "diag.dl:2:3: error: use of undeclared identifier 'y'");
+    EXPECT_EQ(DiagnosticsEngine::format(worker.diagnostics()[1], sources, "diag.dl"),
+              "diag.dl:2:3: warning: overflow in constant expression of type 'i32'");
+    EXPECT_EQ(worker.diagnostics()[2].message, "cannot convert '*i8' to 'i32'");
+
+    DiagnosticsEngine main;
+    main.report({}, diag::ExpectedDeclaration);
+    EXPECT_EQ(DiagnosticsEngine::format(main.diagnostics()[0], sources, "diag.dl"),
+              "diag.dl: error: expected a declaration");
+
+    // only what was reported since the first one
+    main.take(worker, 1);
+    EXPECT_EQ(main.diagnostics().size(), 3u);
+    EXPECT_EQ(main.error_count(), 2u);
+    EXPECT_EQ(main.diagnostics()[1].kind, diag::ConstantOverflow);
+    EXPECT_EQ(worker.diagnostics().size(), 1u);
+    EXPECT_EQ(worker.error_count(), 1u);
+
+    main.clear();
+    EXPECT_FALSE(main.has_errors());
+    EXPECT_TRUE(main.diagnostics().empty());
+}
+
+TEST(DiagnosticsTest, InsertsAndDropsAfterTheFirstError) {
+    DiagnosticsEngine main;
+    main.report({}, diag::ConstantOverflow, { "i8" });
+    main.report({}, diag::ExpectedDeclaration);
+
+    DiagnosticsEngine body;
+    body.report({}, diag::ConstantOverflow, { "i32" });
+    body.report({}, diag::UndeclaredIdentifier, { "y" });
+
+    // the body was skipped after the first warning
+    main.insert(1, body);
+    EXPECT_TRUE(body.diagnostics().empty());
+    EXPECT_FALSE(body.has_errors());
+
+    ASSERT_EQ(main.diagnostics().size(), 4u);
+    EXPECT_EQ(main.error_count(), 2u);
+    EXPECT_EQ(main.diagnostics()[1].message, "overflow in constant expression of type 'i32'");
+    EXPECT_EQ(main.diagnostics()[2].kind, diag::UndeclaredIdentifier);
+    EXPECT_EQ(main.diagnostics()[3].kind, diag::ExpectedDeclaration);
+
+    main.drop_after_first_error();
+    ASSERT_EQ(main.diagnostics().size(), 3u);
+    EXPECT_EQ(main.error_count(), 1u);
+    EXPECT_EQ(main.diagnostics()[2].kind, diag::UndeclaredIdentifier);
+
+    // only warnings are all kept
+    DiagnosticsEngine warnings;
+    warnings.report({}, diag::ConstantOverflow, { "i8" });
+    warnings.drop_after_first_error();
+    EXPECT_EQ(warnings.diagnostics().size(), 1u);
+}
+
+TEST(TimeTraceTest, RecordsPhases) {
+    std::istringstream iss("let a = 1;\nlet b = a;\n");
+    SourceBuffer buffer(iss);
+
+    timetrace::initialize(0);
+
+    TokenBuffer tokens;
+    Lexer(buffer).lex_all(tokens);
+
+    std::ostringstream trace;
+    timetrace::write(trace);
+    timetrace::cleanup();
+
+    EXPECT_FALSE(timetrace::is_enabled());
+    EXPECT_NE(trace.str().find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(trace.str().find("\"name\":\"Lex\""), std::string::npos);
+    EXPECT_NE(trace.str().find("\"name\":\"Total Lex\""), std::string::npos);
+    // the buffer was loaded before tracing started
+    EXPECT_EQ(trace.str().find("Load file"), std::string::npos);
+}
+
+TEST(TimeTraceTest, DropsShortEventsButCountsThem) {
+    // nothing is recorded while tracing is off
+    { TimeTraceScope scope("Before"); }
+
+    timetrace::initialize(10 * 1000 * 1000);
+
+    for (int i = 0; i < 3; ++i) {
+        TimeTraceScope outer("Short", "detail");
+        // a recursive scope of the same phase counts once
+        TimeTraceScope inner("Short");
+    }
+
+    std::thread([] { TimeTraceScope scope("Worker"); }).join();
+
+    std::ostringstream trace;
+    timetrace::write(trace);
+    timetrace::cleanup();
+
+    const std::string json = trace.str();
+    EXPECT_EQ(json.find("\"name\":\"Short\""), std::string::npos);
+    EXPECT_EQ(json.find("\"detail\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"Total Short\",\"args\":{\"count\":3,"), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"Total Worker\",\"args\":{\"count\":1,"), std::string::npos);
+    EXPECT_EQ(json.find("Before"), std::string::npos);
+    // the main thread and the worker each get a track
+    EXPECT_NE(json.find("\"name\":\"thread 1\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"thread 2\""), std::string::npos);
+}
+
+TEST(StatisticTest, CountsTokensByKind) {
+    std::istringstream iss("let a = 1;\nlet b = a;\n");
+    SourceBuffer buffer(iss);
+
+    stats::enable();
+    stats::reset();
+
+    // 10 tokens and EndOfFile, once streamed and once into a buffer
+    Lexer streaming(buffer);
+    Token token;
+    while (streaming.lex(token)) {}
+
+    TokenBuffer tokens;
+    Lexer(buffer).lex_all(tokens);
+
+    std::ostringstream json;
+    stats::print_json(json);
+    stats::enable(false);
+
+    EXPECT_NE(json.str().find("\"lexer.NumTokens\": 22"), std::string::npos);
+    EXPECT_NE(json.str().find("\"lexer.NumTokensByKind.Let\": 4"), std::string::npos);
+    EXPECT_NE(json.str().find("\"lexer.NumTokensByKind.EndOfFile\": 2"), std::string::npos);
+    // kinds that never occurred are left out
+    EXPECT_EQ(json.str().find("\"lexer.NumTokensByKind.Fn\""), std::string::npos);
+}
+
+TEST(SourceBufferTest, ZeroPadding) {
+    std::istringstream iss("let x = 1;");
+    SourceBuffer streamed(iss);
+    SourceBuffer mapped("./numbers.dl");
+
+    for (const SourceBuffer* buffer : { &streamed, &mapped }) {
+        EXPECT_EQ(buffer->ptr_cend(), buffer->cend() + 1);
+
+        for (size_t i = 0; i < SourceBuffer::PADDING; ++i) {
+            EXPECT_EQ(buffer->cend()[i], '\0');
+        }
+    }
+
+    EXPECT_EQ(streamed.size(), 10u);
+    EXPECT_TRUE(mapped.is_mapped());
 }
 
 int main(int argc, char **argv) {
@@ -0,0 +1,496 @@
+#include "astcontext.hpp"
+#include "filebuffer.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "sourcemanager.hpp"
+
+#include "llvm/ADT/StringExtras.h"
+
+#include <gtest/gtest.h>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace deltac;
+
+namespace {
+
+enum class BodyParsing {
+    Eager,
+    Lazy,
+    Parallel,
+    // only the bodies main reaches, like --run
+    Referenced,
+};
+
+// a line per node with its kind, location, type and operator, children indented below it
+class ASTDumper {
+public:
+    explicit ASTDumper(const SourceManager& sources) : sources(sources) {}
+
+    std::string dump(const ASTContext& context) {
+        for (VarDecl* var : context.toplevel_vardecls()) {
+            dump_decl(var, 0);
+        }
+
+        for (FuncDecl* fn : context.toplevel_funcdecls()) {
+            dump_decl(fn, 0);
+        }
+
+        return out.str();
+    }
+
+private:
+    void line(usize depth, SourceLocation loc, std::string_view text) {
+        out << std::string(depth * 2, ' ') << text << " <" << (loc.is_valid() ? sources.format_location(loc) : "") << ">\n";
+    }
+
+    void dump_decl(Decl* decl, usize depth) {
+        if (auto* var = util::dyn_cast<VarDecl>(decl)) {
+            line(depth, var->location(), "VarDecl " + std::string(var->get_identifier()) + " " + var->decl_type().repr());
+
+            if (var->has_body()) {
+                dump_expr(var->get_expr(), depth + 1);
+            }
+        }
+        else if (auto* fn = util::dyn_cast<FuncDecl>(decl)) {
+            line(depth, fn->location(), "FuncDecl " + fn->get_decl_repr() + (fn->is_body_pending() ? " pending" : ""));
+
+            if (fn->has_body()) {
+                dump_stmt(fn->get_body(), depth + 1);
+            }
+        }
+    }
+
+    void dump_stmt(Stmt* stmt, usize depth) {
+        switch (stmt->stmt_kind()) {
+        case Stmt::CompoundStmtKind:
+            line(depth, stmt->location(), "CompoundStmt");
+
+            for (Stmt* s : util::cast<CompoundStmt>(stmt)->body()) {
+                dump_stmt(s, depth + 1);
+            }
+            break;
+        case Stmt::ExprStmtKind:
+            line(depth, stmt->location(), "ExprStmt");
+            dump_expr(util::cast<ExprStmt>(stmt)->get_expr(), depth + 1);
+            break;
+        case Stmt::DeclStmtKind:
+            line(depth, stmt->location(), "DeclStmt");
+            dump_decl(util::cast<DeclStmt>(stmt)->get_decl(), depth + 1);
+            break;
+        case Stmt::ReturnStmtKind:
+            line(depth, stmt->location(), "ReturnStmt");
+
+            if (auto* ret = util::cast<ReturnStmt>(stmt); ret->has_expr()) {
+                dump_expr(ret->get_expr(), depth + 1);
+            }
+            break;
+        case Stmt::IfStmtKind: {
+            auto* if_stmt = util::cast<IfStmt>(stmt);
+
+            line(depth, stmt->location(), "IfStmt");
+            dump_expr(if_stmt->get_cond(), depth + 1);
+            dump_stmt(if_stmt->get_then(), depth + 1);
+
+            if (if_stmt->has_else()) {
+                dump_stmt(if_stmt->get_else(), depth + 1);
+            }
+            break;
+        }
+        default:
+            FAIL() << "unexpected statement kind " << (int)stmt->stmt_kind();
+        }
+    }
+
+    void dump_expr(Expr* expr, usize depth) {
+        std::string text = "Expr " + std::to_string((int)expr->expr_kind()) + " " + expr->type().repr()
+            + (expr->is_rval() ? " rvalue" : " lvalue");
+
+        if (auto* e = util::dyn_cast<BinaryExpr>(expr)) {
+            line(depth, expr->location(), text + " op " + std::to_string((int)e->op_code()));
+            dump_expr(e->lhs(), depth + 1);
+            dump_expr(e->rhs(), depth + 1);
+        }
+        else if (auto* e = util::dyn_cast<AssignExpr>(expr)) {
+            line(depth, expr->location(), text + " op " + std::to_string((int)e->op_code()));
+            dump_expr(e->lhs(), depth + 1);
+            dump_expr(e->rhs(), depth + 1);
+        }
+        else if (auto* e = util::dyn_cast<UnaryExpr>(expr)) {
+            line(depth, expr->location(), text + " op " + std::to_string((int)e->op_code()));
+            dump_expr(e->expr(), depth + 1);
+        }
+        else if (auto* e = util::dyn_cast<CallExpr>(expr)) {
+            line(depth, expr->location(), text);
+            dump_expr(e->expr(), depth + 1);
+
+            for (Expr* arg : e->arguments()) {
+                dump_expr(arg, depth + 1);
+            }
+        }
+        else if (auto* e = util::dyn_cast<CastExpr>(expr)) {
+            line(depth, expr->location(), text + " cast " + std::to_string((int)e->cast_kind()));
+            dump_expr(e->castee(), depth + 1);
+        }
+        else if (auto* e = util::dyn_cast<ParenExpr>(expr)) {
+            line(depth, expr->location(), text);
+            dump_expr(e->sub_expr(), depth + 1);
+        }
+        else if (auto* e = util::dyn_cast<IdExpr>(expr)) {
+            line(depth, expr->location(), text + " " + std::string(e->get_identifier_info()->name()));
+        }
+        else if (auto* e = util::dyn_cast<IntLiteralExpr>(expr)) {
+            line(depth, expr->location(), text + " " + llvm::toString(e->get_value(), 10));
+        }
+        else {
+            FAIL() << "unexpected expression kind " << (int)expr->expr_kind();
+        }
+    }
+
+private:
+    const SourceManager& sources;
+    std::ostringstream out;
+};
+
+struct ParseResult {
+    std::string ast;
+    std::string diagnostics;
+    bool success;
+};
+
+// parses source like the driver does, the bodies in place for Eager, inspect sees the AST
+ParseResult parse(std::string_view source, BodyParsing mode,
+                  const std::function<void(const ASTContext&)>& inspect = nullptr) {
+    std::istringstream input{ std::string(source) };
+    SourceBuffer buffer(input);
+    SourceManager sources;
+    SourceManager::FileID fid = sources.add_buffer(buffer.ptr_cbegin(), buffer.size(), "test.dl");
+
+    ASTContext context;
+    Sema sema(context);
+
+    TokenBuffer tokens;
+    Lexer lexer(buffer, sources.start_location(fid));
+    lexer.set_identifier_table(&context.identifier_table());
+
+    EXPECT_TRUE(lexer.lex_all(tokens));
+
+    Parser parser(tokens, sema);
+    Decl* decl = nullptr;
+
+    parser.set_lazy_bodies(mode != BodyParsing::Eager);
+
+    while (parser.parse_top_level_decl(decl)) {}
+
+    bool success = parser.is_eof();
+
+    if (mode == BodyParsing::Referenced) {
+        auto main = context.lookup_decl_with_id("main");
+        EXPECT_TRUE(main.is_function());
+
+        FuncDecl* roots[] = { util::cast<FuncDecl>(main.result_decl()) };
+        success = parser.parse_referenced_bodies(roots) && success;
+    }
+    else if (mode != BodyParsing::Eager) {
+        success = parser.parse_pending_bodies(mode == BodyParsing::Parallel ? 4 : 1) && success;
+    }
+
+    if (inspect) {
+        inspect(context);
+    }
+
+    ParseResult res{ ASTDumper(sources).dump(context), "", success };
+
+    for (const DiagnosticsEngine::Diagnostic& d : sema.diagnostics().diagnostics()) {
+        res.diagnostics += DiagnosticsEngine::format(d, sources, "test.dl") + "\n";
+    }
+
+    return res;
+}
+
+// lazy and parallel parsing must not be observable
+void expect_same_as_eager(std::string_view source) {
+    ParseResult eager = parse(source, BodyParsing::Eager);
+
+    for (BodyParsing mode : { BodyParsing::Lazy, BodyParsing::Parallel }) {
+        SCOPED_TRACE(mode == BodyParsing::Lazy ? "lazy" : "parallel");
+
+        ParseResult lazy = parse(source, mode);
+        EXPECT_EQ(lazy.success, eager.success);
+        EXPECT_EQ(lazy.diagnostics, eager.diagnostics);
+
+        // the AST is only complete without an error
+        if (eager.success) {
+            EXPECT_EQ(lazy.ast, eager.ast);
+        }
+    }
+}
+
+}
+
+TEST(LazyBodyTest, BuildsTheSameASTAsEagerParsing) {
+    std::string_view source =
+        "let g i32 = 3;\n"
+        "fn never_called(p *i32) i64 {\n"
+        "    let x = *p + g;\n"
+        "    if x > 2 { return x; } else { x = -x; }\n"
+        "    return 1;\n"
+        "}\n"
+        "let h u8 = 7;\n"
+        "fn add(a i32, b i32) i32 { return (a + b) * 2; }\n"
+        "fn main() i32 {\n"
+        "    let y u8 = h;\n"
+        "    y += 1;\n"
+        "    return add(g, y);\n"
+        "}\n";
+
+    ParseResult eager = parse(source, BodyParsing::Eager);
+    ASSERT_TRUE(eager.success) << eager.diagnostics;
+    EXPECT_EQ(eager.diagnostics, "");
+
+    // unreferenced bodies are parsed and analysed like the others
+    EXPECT_NE(eager.ast.find("FuncDecl fn never_called"), std::string::npos);
+    EXPECT_NE(eager.ast.find("IfStmt"), std::string::npos);
+    EXPECT_EQ(eager.ast.find("pending"), std::string::npos);
+
+    expect_same_as_eager(source);
+}
+
+TEST(LazyBodyTest, OnlyParsesTheBodiesMainReaches) {
+    std::string_view source =
+        "fn never_called() i32 { return 1; }\n"
+        "fn called() i32 { return 2; }\n"
+        "fn main() i32 { return called(); }\n";
+
+    ParseResult referenced = parse(source, BodyParsing::Referenced);
+    ASSERT_TRUE(referenced.success) << referenced.diagnostics;
+    EXPECT_NE(referenced.ast.find("FuncDecl fn never_called() -> i32; pending"), std::string::npos);
+
+    // the bodies that were parsed are those of an eager pass
+    ParseResult eager = parse(source, BodyParsing::Eager);
+    std::string_view called = "FuncDecl fn called";
+    ASSERT_NE(referenced.ast.find(called), std::string::npos);
+    EXPECT_EQ(referenced.ast.substr(referenced.ast.find(called)), eager.ast.substr(eager.ast.find(called)));
+
+    // an error in a body main does not reach is not reported
+    std::string_view broken =
+        "fn never_called() i32 { return undeclared; }\n"
+        "fn main() i32 { return 0; }\n";
+
+    EXPECT_TRUE(parse(broken, BodyParsing::Referenced).success);
+    EXPECT_FALSE(parse(broken, BodyParsing::Eager).success);
+    expect_same_as_eager(broken);
+}
+
+TEST(LazyBodyTest, ReportsDiagnosticsInTheOrderOfTheFile) {
+    // every global and every body warns, including the ones never called
+    std::string_view source =
+        "let a i32 = 2147483647 + 1;\n"
+        "fn f() i32 { return 2147483647 + 2; }\n"
+        "let b i32 = 2147483647 + 3;\n"
+        "fn g() i32 { let x i32 = 2147483647 + 4; return x; }\n"
+        "fn main() i32 { return f() + g(); }\n";
+
+    ParseResult eager = parse(source, BodyParsing::Eager);
+    EXPECT_TRUE(eager.success);
+    EXPECT_EQ(eager.diagnostics,
+              "test.dl:1:13: warning: overflow in constant expression of type 'i32'\n"
+              "test.dl:2:21: warning: overflow in constant expression of type 'i32'\n"
+              "test.dl:3:13: warning: overflow in constant expression of type 'i32'\n"
+              "test.dl:4:26: warning: overflow in constant expression of type 'i32'\n");
+
+    expect_same_as_eager(source);
+
+    // main reaches every function, but parses g before f
+    EXPECT_EQ(parse(source, BodyParsing::Referenced).diagnostics, eager.diagnostics);
+}
+
+TEST(LazyBodyTest, ReportsABodyErrorBeforeALaterDeclarationError) {
+    std::string_view source =
+        "let a i32 = 2147483647 + 1;\n"
+        "fn f() i32 { return y; }\n"
+        "let b i32 = 2147483647 + 3;\n"
+        "let = 4;\n";
+
+    ParseResult eager = parse(source, BodyParsing::Eager);
+    EXPECT_FALSE(eager.success);
+    EXPECT_EQ(eager.diagnostics,
+              "test.dl:1:13: warning: overflow in constant expression of type 'i32'\n"
+              "test.dl:2:21: error: use of undeclared identifier 'y'\n");
+
+    expect_same_as_eager(source);
+}
+
+TEST(LazyBodyTest, ReportsOnlyTheFirstBodyError) {
+    std::string source;
+
+    // enough bodies for every thread to take some, warnings all along and two errors
+    for (int i = 0; i < 64; i++) {
+        std::string n = std::to_string(i);
+        source += "let g" + n + " i32 = 2147483647 + " + n + ";\n";
+        source += "fn f" + n + "(a i32) i32 {\n";
+        source += "    let x i32 = a * 2147483647 * 2;\n";
+        source += i == 40 || i == 50 ? "    return missing" + n + ";\n" : "    return x + f" + n + "(a);\n";
+        source += "}\n";
+    }
+
+    ParseResult eager = parse(source, BodyParsing::Eager);
+    EXPECT_FALSE(eager.success);
+    EXPECT_NE(eager.diagnostics.find("'missing40'"), std::string::npos);
+    EXPECT_EQ(eager.diagnostics.find("'missing50'"), std::string::npos);
+
+    expect_same_as_eager(source);
+
+    // and without an error, the whole AST
+    for (std::string_view missing : { "missing40", "missing50" }) {
+        source.replace(source.find(missing), missing.size(), "x");
+    }
+
+    expect_same_as_eager(source);
+}
+
+TEST(TrailingObjectsTest, StoresCallArgumentsAndBlockStatements) {
+    const int many = 300;
+    std::string params;
+    std::string args;
+    std::string stmts;
+
+    for (int i = 0; i < many; i++) {
+        params += (i == 0 ? "p" : ", p") + std::to_string(i) + " i32";
+        args += (i == 0 ? "" : ", ") + std::to_string(i);
+        stmts += "    x = x + " + std::to_string(i) + ";\n";
+    }
+
+    std::string source =
+        "fn none() i32 { return 1; }\n"
+        "fn wide(" + params + ") i32 { return p0; }\n"
+        "fn empty() {}\n"
+        "fn main() i32 {\n"
+        "    let x = none();\n"
+        "    {}\n"
+        "    x = wide(" + args + ");\n" + stmts +
+        "    return x;\n"
+        "}\n";
+
+    for (BodyParsing mode : { BodyParsing::Eager, BodyParsing::Parallel }) {
+        ParseResult res = parse(source, mode, [&](const ASTContext& context) {
+            ASSERT_EQ(context.toplevel_funcdecls().size(), 4u);
+
+            auto* empty = util::cast<CompoundStmt>(context.toplevel_funcdecls()[2]->get_body());
+            EXPECT_TRUE(empty->body().empty());
+
+            llvm::ArrayRef<Stmt*> body = util::cast<CompoundStmt>(context.toplevel_funcdecls()[3]->get_body())->body();
+            ASSERT_EQ(body.size(), 4u + many);
+
+            auto* none = util::cast<VarDecl>(util::cast<DeclStmt>(body[0])->get_decl());
+            auto* none_call = util::dyn_cast<CallExpr>(none->get_expr());
+            ASSERT_NE(none_call, nullptr);
+            EXPECT_TRUE(none_call->arguments().empty());
+
+            EXPECT_TRUE(util::cast<CompoundStmt>(body[1])->body().empty());
+
+            auto* assign = util::cast<AssignExpr>(util::cast<ExprStmt>(body[2])->get_expr());
+            llvm::ArrayRef<Expr*> wide_args = util::cast<CallExpr>(assign->rhs())->arguments();
+            ASSERT_EQ(wide_args.size(), (usize)many);
+
+            for (int i = 0; i < many; i++) {
+                auto* literal = util::dyn_cast<IntLiteralExpr>(wide_args[i]);
+                ASSERT_NE(literal, nullptr);
+                EXPECT_EQ(literal->get_value(), i);
+            }
+
+            for (int i = 0; i < many; i++) {
+                EXPECT_EQ(body[3 + i]->stmt_kind(), Stmt::ExprStmtKind);
+            }
+
+            EXPECT_EQ(body.back()->stmt_kind(), Stmt::ReturnStmtKind);
+        });
+
+        EXPECT_TRUE(res.success) << res.diagnostics;
+    }
+}
+
+TEST(ScratchListTest, KeepsTheArgumentsOfNestedCalls) {
+    std::string_view source =
+        "fn k() i32 { return 0; }\n"
+        "fn h(a i32, b i32) i32 { return a; }\n"
+        "fn g(a i32, b i32, c i32) i32 { return a; }\n"
+        "fn f(a i32, b i32, c i32) i32 { return a; }\n"
+        "fn main() i32 {\n"
+        "    let a = 1;\n"
+        "    let b = 2;\n"
+        "    let c = 3;\n"
+        "    f(h(a, b), c, k());\n"
+        "    return f(g(a, h(b, c), k()), h(h(c, b), a), c);\n"
+        "}\n";
+
+    // the arguments as text, calls written out like in the source
+    std::function<std::string(const Expr*)> print = [&](const Expr* expr) -> std::string {
+        if (auto* cast = util::dyn_cast<CastExpr>(expr)) {
+            return print(cast->castee());
+        }
+
+        if (auto* id = util::dyn_cast<IdExpr>(expr)) {
+            return std::string(id->get_identifier_info()->name());
+        }
+
+        auto* call = util::cast<CallExpr>(expr);
+        std::string ret = print(call->expr()) + "(";
+
+        for (usize i = 0; i < call->arguments().size(); i++) {
+            ret += (i == 0 ? "" : ", ") + print(call->arguments()[i]);
+        }
+
+        return ret + ")";
+    };
+
+    ParseResult res = parse(source, BodyParsing::Eager, [&](const ASTContext& context) {
+        llvm::ArrayRef<Stmt*> body = util::cast<CompoundStmt>(context.toplevel_funcdecls().back()->get_body())->body();
+        ASSERT_EQ(body.size(), 5u);
+
+        EXPECT_EQ(print(util::cast<ExprStmt>(body[3])->get_expr()), "f(h(a, b), c, k())");
+        EXPECT_EQ(print(util::cast<ReturnStmt>(body[4])->get_expr()), "f(g(a, h(b, c), k()), h(h(c, b), a), c)");
+    });
+
+    EXPECT_TRUE(res.success) << res.diagnostics;
+}
+
+TEST(IntLiteralTest, ReportsLiteralsTooLargeForI32) {
+    // the digits, and the value of the literal
+    std::pair<std::string_view, std::string_view> fits[] = {
+        { "2147483647", "2147483647" },
+        { "0x7FFFFFFF", "2147483647" },
+        // more digits than the fast path takes
+        { "00000000000000000000042", "42" },
+        { "0x000000000000000007FFFFFFF", "2147483647" },
+    };
+
+    for (auto [digits, value] : fits) {
+        SCOPED_TRACE(digits);
+
+        ParseResult res = parse("let a = " + std::string(digits) + ";\n", BodyParsing::Eager);
+        EXPECT_TRUE(res.success);
+        EXPECT_EQ(res.diagnostics, "");
+        EXPECT_NE(res.ast.find(" " + std::string(value) + " <test.dl:1:9>"), std::string::npos) << res.ast;
+    }
+
+    std::string_view too_large[] = {
+        "2147483648",
+        "4294967295",
+        "0x80000000",
+        "0xFFFFFFFF",
+        "18446744073709551615",
+        "99999999999999999999",
+        "0x10000000000000000",
+    };
+
+    for (std::string_view digits : too_large) {
+        SCOPED_TRACE(digits);
+
+        ParseResult res = parse("let a = " + std::string(digits) + ";\n", BodyParsing::Eager);
+        EXPECT_FALSE(res.success);
+        EXPECT_EQ(res.diagnostics, "test.dl:1:9: error: integer literal is too large for type 'i32'\n");
+    }
+}